@@ -4,13 +4,73 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
-../src/libleiodchw.c 
+../src/libleiodcactor.c \
+../src/libleiodcbroker.c \
+../src/libleiodccapture.c \
+../src/libleiodccounter.c \
+../src/libleiodcevent.c \
+../src/libleiodchealth.c \
+../src/libleiodchistory.c \
+../src/libleiodchw.c \
+../src/libleiodcktrace.c \
+../src/libleiodcm2.c \
+../src/libleiodcprobe.c \
+../src/libleiodcrt.c \
+../src/libleiodcrules.c \
+../src/libleiodcsafe.c \
+../src/libleiodcsampler.c \
+../src/libleiodcsched.c \
+../src/libleiodcseq.c \
+../src/libleiodcserial.c \
+../src/libleiodcsio.c \
+../src/libleiodcstate.c \
+../src/libleiodcstats.c 
 
 OBJS += \
-./src/libleiodchw.o 
+./src/libleiodcactor.o \
+./src/libleiodcbroker.o \
+./src/libleiodccapture.o \
+./src/libleiodccounter.o \
+./src/libleiodcevent.o \
+./src/libleiodchealth.o \
+./src/libleiodchistory.o \
+./src/libleiodchw.o \
+./src/libleiodcktrace.o \
+./src/libleiodcm2.o \
+./src/libleiodcprobe.o \
+./src/libleiodcrt.o \
+./src/libleiodcrules.o \
+./src/libleiodcsafe.o \
+./src/libleiodcsampler.o \
+./src/libleiodcsched.o \
+./src/libleiodcseq.o \
+./src/libleiodcserial.o \
+./src/libleiodcsio.o \
+./src/libleiodcstate.o \
+./src/libleiodcstats.o 
 
 C_DEPS += \
-./src/libleiodchw.d 
+./src/libleiodcactor.d \
+./src/libleiodcbroker.d \
+./src/libleiodccapture.d \
+./src/libleiodccounter.d \
+./src/libleiodcevent.d \
+./src/libleiodchealth.d \
+./src/libleiodchistory.d \
+./src/libleiodchw.d \
+./src/libleiodcktrace.d \
+./src/libleiodcm2.d \
+./src/libleiodcprobe.d \
+./src/libleiodcrt.d \
+./src/libleiodcrules.d \
+./src/libleiodcsafe.d \
+./src/libleiodcsampler.d \
+./src/libleiodcsched.d \
+./src/libleiodcseq.d \
+./src/libleiodcserial.d \
+./src/libleiodcsio.d \
+./src/libleiodcstate.d \
+./src/libleiodcstats.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
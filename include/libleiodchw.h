@@ -2,12 +2,97 @@
  ============================================================================
  Name        : libleiodchw.h
  Author      : AK
- Version     : V3.00
+ Version     : V3.28
  Copyright   : Property of Londelec UK Ltd
  Description : Header file for LEIODC CPU pin manipulation library
 
   Change log :
 
+  *********V3.28 18/10/2026**************
+  Header version follows library version
+
+  *********V3.27 18/10/2026**************
+  Header version follows library version, leiodc_uart_int_get()
+  returns 0 if all control lines are low
+
+  *********V3.26 18/10/2026**************
+  Header version follows library version, LEIODC_LIBVERSION created,
+  library minor version was not bumped with the serial I/O engine,
+  framed receive, capture, sequence, rules and history functions
+
+  *********V3.25 18/10/2026**************
+  Kernel call trace record payload is always zero terminated
+
+  *********V3.24 18/10/2026**************
+  Deterministic real-time mode functions created
+
+  *********V3.23 18/10/2026**************
+  I/O actor functions created
+
+  *********V3.22 18/10/2026**************
+  Kernel call flight recorder functions and trace file format created
+
+  *********V3.21 18/10/2026**************
+  Pin history recorder functions and file format created
+
+  *********V3.20 18/10/2026**************
+  Input sampler functions created
+
+  *********V3.19 18/10/2026**************
+  Pulse counter functions created
+
+  *********V3.18 18/10/2026**************
+  Reflex rule functions created
+
+  *********V3.17 18/10/2026**************
+  Emergency safe-state functions created
+
+  *********V3.16 18/10/2026**************
+  Deadline scheduler functions created
+
+  *********V3.15 18/10/2026**************
+  Timed output sequence functions created
+
+  *********V3.14 18/10/2026**************
+  Serial traffic capture functions created
+
+  *********V3.13 18/10/2026**************
+  Serial line health monitor functions created
+
+  *********V3.12 18/10/2026**************
+  Serial I/O engine framed receive functions created
+
+  *********V3.11 18/10/2026**************
+  Serial I/O engine functions created
+
+  *********V3.10 18/10/2026**************
+  RS485 userspace direction control functions created
+
+  *********V3.09 18/10/2026**************
+  RS485 9-bit addressing settings added to the serial port setup
+
+  *********V3.08 18/10/2026**************
+  Low latency serial port setup functions created
+
+  *********V3.07 18/10/2026**************
+  Function to set interface modes of all UARTs in one step created
+
+  *********V3.06 18/10/2026**************
+  UART interface mode read-back function created
+
+  *********V3.05 18/10/2026**************
+  Pin state mirror in shared memory and reader API created
+
+  *********V3.04 18/10/2026**************
+  GPIO broker API created, pin operations are forwarded
+  to the broker if it is running, operation batching API created
+
+  *********V3.02 18/10/2026**************
+  Library call, kernel call and error statistics API created
+
+  *********V3.01 18/10/2026**************
+  M.2 card config change watch API created (CONFIG pin edge events)
+
   *********V3.00 26/01/2024**************
   M.2 card config pins defined, new API to read card config as a byte
   MB board version pins defined, new API to read Board version as a byte
@@ -42,8 +127,16 @@
 #define LIBARGDEF_INIT const leiodcpin pintable[], uint8_t pincount
 #define LIBARGDEF_PINS leiodcpin lepin, uint8_t state
 #define LIBARGDEF_UART uint8_t uartno, uint8_t interface, const fddef *fdptr
+#define LIBARGDEF_UARTS const uint8_t *interface, const fddef *const *fdtable
 #define LIBARGDEF_VERCHK uint16_t minvers
 
+
+/*
+ * Library version providing all functions of this header,
+ * leiodc_libverchk(LEIODC_LIBVERSION) fails if the loaded library is older
+ */
+#define LEIODC_LIBVERSION		328
+
 typedef	uint8_t		leiodcpin;				/* LEIODC pin size definition */
 
 /*
@@ -97,6 +190,508 @@ typedef enum {
 } leiodcuartint_e;
 
 
+/*
+ * Serial port setup
+ */
+#define LEIODC_SERIAL_TTY			"/dev/ttyAPP%u"	/* Default tty of the UART (uartno) */
+#define LEIODC_SERIAL_DELAY_AUTO	0xFFFF			/* RS485 RTS delay computed from baud rate */
+#define LEIODC_RS485_ADDR_RECV		0x01			/* Receive only frames addressed to addrrecv */
+#define LEIODC_RS485_ADDR_DEST		0x02			/* Send to slave addrdest */
+typedef struct leiodcserialcfg_s {
+	uint32_t			baud;			/* Baud rate */
+	lechar				parity;			/* 'N' - none, 'E' - even, 'O' - odd */
+	uint8_t				databits;		/* 5...8, 0 - 8 */
+	uint8_t				stopbits;		/* 1 or 2, 0 - 1 */
+	uint8_t				interface;		/* leiodcuartint_e, 0 - leave unchanged */
+	uint16_t			rtsbeforems;	/* RS485 RTS delay before send (ms) or LEIODC_SERIAL_DELAY_AUTO */
+	uint16_t			rtsafterms;		/* RS485 RTS delay after send (ms) or LEIODC_SERIAL_DELAY_AUTO */
+	uint8_t				addrflags;		/* RS485 9-bit addressing LEIODC_RS485_ADDR_xxx, 0 - disabled */
+	uint8_t				addrrecv;		/* RS485 receive address */
+	uint8_t				addrdest;		/* RS485 destination address */
+} leiodcserialcfg_t;
+
+
+/*
+ * RS485 userspace direction control statistics
+ */
+typedef struct leiodcrs485stats_s {
+	uint64_t			frames;			/* Frames sent */
+	uint64_t			errors;			/* Failed frames */
+	uint64_t			drainmax;		/* Longest wait for transmitter empty after write() (ns) */
+	uint64_t			turnlast;		/* Transmitter empty to TX enable released, last frame (ns) */
+	uint64_t			turnmax;		/* Longest turnaround (ns) */
+	uint64_t			turnsum;		/* Total turnaround time (ns) */
+} leiodcrs485stats_t;
+
+
+/*
+ * Serial I/O engine, ports are serviced by the library event thread
+ */
+#define LEIODC_SIO_RING_DEFAULT		4096			/* Default RX/TX ring size */
+typedef void (*leiodcsiocb_t)(uint8_t uartno, void *arg);
+typedef struct leiodcsiocfg_s {
+	uint32_t			rxsize;			/* RX ring size (rounded up to power of 2), 0 - default */
+	uint32_t			txsize;			/* TX ring size (rounded up to power of 2), 0 - default */
+	leiodcsiocb_t		rxcallback;		/* Executed by the event thread when data is received, can be NULL */
+	void				*arg;			/* Callback argument */
+} leiodcsiocfg_t;
+typedef struct leiodcsiostats_s {
+	uint64_t			rxbytes;		/* Bytes received */
+	uint64_t			txbytes;		/* Bytes sent */
+	uint64_t			rxoverrun;		/* Bytes dropped, RX ring full */
+	uint64_t			rxecho;			/* Bytes discarded while RS485 transmitter was enabled */
+	uint64_t			txfull;			/* Writes rejected, TX ring full */
+	uint64_t			reads;			/* readv() calls */
+	uint64_t			writes;			/* writev() calls */
+	uint32_t			hangup;			/* tty hung up, port is not serviced anymore */
+	uint32_t			frames;			/* Frames delimited by inter-frame gap */
+	uint32_t			framedrop;		/* Frames dropped, RX ring full */
+} leiodcsiostats_t;
+
+
+/*
+ * Serial I/O engine framed receive, frames are delimited by silence on the line
+ */
+#define LEIODC_FRAME_MAX_DEFAULT	256				/* Default maximal frame length (Modbus RTU ADU) */
+#define LEIODC_FRAME_TRUNCATED		0x01			/* Frame was longer than the buffer */
+typedef struct leiodcframe_s {
+	const uint8_t		*data;			/* Frame data (valid during the callback only) */
+	uint32_t			len;			/* Frame length */
+	uint32_t			flags;			/* LEIODC_FRAME_xxx */
+	nanotime_t			first;			/* CLOCK_MONOTONIC time of the first byte (estimated from the read time) */
+	nanotime_t			last;			/* CLOCK_MONOTONIC time the last byte was read */
+} leiodcframe_t;
+typedef void (*leiodcframecb_t)(uint8_t uartno, const leiodcframe_t *frame, void *arg);
+typedef struct leiodcframecfg_s {
+	uint32_t			gapus;			/* Inter-frame gap (us), 0 - 3.5 characters (1750 us above 19200 baud) */
+	uint32_t			maxlen;			/* Maximal frame length, 0 - default */
+	leiodcframecb_t		callback;		/* Executed by the event thread for each frame, NULL - frames are queued */
+	void				*arg;			/* Callback argument */
+} leiodcframecfg_t;
+
+
+/*
+ * Serial line health monitor, TIOCGICOUNT counters of configured ports
+ */
+#define LEIODC_HEALTH_INTERVAL_DEFAULT	1000		/* Default sampling interval (ms) */
+#define LEIODC_HEALTH_WIRING_DEFAULT	3			/* Default intervals with errors on most characters to suspect wiring */
+#define LEIODC_HEALTH_ERRORS		0x01			/* Line errors in the interval exceeded errthreshold */
+#define LEIODC_HEALTH_RATE			0x02			/* Line errors per million characters exceeded ppmthreshold */
+#define LEIODC_HEALTH_WIRING		0x04			/* RS485/RS422 mode with errors on most characters for wiringintervals, */
+													/* swapped pair or default/reversed pinout mismatch suspected */
+#define LEIODC_HEALTH_FAILED		0x08			/* TIOCGICOUNT failed, port is not monitored anymore */
+typedef struct leiodchealthcnt_s {
+	uint32_t			rx;				/* Characters received */
+	uint32_t			tx;				/* Characters sent */
+	uint32_t			frame;			/* Framing errors */
+	uint32_t			parity;			/* Parity errors */
+	uint32_t			overrun;		/* UART FIFO overruns */
+	uint32_t			brk;			/* Break conditions */
+	uint32_t			bufoverrun;		/* tty buffer overruns */
+} leiodchealthcnt_t;
+typedef struct leiodchealth_s {
+	uint8_t				uartno;
+	uint8_t				interface;		/* leiodcuartint_e set when the interval was sampled, 0 - unknown */
+	uint32_t			flags;			/* LEIODC_HEALTH_xxx of the last interval */
+	uint32_t			wiring;			/* Consecutive intervals with errors on most characters */
+	uint64_t			intervalns;		/* Length of the last interval (ns) */
+	leiodchealthcnt_t	delta;			/* Counter changes in the last interval */
+	leiodchealthcnt_t	total;			/* Counter changes since the port is monitored */
+	uint32_t			rxrate;			/* Characters received per second */
+	uint32_t			errrate;		/* Line errors per second (framing, parity, overrun, break, buffer overrun) */
+	uint32_t			errppm;			/* Line errors per million received characters */
+} leiodchealth_t;
+typedef void (*leiodchealthcb_t)(const leiodchealth_t *health, void *arg);
+typedef struct leiodchealthcfg_s {
+	uint32_t			intervalms;		/* Sampling interval (ms), 0 - default */
+	uint32_t			errthreshold;	/* Line errors per interval raising LEIODC_HEALTH_ERRORS, 0 - any error */
+	uint32_t			ppmthreshold;	/* Line errors per million characters raising LEIODC_HEALTH_RATE, 0 - disabled */
+	uint32_t			wiringintervals;/* Intervals to raise LEIODC_HEALTH_WIRING, 0 - default */
+	leiodchealthcb_t	callback;		/* Executed by the event thread if any flag is raised, can be NULL */
+	void				*arg;			/* Callback argument */
+} leiodchealthcfg_t;
+
+
+/*
+ * Serial traffic capture to pcap file, ports serviced by the serial I/O engine
+ * Records have a 2 byte pseudo header (direction, COM number) followed by data,
+ * Wireshark: DLT User 0, header size 2, payload protocol e.g. mbrtu
+ */
+#define LEIODC_CAPTURE_LINKTYPE		147				/* LINKTYPE_USER0 */
+#define LEIODC_CAPTURE_RX			0x01			/* Capture received data */
+#define LEIODC_CAPTURE_TX			0x02			/* Capture sent data */
+#define LEIODC_CAPTURE_DIR_RX		0				/* Pseudo header direction */
+#define LEIODC_CAPTURE_DIR_TX		1
+typedef struct leiodccapturecfg_s {
+	const lechar		*path;			/* pcap file, rotated files get suffix .1, .2 ... */
+	uint8_t				ports;			/* Bit mask of COM ports (bit0 - COM1), 0 - all */
+	uint8_t				flags;			/* LEIODC_CAPTURE_xxx, 0 - received data only */
+	uint16_t			files;			/* Number of files kept by rotation, 0 - default */
+	uint32_t			filesize;		/* File is rotated when size is reached (bytes), 0 - no rotation */
+	uint32_t			ringsize;		/* Capture ring size (rounded up to power of 2), 0 - default */
+	uint32_t			flushms;		/* Maximal time records stay in the ring (ms), 0 - default */
+} leiodccapturecfg_t;
+typedef struct leiodccapturestats_s {
+	uint64_t			records;		/* Records written to the ring */
+	uint64_t			bytes;			/* Bytes written to files */
+	uint64_t			drops;			/* Records dropped, ring full */
+	uint64_t			writes;			/* writev() calls */
+	uint32_t			rotations;		/* Files rotated */
+	uint32_t			errors;			/* File write errors */
+} leiodccapturestats_t;
+
+
+/*
+ * Timed output sequence, steps change output pins of one GPIO line handle
+ */
+#define LEIODC_SEQ_PIN(mpin)		((uint64_t) 1 << (mpin))	/* Step mask/values bit of leiodcpin_e */
+#define LEIODC_SEQ_SPIN_DEFAULT		100000			/* Busy-wait before each step (ns) */
+typedef struct leiodcseqstep_s {
+	uint64_t			mask;			/* LEIODC_SEQ_PIN() of pins set by the step */
+	uint64_t			values;			/* LEIODC_SEQ_PIN() of pins set high */
+	uint64_t			delayns;		/* Time from this step to the next one (ns) */
+} leiodcseqstep_t;
+typedef struct leiodcseq_s leiodcseq_t;
+
+
+/*
+ * Deadline scheduler of pin actions, executed by the library event thread
+ * Actions due in the same tick on the same GPIO line handle are merged
+ */
+#define LEIODC_SCHED_TICK_NS		1000000			/* Scheduler resolution (ns) */
+#define LEIODC_SCHED_MAX			256				/* Maximal number of pending actions */
+typedef uint32_t leiodcschedid_t;					/* Pending action identifier, 0 - invalid */
+typedef struct leiodcschedstats_s {
+	uint64_t			scheduled;		/* Actions scheduled */
+	uint64_t			executed;		/* Pin changes applied */
+	uint64_t			cancelled;		/* Actions cancelled */
+	uint64_t			calls;			/* GPIO set calls, merged pin changes share one call */
+	uint64_t			errors;			/* Failed GPIO set calls */
+	uint64_t			latemax;		/* Longest delay of a tick behind its deadline (ns) */
+	uint32_t			pending;		/* Actions pending */
+} leiodcschedstats_t;
+
+
+/*
+ * Emergency safe-state, applied by async-signal-safe trigger
+ */
+#define LEIODC_SAFE_TXOFF			0x01			/* Disable RS485/RS422 transmitters of all UARTs */
+#define LEIODC_SAFE_SIGTERM			0x10			/* Install trigger as SIGTERM handler */
+#define LEIODC_SAFE_SIGSEGV			0x20			/* Install trigger as SIGSEGV handler */
+#define LEIODC_SAFE_SIGPWR			0x40			/* Install trigger as SIGPWR handler */
+typedef struct leiodcsafepin_s {
+	leiodcpin			lepin;
+	uint8_t				state;			/* Safe output state */
+} leiodcsafepin_t;
+
+
+/*
+ * Reflex rule, input pin edge sets output pin on the library event thread
+ */
+#define LEIODC_RULE_MAX				32				/* Maximal number of rules */
+#define LEIODC_RULE_RISING			0x01			/* Rule fires on rising edge */
+#define LEIODC_RULE_FALLING			0x02			/* Rule fires on falling edge */
+#define LEIODC_RULE_BOTH			(LEIODC_RULE_RISING | LEIODC_RULE_FALLING)
+typedef struct leiodcrule_s {
+	leiodcpin			inpin;			/* Input pin, edge detection is enabled */
+	uint8_t				edge;			/* LEIODC_RULE_RISING/FALLING/BOTH */
+	leiodcpin			guardpin;		/* Input pin which must be at guardstate, 0 - no condition */
+	uint8_t				guardstate;
+	leiodcpin			outpin;			/* Output pin set by the rule */
+	uint8_t				outstate;
+	uint32_t			pulsems;		/* Opposite state is restored after pulse (ms), 0 - no pulse */
+} leiodcrule_t;
+typedef struct leiodcrulestats_s {
+	uint64_t			fired;			/* Output changes applied */
+	uint64_t			blocked;		/* Edges ignored, guard pin not at guardstate */
+	uint64_t			errors;			/* Failed output changes */
+	uint64_t			latlast;		/* Edge-to-output latency of the last change (ns) */
+	uint64_t			latmin;			/* Shortest edge-to-output latency (ns) */
+	uint64_t			latmax;			/* Longest edge-to-output latency (ns) */
+	uint64_t			latsum;			/* Sum of latencies, average is latsum / fired (ns) */
+} leiodcrulestats_t;
+
+
+/*
+ * Pulse counters of the input pin, intervals are measured
+ * between edges timestamped by the kernel (ns)
+ */
+typedef struct leiodccounter_s {
+	uint64_t			rising;			/* Rising edges counted */
+	uint64_t			falling;		/* Falling edges counted */
+	uint64_t			lost;			/* Edges lost, kernel event FIFO overflowed */
+	uint64_t			lastns;			/* CLOCK_MONOTONIC time of the last edge */
+	uint64_t			period;			/* Last rising to rising edge period */
+	uint64_t			periodmin;
+	uint64_t			periodmax;
+	uint64_t			high;			/* Last high level pulse width */
+	uint64_t			highmin;
+	uint64_t			highmax;
+	uint64_t			low;			/* Last low level pulse width */
+	uint64_t			lowmin;
+	uint64_t			lowmax;
+	uint32_t			freqmhz;		/* Frequency of the last period (mHz) */
+} leiodccounter_t;
+
+
+/*
+ * Fixed rate input sampler
+ */
+#define LEIODC_SAMPLE_PIN(mpin)		((uint64_t) 1 << (mpin))	/* Sample mask/values bit of leiodcpin_e */
+typedef struct leiodcsamplercfg_s {
+	uint32_t			ratehz;			/* Sampling rate (Hz), 0 - 1000 Hz */
+	uint32_t			ringsize;		/* Samples kept in the ring, rounded up to power of 2, 0 - 4096 */
+	int					priority;		/* SCHED_FIFO priority of the sampler thread, 0 - inherited */
+} leiodcsamplercfg_t;
+typedef struct leiodcsample_s {
+	uint64_t			timestamp;		/* CLOCK_MONOTONIC time of the tick (ns) */
+	uint64_t			values;			/* LEIODC_SAMPLE_PIN() of pins at high level */
+	uint64_t			mask;			/* LEIODC_SAMPLE_PIN() of pins sampled */
+	uint64_t			latency;		/* Time from the tick to the last line read (ns) */
+} leiodcsample_t;
+typedef struct leiodcsamplerstats_s {
+	uint64_t			ticks;			/* Ticks sampled */
+	uint64_t			missed;			/* Ticks skipped, sampler was late */
+	uint64_t			errors;			/* Failed line reads */
+	uint64_t			samples;		/* Samples written to the ring */
+} leiodcsamplerstats_t;
+
+
+/*
+ * Kernel call flight recorder, ioctl() and sysfs calls of the library are
+ * recorded with arguments and duration to a lock-free memory ring
+ */
+#define LEIODC_KTRACE_CRASHDUMP		0x01			/* Dump ring to the file on SIGSEGV/SIGBUS/SIGILL/SIGFPE/SIGABRT */
+typedef struct leiodcktracecfg_s {
+	uint32_t			ringsize;		/* Records kept in the ring, rounded up to power of 2, 0 - 8192 */
+	const lechar		*dumppath;		/* Crash dump file, required by LEIODC_KTRACE_CRASHDUMP */
+	uint32_t			flags;			/* LEIODC_KTRACE_xxx */
+} leiodcktracecfg_t;
+
+typedef enum {
+	leiodckt_none = 0,
+	leiodckt_get_line,			/* GPIO_V2_GET_LINE_IOCTL, ret: line request fd */
+	leiodckt_set_config,		/* GPIO_V2_LINE_SET_CONFIG_IOCTL, arg: pinmask, valmask, flags, edgemask */
+	leiodckt_edge_config,		/* GPIO_V2_LINE_SET_CONFIG_IOCTL of edge detection, arg: edgemask, previous edgemask */
+	leiodckt_get_values,		/* GPIO_V2_LINE_GET_VALUES_IOCTL, arg: mask, bits read */
+	leiodckt_set_values,		/* GPIO_V2_LINE_SET_VALUES_IOCTL, arg: mask, bits */
+	leiodckt_rs485,				/* TIOCSRS485, arg: interface, flags, padding[0], (delay before << 16) | after (ms) */
+	leiodckt_sysfs_open,		/* open(), payload: path below /sys/class/gpio/ */
+	leiodckt_sysfs_write,		/* write(), payload: path below /sys/class/gpio/, '=' and written string */
+	leiodckt_count				/* Number of operations, must be the last */
+} leiodcktop_e;
+
+typedef struct leiodcktrec_s {
+	uint64_t			start;			/* CLOCK_MONOTONIC time of the call (ns) */
+	uint32_t			elapsed;		/* Duration of the call (ns) */
+	uint8_t				op;				/* leiodcktop_e */
+	uint8_t				minp;			/* GPIO line handle first lepin, TIOCSRS485: uartno */
+	uint8_t				maxp;			/* GPIO line handle last lepin */
+	uint8_t				pad;
+	int32_t				ret;			/* Return value, -errno on failure */
+	uint32_t			arg[4];			/* Line masks are bits of the handle lines */
+	lechar				payload[28];	/* Zero terminated, truncated to 27 characters */
+} leiodcktrec_t;
+
+/*
+ * Trace file, header followed by the records oldest first
+ */
+#define LEIODC_KTRACE_MAGIC			0x4C454B54		/* 'LEKT' */
+#define LEIODC_KTRACE_VERSION		1
+typedef struct leiodcktfile_s {
+	uint32_t			magic;			/* LEIODC_KTRACE_MAGIC */
+	uint16_t			version;
+	uint16_t			recsize;		/* sizeof(leiodcktrec_t) */
+	uint32_t			count;			/* Records following the header */
+	uint32_t			pad;
+	uint64_t			lost;			/* Records overwritten or being written at the time of dump */
+} leiodcktfile_t;
+
+/*
+ * I/O actor, pin and UART interface GPIO operations of all threads are
+ * queued to one I/O thread which merges them per GPIO line handle
+ */
+typedef struct leiodcactorcfg_s {
+	uint32_t			queuesize;		/* Operations in the queue, rounded up to power of 2, 0 - 256 */
+	int					priority;		/* SCHED_FIFO priority of the I/O thread, 0 - inherited */
+} leiodcactorcfg_t;
+typedef struct leiodcactordone_s {
+	uint32_t			pending;		/* Queued operations not executed yet */
+	int32_t				result;			/* -1 if any of the operations failed */
+} leiodcactordone_t;
+typedef struct leiodcactorstats_s {
+	uint64_t			operations;		/* Operations executed */
+	uint64_t			ioctls;			/* GPIO ioctls issued for them */
+	uint64_t			drains;			/* Queue drains by the I/O thread */
+	uint64_t			maxdrain;		/* Most operations taken by one drain */
+	uint64_t			queuefull;		/* Operations which waited for a free queue slot */
+} leiodcactorstats_t;
+
+/*
+ * Deterministic real-time mode, GPIO line handles are requested and memory
+ * is locked up front, pin and UART interface calls don't allocate memory,
+ * format error strings or initialize anything lazily
+ */
+#define LEIODC_RT_NO_MLOCK			0x01		/* Memory is not locked (testing without CAP_IPC_LOCK) */
+typedef struct leiodcrtcfg_s {
+	uint32_t			stacksize;		/* Stack prefaulted in the calling thread (bytes), 0 - 64 KiB */
+	uint32_t			flags;			/* LEIODC_RT_xxx */
+} leiodcrtcfg_t;
+
+/*
+ * M.2 card config change event
+ */
+typedef struct leiodcm2event_s {
+	uint8_t				oldcfg;			/* Previous M.2 card config */
+	uint8_t				newcfg;			/* New M.2 card config */
+	nanotime_t			timestamp;		/* CLOCK_MONOTONIC time of the last CONFIG pin edge */
+} leiodcm2event_t;
+typedef void (*leiodcm2cb_t)(const leiodcm2event_t *event, void *arg);
+
+
+/*
+ * Statistics of the exported API functions,
+ * not collected if library is built with LEIODC_NO_STATS defined
+ */
+typedef enum {
+	lestat_pin_init = 0,		/* leiodc_pin_init() */
+	lestat_pin_dir_out_state_set,	/* leiodc_pin_dir_out_state_set() */
+	lestat_pin_state_set,		/* leiodc_pin_state_set() */
+	lestat_pin_state_get,		/* leiodc_pin_state_get() */
+	lestat_pin_dir_in_set,		/* leiodc_pin_dir_in_set() */
+	lestat_uart_int,			/* leiodc_uart_int() */
+	lestat_m2_init,				/* leiodc_m2_init() */
+	lestat_m2_config_get,		/* leiodc_m2_config_get() */
+	lestat_board_ver_get,		/* leiodc_board_ver_get() */
+	lestat_uart_int_get,		/* leiodc_uart_int_get() */
+	lestat_uart_int_all,		/* leiodc_uart_int_all() */
+	lestat_serial_config,		/* leiodc_serial_open(), leiodc_serial_config() */
+	lestat_api_count			/* Number of instrumented functions, must be the last */
+} leiodcstatapi_e;
+
+/*
+ * Kernel calls (ioctl, sysfs write) are counted per GPIO line handle or file
+ */
+typedef enum {
+	lestatk_uart = 0,			/* UART GPIO line handle */
+	lestatk_modem,				/* M.2 modem GPIO line handle */
+	lestatk_heartbeat,			/* Heartbeat GPIO line handle */
+	lestatk_chip,				/* GPIO chip (line requests) and temporary handles */
+	lestatk_tty,				/* Serial port tty */
+	lestatk_sysfs,				/* Legacy sysfs GPIO files */
+	lestatk_count				/* Number of kernel call types, must be the last */
+} leiodcstatkcall_e;
+
+/*
+ * Error causes
+ */
+typedef enum {
+	lestaterr_lib = 0,			/* Library detected error (invalid argument, mode or state) */
+	lestaterr_perm,				/* EPERM, EACCES */
+	lestaterr_busy,				/* EBUSY, line is requested by another process */
+	lestaterr_nodev,			/* ENOENT, ENODEV, ENXIO */
+	lestaterr_inval,			/* EINVAL, ENOTTY, EOPNOTSUPP rejected by kernel */
+	lestaterr_io,				/* EIO */
+	lestaterr_other,			/* Any other errno */
+	lestaterr_count				/* Number of error causes, must be the last */
+} leiodcstaterr_e;
+
+#define LEIODC_STATS_HIST_BUCKETS	20		/* Bucket[0] < 1024ns, bucket[n] < 2^(10+n) ns, last bucket unlimited */
+
+typedef struct leiodcstats_s {
+	uint64_t			calls[lestat_api_count];			/* Number of API calls */
+	uint64_t			latsum[lestat_api_count];			/* Total API call time (ns) */
+	uint64_t			latmax[lestat_api_count];			/* Longest API call (ns) */
+	uint64_t			lathist[lestat_api_count][LEIODC_STATS_HIST_BUCKETS];	/* API call time histogram */
+	uint64_t			kcalls[lestatk_count];				/* Number of kernel calls per handle */
+	uint64_t			errors[lestaterr_count];			/* Number of errors per cause */
+} leiodcstats_t;
+
+
+/*
+ * Pin state mirror published in shared memory by the process owning GPIO lines
+ */
+#define LEIODC_UART_COUNT			3				/* Number of UARTs with interface control pins */
+#define LEIODC_STATE_UNKNOWN		0xFF			/* Pin value unknown */
+
+typedef enum {
+	lepindir_unknown = 0,		/* Direction not set by the library */
+	lepindir_in,				/* Input */
+	lepindir_out,				/* Output */
+} leiodcpindir_e;
+
+typedef struct leiodcpinstate_s {
+	uint8_t				dir;			/* leiodcpindir_e */
+	uint8_t				value;			/* Output value set or input value read last, LEIODC_STATE_UNKNOWN if unknown */
+} leiodcpinstate_t;
+
+typedef struct leiodcstate_s {
+	leiodcpinstate_t	pins[lepin_count];			/* State of every leiodcpin_e */
+	uint8_t				uartint[LEIODC_UART_COUNT];	/* leiodcuartint_e applied to COMx, 0 - not configured */
+	int16_t				m2config;		/* M.2 card config read last, -1 if unknown */
+	int16_t				boardver;		/* MB board version, -1 if unknown */
+	uint32_t			owner;			/* Process ID of the publisher */
+	uint32_t			updates;		/* Number of state updates */
+	uint64_t			updatens;		/* CLOCK_MONOTONIC time of the last update (ns) */
+} leiodcstate_t;
+
+
+/*
+ * Pin history recorder, pin and UART mode changes made by the library
+ * are recorded to a fixed size memory mapped ring file
+ */
+#define LEIODC_HISTORY_EDGES		0x01			/* Record input edges */
+typedef struct leiodchistorycfg_s {
+	const lechar		*path;			/* Ring file, history is continued if file exists */
+	uint32_t			filesize;		/* Ring file size (bytes), 0 - 256 KiB */
+	uint32_t			flushms;		/* Written blocks are flushed in batches (ms), 0 - 10000 ms */
+	uint32_t			flags;			/* LEIODC_HISTORY_xxx */
+} leiodchistorycfg_t;
+
+/*
+ * History file format, file header occupies the first block,
+ * every block starts with a header holding state snapshot followed by records:
+ *   byte0 = (LEIODC_HREC_xxx << 5) | lepin, uartno or LEIODC_HEXT_xxx
+ *   LEB128 varint time since the previous record (us), block base for the first one
+ *   LEIODC_HREC_UART, LEIODC_HREC_EXT: one value byte
+ *   LEIODC_HREC_REPEAT: uint16_t toggles, uint32_t time since the record
+ *   before the toggles (us), pin of the previous record changed level
+ *   'toggles' times, record is updated in place while the run continues
+ * Multi-byte fields are little endian
+ */
+#define LEIODC_HISTORY_MAGIC		0x4C454846		/* 'LEHF' */
+#define LEIODC_HISTORY_BLOCK_MAGIC	0x4C454842		/* 'LEHB' */
+#define LEIODC_HISTORY_VERSION		1
+#define LEIODC_HISTORY_BLOCK_SIZE	4096
+#define LEIODC_HREC_LOW				0				/* Output set low */
+#define LEIODC_HREC_HIGH			1				/* Output set high */
+#define LEIODC_HREC_INPUT			2				/* Pin switched to input */
+#define LEIODC_HREC_FALL			3				/* Input falling edge */
+#define LEIODC_HREC_RISE			4				/* Input rising edge */
+#define LEIODC_HREC_UART			5				/* UART interface mode set */
+#define LEIODC_HREC_REPEAT			6				/* Previous record toggled */
+#define LEIODC_HREC_EXT				7
+#define LEIODC_HEXT_M2CONFIG		0				/* M.2 card config read */
+#define LEIODC_HEXT_BOARDVER		1				/* Board version read */
+typedef struct leiodchistfile_s {
+	uint32_t			magic;			/* LEIODC_HISTORY_MAGIC */
+	uint16_t			version;
+	uint16_t			blocksize;		/* Size of the block, file header is padded to it */
+	uint32_t			blocks;			/* Blocks following the file header */
+} leiodchistfile_t;
+typedef struct leiodchistblock_s {
+	uint32_t			magic;			/* LEIODC_HISTORY_BLOCK_MAGIC */
+	uint32_t			seq;			/* Block sequence, highest is the latest */
+	int64_t				basens;			/* CLOCK_REALTIME time of the block start (ns) */
+	uint32_t			values;			/* Snapshot at block start, bit lepin: output high */
+	uint32_t			outputs;		/* Bit lepin: pin is output */
+	uint32_t			inputs;			/* Bit lepin: pin is input */
+	uint16_t			used;			/* Bytes of records */
+	uint8_t				uartint[LEIODC_UART_COUNT];
+	uint8_t				pad;
+} leiodchistblock_t;
+
+
 extern lechar LibErrorString[];
 
 /*
@@ -108,8 +703,77 @@ extern int leiodc_pin_state_set(LIBARGDEF_PINS);
 extern int leiodc_pin_state_get(LIBARGDEF_PINS);
 extern int leiodc_pin_dir_in_set(LIBARGDEF_PINS);
 extern int leiodc_uart_int(LIBARGDEF_UART);
+extern int leiodc_uart_int_get(uint8_t uartno, const fddef *fdptr);
+extern int leiodc_uart_int_all(LIBARGDEF_UARTS);
+extern int leiodc_serial_open(uint8_t uartno, const lechar *ttypath, const leiodcserialcfg_t *sercfg);
+extern int leiodc_serial_config(uint8_t uartno, fddef fd, const leiodcserialcfg_t *sercfg);
+extern int leiodc_rs485_sw_enable(uint8_t uartno, uint8_t interface, fddef fd);
+extern int leiodc_rs485_sw_disable(uint8_t uartno);
+extern int leiodc_rs485_sw_write(uint8_t uartno, const void *buf, uint32_t len);
+extern int leiodc_rs485_sw_stats_get(uint8_t uartno, leiodcrs485stats_t *stats);
+extern int leiodc_sio_port_add(uint8_t uartno, fddef fd, const leiodcsiocfg_t *siocfg);
+extern int leiodc_sio_port_del(uint8_t uartno);
+extern int leiodc_sio_read(uint8_t uartno, void *buf, uint32_t size);
+extern int leiodc_sio_write(uint8_t uartno, const void *buf, uint32_t len);
+extern int leiodc_sio_stats_get(uint8_t uartno, leiodcsiostats_t *stats);
+extern int leiodc_sio_frame_enable(uint8_t uartno, const leiodcframecfg_t *framecfg);
+extern int leiodc_sio_frame_fd(uint8_t uartno);
+extern int leiodc_sio_frame_read(uint8_t uartno, leiodcframe_t *frame, void *buf, uint32_t size);
+extern int leiodc_capture_start(const leiodccapturecfg_t *capturecfg);
+extern int leiodc_capture_stop(void);
+extern int leiodc_capture_stats_get(leiodccapturestats_t *stats);
+extern int leiodc_health_start(const leiodchealthcfg_t *healthcfg);
+extern int leiodc_health_stop(void);
+extern int leiodc_health_get(uint8_t uartno, leiodchealth_t *health);
+extern int leiodc_seq_compile(const leiodcseqstep_t *steps, uint32_t count, uint32_t spinns, leiodcseq_t **seqptr);
+extern int leiodc_seq_play(const leiodcseq_t *seq, int64_t *errorns);
+extern void leiodc_seq_free(leiodcseq_t *seq);
+extern int leiodc_sched_set(LIBARGDEF_PINS, const nanotime_t *when, leiodcschedid_t *idptr);
+extern int leiodc_sched_pulse(LIBARGDEF_PINS, uint32_t delayms, uint32_t widthms, leiodcschedid_t *idptr);
+extern int leiodc_sched_cancel(leiodcschedid_t id);
+extern int leiodc_sched_stats_get(leiodcschedstats_t *stats);
+extern int leiodc_safe_register(const leiodcsafepin_t *safetable, uint32_t count, uint32_t flags);
+extern int leiodc_safe_trigger(void);
+extern void leiodc_safe_release(void);
+extern int leiodc_rules_start(const leiodcrule_t *rules, uint32_t count);
+extern int leiodc_rules_stop(void);
+extern int leiodc_rules_stats_get(uint32_t ruleno, leiodcrulestats_t *stats);
+extern int leiodc_counter_start(LIBARGDEF_INIT);
+extern int leiodc_counter_stop(void);
+extern int leiodc_counter_get(leiodcpin lepin, leiodccounter_t *counter);
+extern int leiodc_sampler_start(const leiodcsamplercfg_t *samplercfg);
+extern int leiodc_sampler_stop(void);
+extern int leiodc_sampler_read(uint64_t *cursor, leiodcsample_t *samples, uint32_t count, uint64_t *lost);
+extern int leiodc_sampler_stats_get(leiodcsamplerstats_t *stats);
+extern int leiodc_history_start(const leiodchistorycfg_t *historycfg);
+extern int leiodc_history_stop(void);
+extern int leiodc_ktrace_start(const leiodcktracecfg_t *ktracecfg);
+extern int leiodc_ktrace_stop(void);
+extern int leiodc_ktrace_dump(const lechar *path);
+extern int leiodc_ktrace_replay(const leiodcktrec_t *rec, fddef ttyfd);
+extern int leiodc_actor_start(const leiodcactorcfg_t *actorcfg);
+extern int leiodc_actor_stop(void);
+extern int leiodc_actor_async(leiodcactordone_t *done);
+extern int leiodc_actor_wait(leiodcactordone_t *done, int32_t timeoutms);
+extern int leiodc_actor_stats_get(leiodcactorstats_t *stats);
+extern int leiodc_rt_start(const leiodcrtcfg_t *rtcfg);
+extern int leiodc_rt_stop(void);
+extern int leiodc_rt_thread_prepare(uint32_t stacksize);
 extern int leiodc_m2_init(void);
 extern int leiodc_m2_config_get(void);
+extern int leiodc_m2_watch_start(leiodcm2cb_t callback, void *arg, uint32_t debouncems);
+extern int leiodc_m2_watch_stop(void);
 extern int leiodc_board_ver_get(void);
 extern int leiodc_libverchk(LIBARGDEF_VERCHK);
+extern int leiodc_stats_get(leiodcstats_t *stats);
+extern int leiodc_stats_dump(lechar *buf, uint32_t size);
+extern int leiodc_stats_reset(void);
+extern int leiodc_batch_begin(void);
+extern int leiodc_batch_end(void);
+extern int leiodc_broker_run(const lechar *sockpath);
+extern void leiodc_broker_stop(void);
+extern int leiodc_state_publish(void);
+extern int leiodc_state_open(void);
+extern int leiodc_state_read(leiodcstate_t *state);
+extern int leiodc_state_close(void);
 #endif /* LIBLEIODCHW_H_ */
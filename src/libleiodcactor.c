@@ -0,0 +1,680 @@
+/*
+ ============================================================================
+ Name        : libleiodcactor.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC I/O actor. While the I/O thread is running, pin and
+               UART interface GPIO operations of the application threads
+               are queued to a lock-free multi-producer queue instead of
+               being issued by the callers. The I/O thread drains the queue,
+               merges queued operations per GPIO line handle (the last
+               operation of a line wins) and issues one ioctl per handle
+               and direction. Callers wait for the result, or queue
+               operations without waiting after leiodc_actor_async().
+               Operations are encoded as GPIO broker operations.
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  Producers wait on futex while the queue is full, stop waits on futex
+  for producers instead of yielding
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "libleiodcint.h"
+
+
+#define ACTOR_QUEUE_DEFAULT		256			// Operations in the queue
+#define ACTOR_QUEUE_MAX			65536
+
+
+/*
+ * Queued operation, cell sequence equals enqueue position
+ * when the cell is free and position + 1 when it is filled
+ */
+struct actorop_s {
+	uint64_t			seq;
+	uint8_t				op;				// brokerop_e
+	uint8_t				arg0;
+	uint8_t				arg1;
+	int32_t				group;			// Result slot, set in the drained copy
+	leiodcactordone_t	*done;
+};
+
+/*
+ * Operations merged for one GPIO line handle
+ */
+struct actormerge_s {
+	__u32				outmask;		// Lines set to output
+	__u32				outvals;		// Output values
+	__u32				inmask;			// Lines set to input
+	int32_t				group;			// Result slot of the merged operations, -1 - nothing merged
+};
+
+
+uint32_t _actor_active;
+__thread int _actor_thread;
+
+
+static struct {
+	struct actorop_s	*queue;
+	uint32_t			mask;			// Queue size - 1
+	uint64_t			enqpos;			// Next position reserved by producers
+	uint64_t			deqpos;			// Next position drained by the I/O thread
+	uint32_t			producers;		// Producers between active check and enqueue
+	uint32_t			freed;			// Incremented by the I/O thread after every drain
+	uint32_t			fullwaiters;	// Producers waiting for free cells
+	uint32_t			sleeping;		// I/O thread waits for wakeup
+	uint32_t			stop;
+	fddef				wakefd;			// eventfd, written only if I/O thread sleeps
+	pthread_t			thread;
+	struct actorop_s	*drained;		// Operations taken by the last drain
+	int32_t				*results;		// Results of the merged groups
+	uint64_t			queuefull;
+	leiodcactorstats_t	stats;
+} glactor;
+
+
+/*
+ * Completion of the operations queued by the current thread, NULL - wait
+ */
+static __thread leiodcactordone_t *tldone;
+
+
+
+
+/*
+ * Wake threads waiting for completion
+ * [18/10/2026]
+ */
+static inline void _actor_futex_wake(uint32_t *addr) {
+
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+
+/*
+ * Wait while futex word equals the value
+ * [18/10/2026]
+ */
+static inline void _actor_futex_wait(uint32_t *addr, uint32_t value) {
+
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+
+/*
+ * Producer leaves, last one wakes leiodc_actor_stop()
+ * [18/10/2026]
+ */
+static inline void _actor_producer_leave(void) {
+
+	if (!__atomic_sub_fetch(&glactor.producers, 1, __ATOMIC_SEQ_CST) &&
+			!__atomic_load_n(&_actor_active, __ATOMIC_SEQ_CST))
+		_actor_futex_wake(&glactor.producers);
+}
+
+
+/*
+ * Sleep until the I/O thread drains the queue,
+ * returns at once if the cell has been freed meanwhile
+ * [18/10/2026]
+ */
+static void _actor_full_wait(struct actorop_s *cell, uint64_t pos) {
+	uint32_t		freed;
+
+
+	__atomic_fetch_add(&glactor.fullwaiters, 1, __ATOMIC_SEQ_CST);
+	freed = __atomic_load_n(&glactor.freed, __ATOMIC_SEQ_CST);
+	if ((int64_t) (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos) < 0)
+		_actor_futex_wait(&glactor.freed, freed);
+	__atomic_fetch_sub(&glactor.fullwaiters, 1, __ATOMIC_RELAXED);
+}
+
+
+/*
+ * Execute operation without the I/O thread
+ * [18/10/2026]
+ */
+static int _actor_direct(brokerop_e op, uint8_t arg0, uint8_t arg1) {
+	struct handle_s		*lrhandle;
+	__u32				pbit;
+
+
+	switch (op) {
+	case brop_pin_dir_out_state_set:
+	case brop_pin_dir_in_set:
+		if (!(lrhandle = _cdev_pin_handle_find(arg0, 1)))
+			return RETVAL_NEGATIVE;
+
+		pbit = HANDLE_PIN_BIT(lrhandle, arg0);
+		if (op == brop_pin_dir_in_set)
+			return _cdev_lines_in_set(lrhandle, pbit);
+		return _cdev_lines_out_set(lrhandle, pbit, (arg1) ? pbit : 0);
+
+	case brop_uart_int_all:
+		{
+			const uint8_t inttable[LEIODC_UART_COUNT] = {arg0 & 0x0F, arg0 >> 4, arg1};
+
+			return _uart_gpio_set(inttable);
+		}
+
+	default:
+		break;
+	}
+
+	ERROR_LOGGER("Operation %u can't be queued to the I/O thread", op)
+	return RETVAL_NEGATIVE;
+}
+
+
+/*
+ * Reserve queue cell and publish operation,
+ * producer sleeps while the queue is full
+ * [18/10/2026]
+ * Futex wait instead of yield while the queue is full
+ * [18/10/2026]
+ */
+static void _actor_enqueue(brokerop_e op, uint8_t arg0, uint8_t arg1, leiodcactordone_t *done) {
+	struct actorop_s	*cell;
+	uint64_t			pos, seq;
+	int					full = 0;
+
+
+	pos = __atomic_load_n(&glactor.enqpos, __ATOMIC_RELAXED);
+	for (;;) {
+		cell = &glactor.queue[pos & glactor.mask];
+		seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n(&glactor.enqpos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if ((int64_t) (seq - pos) < 0) {
+			/*
+			 * Queue is full, I/O thread is executing the drained operations
+			 */
+			if (!full++)
+				__atomic_fetch_add(&glactor.queuefull, 1, __ATOMIC_RELAXED);
+			_actor_full_wait(cell, pos);
+			pos = __atomic_load_n(&glactor.enqpos, __ATOMIC_RELAXED);
+		}
+		else
+			pos = __atomic_load_n(&glactor.enqpos, __ATOMIC_RELAXED);
+	}
+
+	cell->op = op;
+	cell->arg0 = arg0;
+	cell->arg1 = arg1;
+	cell->done = done;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+
+/*
+ * Queue operation to the I/O thread, wait for the result
+ * unless the thread queues without waiting (leiodc_actor_async())
+ * Return result of the operation, 0 if not waited for
+ * [18/10/2026]
+ */
+int _actor_call(brokerop_e op, uint8_t arg0, uint8_t arg1) {
+	leiodcactordone_t	single = {0, RETVAL_OK}, *done = (tldone) ? tldone : &single;
+	uint64_t			wake = 1;
+	int					retstat;
+
+
+	__atomic_fetch_add(&glactor.producers, 1, __ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&_actor_active, __ATOMIC_SEQ_CST)) {
+		/*
+		 * I/O actor is being stopped
+		 */
+		_actor_producer_leave();
+		if ((retstat = _actor_direct(op, arg0, arg1)) && (done != &single))
+			__atomic_store_n(&done->result, RETVAL_NEGATIVE, __ATOMIC_RELAXED);
+		return retstat;
+	}
+
+	__atomic_fetch_add(&done->pending, 1, __ATOMIC_RELAXED);
+	_actor_enqueue(op, arg0, arg1, done);
+	_actor_producer_leave();
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_exchange_n(&glactor.sleeping, 0, __ATOMIC_SEQ_CST)) {
+		if (write(glactor.wakefd, &wake, sizeof(wake)) < 0) {}
+	}
+
+	if (done != &single)
+		return RETVAL_OK;
+
+	leiodc_actor_wait(&single, -1);
+	return single.result;
+}
+
+
+/*
+ * Issue merged operations of the handle
+ * [18/10/2026]
+ */
+static void _actor_handle_flush(struct handle_s *lrhandle, struct actormerge_s *merge) {
+
+	if (merge->group < 0)
+		return;
+
+	if (merge->outmask) {
+		glactor.stats.ioctls++;
+		if (_cdev_lines_out_set(lrhandle, merge->outmask, merge->outvals))
+			glactor.results[merge->group] = RETVAL_NEGATIVE;
+	}
+
+	if (merge->inmask) {
+		glactor.stats.ioctls++;
+		if (_cdev_lines_in_set(lrhandle, merge->inmask))
+			glactor.results[merge->group] = RETVAL_NEGATIVE;
+	}
+
+	memset(merge, 0, sizeof(*merge));
+	merge->group = -1;
+}
+
+
+/*
+ * Set merged UART interface modes, one ioctl for all UARTs
+ * [18/10/2026]
+ */
+static void _actor_uart_flush(uint8_t *interface, int32_t *group) {
+
+	if (*group < 0)
+		return;
+
+	glactor.stats.ioctls++;
+	if (_uart_gpio_set(interface))
+		glactor.results[*group] = RETVAL_NEGATIVE;
+
+	memset(interface, 0, LEIODC_UART_COUNT);
+	*group = -1;
+}
+
+
+/*
+ * Merge drained operations per handle, issue them and complete callers.
+ * Operations of the uart handle and UART interface modes are flushed
+ * in the queued order as they change the same lines.
+ * [18/10/2026]
+ */
+static void _actor_execute(uint32_t count) {
+	struct actormerge_s	merge[handle_count];
+	struct actorop_s	*aop;
+	struct handle_s		*lrhandle;
+	leiodcactordone_t	*done;
+	uint8_t				interface[LEIODC_UART_COUNT] = {0};
+	int32_t				uartgroup = -1, groups = 0;
+	uint32_t			i;
+	__u32				pbit;
+	int					h;
+
+
+	memset(merge, 0, sizeof(merge));
+	for (h = 0; h < handle_count; h++)
+		merge[h].group = -1;
+
+	for (i = 0; i < count; i++) {
+		aop = &glactor.drained[i];
+		switch (aop->op) {
+		case brop_pin_dir_out_state_set:
+		case brop_pin_dir_in_set:
+			if (!(lrhandle = _cdev_pin_handle_find(aop->arg0, 1)))
+				break;
+			h = lrhandle - glrhandles;
+
+			if (h == handle_uart)
+				_actor_uart_flush(interface, &uartgroup);
+
+			if (merge[h].group < 0) {
+				merge[h].group = groups;
+				glactor.results[groups++] = RETVAL_OK;
+			}
+			aop->group = merge[h].group;
+
+			pbit = HANDLE_PIN_BIT(lrhandle, aop->arg0);
+			if (aop->op == brop_pin_dir_in_set) {
+				merge[h].outmask &= ~pbit;
+				merge[h].outvals &= ~pbit;
+				merge[h].inmask |= pbit;
+			}
+			else {
+				merge[h].inmask &= ~pbit;
+				merge[h].outmask |= pbit;
+				merge[h].outvals = (aop->arg1) ? (merge[h].outvals | pbit) : (merge[h].outvals & ~pbit);
+			}
+			continue;
+
+		case brop_uart_int_all:
+			_actor_handle_flush(&glrhandles[handle_uart], &merge[handle_uart]);
+
+			if (uartgroup < 0) {
+				uartgroup = groups;
+				glactor.results[groups++] = RETVAL_OK;
+			}
+			aop->group = uartgroup;
+
+			if (aop->arg0 & 0x0F)
+				interface[0] = aop->arg0 & 0x0F;
+			if (aop->arg0 >> 4)
+				interface[1] = aop->arg0 >> 4;
+			if (aop->arg1)
+				interface[2] = aop->arg1;
+			continue;
+
+		default:
+			ERROR_LOGGER("Operation %u can't be queued to the I/O thread", aop->op)
+			break;
+		}
+
+		aop->group = groups;
+		glactor.results[groups++] = RETVAL_NEGATIVE;
+	}
+
+	for (h = 0; h < handle_count; h++)
+		_actor_handle_flush(&glrhandles[h], &merge[h]);
+	_actor_uart_flush(interface, &uartgroup);
+
+	for (i = 0; i < count; i++) {
+		aop = &glactor.drained[i];
+		done = aop->done;
+		if (glactor.results[aop->group])
+			__atomic_store_n(&done->result, RETVAL_NEGATIVE, __ATOMIC_RELAXED);
+		if (!__atomic_sub_fetch(&done->pending, 1, __ATOMIC_RELEASE))
+			_actor_futex_wake(&done->pending);
+	}
+	glactor.stats.operations += count;
+}
+
+
+/*
+ * Take all published operations from the queue,
+ * producers waiting for free cells are woken
+ * Return number of operations taken
+ * [18/10/2026]
+ * Full queue waiters woken
+ * [18/10/2026]
+ */
+static uint32_t _actor_drain(void) {
+	struct actorop_s	*cell;
+	uint32_t			count = 0;
+
+
+	while (count <= glactor.mask) {
+		cell = &glactor.queue[glactor.deqpos & glactor.mask];
+		if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != (glactor.deqpos + 1))
+			break;
+
+		glactor.drained[count++] = *cell;
+		__atomic_store_n(&cell->seq, glactor.deqpos + glactor.mask + 1, __ATOMIC_RELEASE);
+		glactor.deqpos++;
+	}
+
+	if (count) {
+		__atomic_fetch_add(&glactor.freed, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&glactor.fullwaiters, __ATOMIC_SEQ_CST))
+			_actor_futex_wake(&glactor.freed);
+	}
+	return count;
+}
+
+
+/*
+ * I/O thread, sleeps on eventfd only if the queue is empty
+ * [18/10/2026]
+ */
+static void *_actor_thread_main(void *arg) {
+	uint64_t	wakes;
+	uint32_t	count;
+
+
+	_actor_thread = 1;
+	for (;;) {
+		if ((count = _actor_drain())) {
+			glactor.stats.drains++;
+			if (count > glactor.stats.maxdrain)
+				glactor.stats.maxdrain = count;
+			_actor_execute(count);
+			continue;
+		}
+
+		if (__atomic_load_n(&glactor.stop, __ATOMIC_ACQUIRE))
+			break;
+
+		__atomic_store_n(&glactor.sleeping, 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if ((__atomic_load_n(&glactor.queue[glactor.deqpos & glactor.mask].seq, __ATOMIC_SEQ_CST) ==
+				(glactor.deqpos + 1)) || __atomic_load_n(&glactor.stop, __ATOMIC_SEQ_CST)) {
+			__atomic_store_n(&glactor.sleeping, 0, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		if (read(glactor.wakefd, &wakes, sizeof(wakes)) < 0) {}
+	}
+	return NULL;
+}
+
+
+/*
+ * Start the I/O thread, pin and UART interface GPIO operations
+ * of all threads are queued to it until leiodc_actor_stop()
+ * actorcfg - queue size and thread priority, can be NULL
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_actor_start(const leiodcactorcfg_t *actorcfg) {
+	struct sched_param	sparam;
+	pthread_attr_t		attr;
+	uint32_t			queuesize = ACTOR_QUEUE_DEFAULT, size = 1, i;
+	int					retstat;
+
+
+	if (glactor.queue) {
+		ERROR_LOGGER("I/O actor is already running")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (actorcfg && actorcfg->queuesize)
+		queuesize = actorcfg->queuesize;
+	if (queuesize > ACTOR_QUEUE_MAX) {
+		ERROR_LOGGER("I/O actor queue size %u exceeds %u", queuesize, ACTOR_QUEUE_MAX)
+		return RETVAL_NEGATIVE;
+	}
+	while (size < queuesize)
+		size <<= 1;
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("I/O actor requires GPIO line access (mode=%u)", libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+	memset(&glactor, 0, sizeof(glactor));
+	glactor.mask = size - 1;
+	if (!(glactor.queue = calloc(size, sizeof(*glactor.queue))) ||
+			!(glactor.drained = calloc(size, sizeof(*glactor.drained))) ||
+			!(glactor.results = calloc(size, sizeof(*glactor.results)))) {
+		ERROR_STD_LOGGER("I/O actor queue (%u operations)", size)
+		goto failed;
+	}
+	for (i = 0; i < size; i++)
+		glactor.queue[i].seq = i;
+
+	if ((glactor.wakefd = eventfd(0, EFD_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("eventfd()")
+		glactor.wakefd = 0;
+		goto failed;
+	}
+
+	pthread_attr_init(&attr);
+	if (actorcfg && actorcfg->priority) {
+		memset(&sparam, 0, sizeof(sparam));
+		sparam.sched_priority = actorcfg->priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &sparam);
+	}
+
+	retstat = pthread_create(&glactor.thread, &attr, _actor_thread_main, NULL);
+	pthread_attr_destroy(&attr);
+	if (retstat) {
+		ERROR_LOGGER("pthread_create(): %s", strerror(retstat))
+		goto failed;
+	}
+
+	__atomic_store_n(&_actor_active, 1, __ATOMIC_SEQ_CST);
+	return RETVAL_OK;
+
+
+	failed:
+	if (glactor.wakefd)
+		_close(&glactor.wakefd, "eventfd", 0);
+	free(glactor.results);
+	free(glactor.drained);
+	free(glactor.queue);
+	glactor.queue = NULL;
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_actor_start)
+
+
+/*
+ * Stop the I/O thread, queued operations are executed first,
+ * callers issue GPIO operations themselves again
+ * Return -1 on error
+ * [18/10/2026]
+ * Futex wait for producers instead of yield
+ * [18/10/2026]
+ */
+int leiodc_actor_stop(void) {
+	uint64_t	wake = 1;
+	uint32_t	producers;
+
+
+	if (!glactor.queue)
+		return RETVAL_OK;
+
+	__atomic_store_n(&_actor_active, 0, __ATOMIC_SEQ_CST);
+	while ((producers = __atomic_load_n(&glactor.producers, __ATOMIC_SEQ_CST)))
+		_actor_futex_wait(&glactor.producers, producers);
+
+	__atomic_store_n(&glactor.stop, 1, __ATOMIC_SEQ_CST);
+	if (write(glactor.wakefd, &wake, sizeof(wake)) < 0) {}
+	pthread_join(glactor.thread, NULL);
+
+	_close(&glactor.wakefd, "eventfd", 1);
+	free(glactor.results);
+	free(glactor.drained);
+	free(glactor.queue);
+	glactor.results = NULL;
+	glactor.drained = NULL;
+	glactor.queue = NULL;
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_actor_stop)
+
+
+/*
+ * Queue subsequent operations of the calling thread without waiting,
+ * completion is reported to 'done' which is cleared here and must not
+ * be reused until leiodc_actor_wait() returns. NULL restores waiting.
+ * Doesn't have any effect if I/O actor is not running.
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_actor_async(leiodcactordone_t *done) {
+
+	if (done) {
+		if (__atomic_load_n(&done->pending, __ATOMIC_ACQUIRE)) {
+			ERROR_LOGGER("%u operations of the completion handle are still pending", done->pending)
+			return RETVAL_NEGATIVE;
+		}
+		done->result = RETVAL_OK;
+	}
+	tldone = done;
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_actor_async)
+
+
+/*
+ * Wait until operations of the completion handle are executed
+ * timeoutms - maximal time to wait (ms), -1 - no limit
+ * Return -1 if any of the operations failed or timeout expired
+ * [18/10/2026]
+ */
+int leiodc_actor_wait(leiodcactordone_t *done, int32_t timeoutms) {
+	nanotime_t		now, deadline, remain;
+	uint32_t		pending;
+
+
+	if (timeoutms >= 0) {
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeoutms / 1000;
+		deadline.tv_nsec += (timeoutms % 1000) * MSECINNSEC;
+		if (deadline.tv_nsec >= SECINNSEC) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= SECINNSEC;
+		}
+	}
+
+	while ((pending = __atomic_load_n(&done->pending, __ATOMIC_ACQUIRE))) {
+		if (timeoutms >= 0) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			remain.tv_sec = deadline.tv_sec - now.tv_sec;
+			remain.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+			if (remain.tv_nsec < 0) {
+				remain.tv_sec--;
+				remain.tv_nsec += SECINNSEC;
+			}
+			if (remain.tv_sec < 0) {
+				errno = ETIMEDOUT;
+				ERROR_STD_LOGGER("%u queued operations are not executed", pending)
+				return RETVAL_NEGATIVE;
+			}
+		}
+		syscall(SYS_futex, &done->pending, FUTEX_WAIT_PRIVATE, pending, (timeoutms >= 0) ? &remain : NULL, NULL, 0);
+	}
+	return __atomic_load_n(&done->result, __ATOMIC_RELAXED);
+}
+EXPORT_SYMBOL(leiodc_actor_wait)
+
+
+/*
+ * Get I/O actor statistics, kept after stop until the next start
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_actor_stats_get(leiodcactorstats_t *stats) {
+
+	memcpy(stats, &glactor.stats, sizeof(*stats));
+	stats->queuefull = __atomic_load_n(&glactor.queuefull, __ATOMIC_RELAXED);
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_actor_stats_get)
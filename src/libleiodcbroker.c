@@ -0,0 +1,573 @@
+/*
+ ============================================================================
+ Name        : libleiodcbroker.c
+ Author      : AK
+ Version     : V1.03
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC GPIO broker, a single process owns all GPIO line
+               requests and serves pin operations of other processes
+               over Unix SEQPACKET socket. Library switches to the client
+               mode automatically if the broker socket is found.
+
+  Change log :
+
+  *********V1.03 18/10/2026**************
+  Client waits for the broker reply limited time, hung broker
+  doesn't block pin calls of all client threads
+  UART interface modes flush the batch, RS485 settings of the tty
+  are applied after the control lines are changed
+
+  *********V1.02 18/10/2026**************
+  Broker socket is not writable by other users (0660), group can be
+  selected by LEIODC_BROKER_GROUP environment variable
+  Error text of the reply is addressed within the reply buffer
+
+  *********V1.01 18/10/2026**************
+  UART interface value of leiodc_uart_int() driving all control lines low is accepted
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#define _GNU_SOURCE			// accept4()
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>			// offsetof
+#include <string.h>
+#include <errno.h>			// Error number
+#include <fcntl.h>			// File controls
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <grp.h>			// getgrnam
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "libleiodcint.h"
+
+
+#define BROKER_SOCKET_PATH		"/run/leiodc.sock"		// Default broker socket
+#define BROKER_SOCKET_ENV		"LEIODC_BROKER_SOCKET"	// Environment variable to override socket path
+#define BROKER_DISABLE_ENV		"LEIODC_NO_BROKER"		// Environment variable to disable client mode
+#define BROKER_GROUP_ENV		"LEIODC_BROKER_GROUP"	// Environment variable to select group of the socket
+#define BROKER_PROTO_VERSION	1
+#define BROKER_BATCH_MAX		32						// Maximal number of operations in one request
+#define BROKER_CLIENT_MAX		32						// Maximal number of clients served by the broker
+#define BROKER_ERRTEXT_SIZE		256
+#define BROKER_TIMEOUT_MS		1000					// Maximal time to send the request and receive the reply
+
+
+/*
+ * Request, header is followed by 'count' operations
+ */
+struct brokerop_s {
+	uint8_t			op;
+	uint8_t			arg0;
+	uint8_t			arg1;
+} LEHWPACK;
+
+struct brokerreq_s {
+	uint8_t			version;
+	uint8_t			count;
+	uint16_t		seq;
+	struct brokerop_s	ops[BROKER_BATCH_MAX];
+} LEHWPACK;
+
+/*
+ * Reply, header is followed by 'count' return values
+ * and error text of the first failed operation (if 'failed' is set)
+ */
+struct brokerrep_s {
+	uint8_t			version;
+	uint8_t			failed;
+	uint16_t		seq;
+	int16_t			values[BROKER_BATCH_MAX];
+	lechar			errtext[BROKER_ERRTEXT_SIZE];	// Placeholder, text follows the last value
+} LEHWPACK;
+
+#define BROKER_REQ_HDR_SIZE		offsetof(struct brokerreq_s, ops)
+#define BROKER_REP_HDR_SIZE		offsetof(struct brokerrep_s, values)
+
+/* Error text following 'mcount' return values, at least BROKER_ERRTEXT_SIZE bytes are left in the reply */
+#define BROKER_REP_ERRTEXT(mrep, mcount)	((lechar *) (mrep) + BROKER_REP_HDR_SIZE + ((mcount) * sizeof((mrep)->values[0])))
+
+
+static struct {
+	pthread_mutex_t			lock;
+	fddef					sockfd;
+	uint16_t				seq;
+	int						server;			// This process is the broker
+	volatile sig_atomic_t	stop;			// Broker stop requested
+} glbroker = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+
+/*
+ * Operations batched by the current thread
+ */
+static __thread struct {
+	int						depth;			// Nested leiodc_batch_begin() calls
+	struct brokerreq_s		req;
+} tlbatch;
+
+
+
+
+/*
+ * Get broker socket path
+ * [18/10/2026]
+ */
+static const lechar *_broker_path(const lechar *sockpath) {
+	const lechar	*envpath;
+
+
+	if (sockpath)
+		return sockpath;
+	if ((envpath = getenv(BROKER_SOCKET_ENV)))
+		return envpath;
+	return BROKER_SOCKET_PATH;
+}
+
+
+/*
+ * Connect to the broker
+ * Return -1 if broker is not running (not an error)
+ * [18/10/2026]
+ * Send and receive timeouts
+ * [18/10/2026]
+ */
+int _broker_connect(void) {
+	struct timeval	timeout = {BROKER_TIMEOUT_MS / 1000, (BROKER_TIMEOUT_MS % 1000) * 1000};
+	sockunaddr_t	addr;
+	const lechar	*path;
+
+
+	if (glbroker.server || getenv(BROKER_DISABLE_ENV))
+		return RETVAL_NEGATIVE;
+
+	path = _broker_path(NULL);
+	if (access(path, F_OK) != 0)
+		return RETVAL_NEGATIVE;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	if ((glbroker.sockfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0) {
+		glbroker.sockfd = 0;
+		return RETVAL_NEGATIVE;
+	}
+
+	if (connect(glbroker.sockfd, (sockaddr_t *) &addr, sizeof(addr))) {
+		/*
+		 * Stale socket file, broker is not running
+		 */
+		_close(&glbroker.sockfd, path, 0);
+		return RETVAL_NEGATIVE;
+	}
+
+	if (setsockopt(glbroker.sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) ||
+			setsockopt(glbroker.sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout))) {
+		_close(&glbroker.sockfd, path, 0);
+		return RETVAL_NEGATIVE;
+	}
+	return RETVAL_OK;
+}
+
+
+/*
+ * Send request to the broker and wait for the reply
+ * Return value of the last operation or -1 if any operation failed
+ * [18/10/2026]
+ * Connection closed if reply is not received in time
+ * [18/10/2026]
+ */
+static int _broker_transact(struct brokerreq_s *req) {
+	struct brokerrep_s	rep;
+	ssize_t				rxsize;
+	size_t				txsize;
+	int					retval = RETVAL_NEGATIVE;
+
+
+	if (!req->count)
+		return RETVAL_OK;
+
+	pthread_mutex_lock(&glbroker.lock);
+	req->version = BROKER_PROTO_VERSION;
+	req->seq = ++glbroker.seq;
+	txsize = BROKER_REQ_HDR_SIZE + (req->count * sizeof(req->ops[0]));
+
+	if (!glbroker.sockfd || (send(glbroker.sockfd, req, txsize, MSG_NOSIGNAL) < 0)) {
+		/*
+		 * Broker restarted or connection closed after timeout,
+		 * try to reconnect once
+		 */
+		if (glbroker.sockfd)
+			_close(&glbroker.sockfd, "broker", 0);
+		if (_broker_connect() ||
+				(send(glbroker.sockfd, req, txsize, MSG_NOSIGNAL) < 0)) {
+			ERROR_STD_LOGGER("GPIO broker send()")
+			goto failed;
+		}
+	}
+
+	for (;;) {
+		if ((rxsize = recv(glbroker.sockfd, &rep, sizeof(rep), 0)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				/*
+				 * Broker doesn't respond, late reply is discarded
+				 * with the connection, reconnected on the next call
+				 */
+				ERROR_LOGGER("GPIO broker didn't reply within %u ms", BROKER_TIMEOUT_MS)
+				_close(&glbroker.sockfd, "broker", 0);
+			}
+			else {
+				ERROR_STD_LOGGER("GPIO broker recv()")
+			}
+			goto failed;
+		}
+
+		if (rxsize < (BROKER_REP_HDR_SIZE + (req->count * sizeof(rep.values[0])))) {
+			ERROR_LOGGER("GPIO broker reply is too short (%i bytes) or broker stopped", (int) rxsize)
+			goto failed;
+		}
+
+		if (rep.seq == req->seq)
+			break;		// Stale replies of previous requests are discarded
+	}
+
+	if (rep.failed) {
+		((lechar *) &rep)[(rxsize < sizeof(rep)) ? rxsize : (sizeof(rep) - 1)] = '\0';
+		ERROR_LOGGER("GPIO broker: %s", BROKER_REP_ERRTEXT(&rep, req->count))
+	}
+	else
+		retval = rep.values[req->count - 1];
+
+
+	failed:
+	req->count = 0;
+	pthread_mutex_unlock(&glbroker.lock);
+	return retval;
+}
+
+
+/*
+ * Forward operation to the broker,
+ * operations not returning a value are queued if batch is open
+ * Return value of the operation or -1 on error
+ * [18/10/2026]
+ * UART interface modes flush the batch
+ * [18/10/2026]
+ */
+int _broker_call(brokerop_e op, uint8_t arg0, uint8_t arg1) {
+	struct brokerreq_s	single, *req = &single;
+	struct brokerop_s	*brop;
+
+
+	if (tlbatch.depth)
+		req = &tlbatch.req;
+	else
+		req->count = 0;
+
+	brop = &req->ops[req->count++];
+	brop->op = op;
+	brop->arg0 = arg0;
+	brop->arg1 = arg1;
+
+	if (tlbatch.depth) {
+		switch (op) {
+		case brop_pin_state_get:
+		case brop_m2_config_get:
+		case brop_board_ver_get:
+			break;		// Value is required, flush the batch
+
+		case brop_uart_int_all:
+			break;		// RS485 settings of the tty are applied by the caller after control lines
+
+		default:
+			if (req->count < BROKER_BATCH_MAX)
+				return RETVAL_OK;
+			break;
+		}
+	}
+	return _broker_transact(req);
+}
+
+
+/*
+ * Start batching pin operations of the current thread,
+ * operations are sent to the broker in one message by leiodc_batch_end().
+ * Doesn't have any effect if broker is not running.
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_batch_begin(void) {
+
+	tlbatch.depth++;
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_batch_begin)
+
+
+/*
+ * Send batched pin operations
+ * Return -1 if any of the batched operations failed
+ * [18/10/2026]
+ */
+int leiodc_batch_end(void) {
+
+	if (!tlbatch.depth) {
+		ERROR_LOGGER("leiodc_batch_begin() was not called")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (--tlbatch.depth)
+		return RETVAL_OK;
+
+	return (_broker_transact(&tlbatch.req) < 0) ? RETVAL_NEGATIVE : RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_batch_end)
+
+
+/*
+ * Execute operation requested by the client
+ * [18/10/2026]
+ */
+static int _broker_execute(const struct brokerop_s *brop) {
+
+	switch (brop->op) {
+	case brop_pin_init:
+		return leiodc_pin_init(&brop->arg0, 1);
+
+	case brop_pin_dir_out_state_set:
+		return leiodc_pin_dir_out_state_set(brop->arg0, brop->arg1);
+
+	case brop_pin_state_set:
+		return leiodc_pin_state_set(brop->arg0, brop->arg1);
+
+	case brop_pin_state_get:
+		return leiodc_pin_state_get(brop->arg0, 0);
+
+	case brop_pin_dir_in_set:
+		return leiodc_pin_dir_in_set(brop->arg0, 0);
+
+	case brop_uart_int:
+		return leiodc_uart_int(brop->arg0, brop->arg1, NULL);
+
+	case brop_m2_init:
+		return leiodc_m2_init();
+
+	case brop_m2_config_get:
+		return leiodc_m2_config_get();
+
+	case brop_board_ver_get:
+		return leiodc_board_ver_get();
+
+	case brop_uart_gpio_get:
+		return _uart_gpio_get(brop->arg0);
+
+	case brop_uart_int_all:
+		{
+			const uint8_t inttable[LEIODC_UART_COUNT] = {brop->arg0 & 0x0F, brop->arg0 >> 4, brop->arg1};
+			int i;
+
+			for (i = 0; i < LEIODC_UART_COUNT; i++) {
+				if ((inttable[i] > leuart_RS422rev) && (inttable[i] != UART_INT_OFF)) {
+					ERROR_LOGGER("COM%u interface mode %u is not valid", i + 1, inttable[i])
+					return RETVAL_NEGATIVE;
+				}
+			}
+			return _uart_gpio_set(inttable);
+		}
+
+	default:
+		break;
+	}
+
+	ERROR_LOGGER("Unknown GPIO broker operation %u", brop->op)
+	return RETVAL_NEGATIVE;
+}
+
+
+/*
+ * Serve one client request
+ * Return -1 if client disconnected
+ * [18/10/2026]
+ */
+static int _broker_serve(fddef fd) {
+	struct brokerreq_s	req;
+	struct brokerrep_s	rep;
+	lechar				*errtext;
+	ssize_t				rxsize;
+	size_t				txsize, len;
+	int					i;
+
+
+	if ((rxsize = recv(fd, &req, sizeof(req), 0)) <= 0)
+		return RETVAL_NEGATIVE;
+
+	if ((rxsize < BROKER_REQ_HDR_SIZE) ||
+			(req.version != BROKER_PROTO_VERSION) ||
+			(req.count > BROKER_BATCH_MAX) ||
+			(rxsize != (BROKER_REQ_HDR_SIZE + (req.count * sizeof(req.ops[0]))))) {
+		return RETVAL_NEGATIVE;		// Incompatible client, disconnect
+	}
+
+	memset(&rep, 0, BROKER_REP_HDR_SIZE);
+	rep.version = BROKER_PROTO_VERSION;
+	rep.seq = req.seq;
+	txsize = BROKER_REP_HDR_SIZE + (req.count * sizeof(rep.values[0]));
+
+	for (i = 0; i < req.count; i++) {
+		rep.values[i] = _broker_execute(&req.ops[i]);
+
+		if ((rep.values[i] < 0) && !rep.failed) {
+			rep.failed = 1;
+			errtext = BROKER_REP_ERRTEXT(&rep, req.count);
+			len = strnlen(LibErrorString, BROKER_ERRTEXT_SIZE - 1);
+			memcpy(errtext, LibErrorString, len);
+			errtext[len] = '\0';
+			txsize += len + 1;
+		}
+	}
+
+	if (send(fd, &rep, txsize, MSG_NOSIGNAL) < 0)
+		return RETVAL_NEGATIVE;
+	return RETVAL_OK;
+}
+
+
+/*
+ * Run GPIO broker, this function returns when leiodc_broker_stop() is called
+ * sockpath - socket path, NULL to use default
+ * Socket is accessible by the owner and group (0660),
+ * LEIODC_BROKER_GROUP environment variable selects the group
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_broker_run(const lechar *sockpath) {
+	struct pollfd	pfds[1 + BROKER_CLIENT_MAX];
+	sockunaddr_t	addr;
+	struct group	*grp;
+	const lechar	*path, *group;
+	fddef			lfd, cfd;
+	int				i, nfds = 1, retstat = RETVAL_NEGATIVE;
+
+
+	glbroker.server = 1;
+	glbroker.stop = 0;
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	path = _broker_path(sockpath);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		ERROR_LOGGER("GPIO broker socket path '%s' is too long", path)
+		return RETVAL_NEGATIVE;
+	}
+	strcpy(addr.sun_path, path);
+
+	if ((lfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0) {
+		ERROR_STD_LOGGER("socket(AF_UNIX, SOCK_SEQPACKET)")
+		return RETVAL_NEGATIVE;
+	}
+
+	unlink(path);		// Socket left by the previous instance
+	if (bind(lfd, (sockaddr_t *) &addr, sizeof(addr))) {
+		ERROR_STD_LOGGER("bind(%s)", path)
+		goto failed;
+	}
+
+	/*
+	 * Only the owner and members of the group can operate GPIOs
+	 */
+	if ((group = getenv(BROKER_GROUP_ENV)) && *group) {
+		if (!(grp = getgrnam(group))) {
+			ERROR_LOGGER("GPIO broker socket group '%s' doesn't exist", group)
+			goto cleanup;
+		}
+		if (chown(path, -1, grp->gr_gid)) {
+			ERROR_STD_LOGGER("chown(%s, %s)", path, group)
+			goto cleanup;
+		}
+	}
+
+	if (chmod(path, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP)) {
+		ERROR_STD_LOGGER("chmod(%s)", path)
+		goto cleanup;
+	}
+
+	if (listen(lfd, BROKER_CLIENT_MAX)) {
+		ERROR_STD_LOGGER("listen(%s)", path)
+		goto cleanup;
+	}
+
+	pfds[0].fd = lfd;
+	pfds[0].events = POLLIN;
+
+	while (!glbroker.stop) {
+		if (poll(pfds, nfds, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			ERROR_STD_LOGGER("poll()")
+			goto cleanup;
+		}
+
+		for (i = nfds - 1; i > 0; i--) {
+			if (!pfds[i].revents)
+				continue;
+
+			if ((pfds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) ||
+					_broker_serve(pfds[i].fd)) {
+				close(pfds[i].fd);
+				pfds[i] = pfds[--nfds];
+			}
+		}
+
+		if (pfds[0].revents & POLLIN) {
+			if ((cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+				if (nfds < ARRAY_SIZE(pfds)) {
+					pfds[nfds].fd = cfd;
+					pfds[nfds].events = POLLIN;
+					pfds[nfds].revents = 0;
+					nfds++;
+				}
+				else
+					close(cfd);		// Too many clients
+			}
+		}
+	}
+	retstat = RETVAL_OK;
+
+
+	cleanup:
+	unlink(path);
+
+	failed:
+	for (i = 1; i < nfds; i++)
+		close(pfds[i].fd);
+	close(lfd);
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_broker_run)
+
+
+/*
+ * Stop GPIO broker, safe to call from signal handler
+ * [18/10/2026]
+ */
+void leiodc_broker_stop(void) {
+
+	glbroker.stop = 1;
+}
+EXPORT_SYMBOL(leiodc_broker_stop)
@@ -0,0 +1,519 @@
+/*
+ ============================================================================
+ Name        : libleiodccapture.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC serial traffic capture. Data of ports serviced by
+               the serial I/O engine is recorded with CLOCK_REALTIME
+               timestamps in pcap format. The event thread copies records
+               to a preallocated ring after the data is handed over to
+               the application, a writer thread stores them in batches
+               and rotates files by size.
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  File is truncated to the last complete record after short write
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <fcntl.h>			// File controls
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+
+#include "libleiodcint.h"
+
+
+#define CAPTURE_RING_DEFAULT	(256 * 1024)	// Default ring size
+#define CAPTURE_RING_MAX		(16 << 20)		// Maximal ring size
+#define CAPTURE_FILES_DEFAULT	2				// Current and one rotated file
+#define CAPTURE_FLUSH_DEFAULT	500				// Default flush interval (ms)
+#define CAPTURE_PATH_LENGTH		256
+#define CAPTURE_SNAPLEN			65535
+#define CAPTURE_PCAP_MAGIC_NS	0xA1B23C4D		// pcap with nanosecond timestamps
+#define CAPTURE_PSEUDO_SIZE		2				// Direction, COM number
+
+
+/*
+ * pcap file header
+ */
+struct capturefilehdr_s {
+	uint32_t		magic;
+	uint16_t		major;
+	uint16_t		minor;
+	int32_t			thiszone;
+	uint32_t		sigfigs;
+	uint32_t		snaplen;
+	uint32_t		linktype;
+};
+
+
+/*
+ * pcap record header, fixed 32-bit on-disk layout
+ * (pcaphdr_t is the libpcap in-memory header with struct timeval)
+ */
+struct capturerechdr_s {
+	uint32_t		tssec;
+	uint32_t		tsnsec;
+	uint32_t		incllen;		// Length stored in the file
+	uint32_t		origlen;		// Length on the wire
+};
+
+
+static struct {
+	uint8_t					*buf;			// Ring, NULL - capture is stopped
+	uint32_t				mask;			// Size - 1
+	uint32_t				head;			// Written by the event thread
+	uint32_t				tail;			// Written by the writer thread
+	uint32_t				highwater;		// Writer is notified above this fill level
+	uint32_t				notified;
+	uint8_t					ports;
+	uint8_t					flags;
+	uint16_t				files;
+	uint32_t				filesize;
+	uint32_t				flushms;
+	uint32_t				cursize;		// Size of the current file
+	uint32_t				stop;
+	fddef					filefd;
+	fddef					notifyfd;		// eventfd, ring above high water
+	pthread_t				thread;
+	lechar					path[CAPTURE_PATH_LENGTH];
+	leiodccapturestats_t	stats;
+} glcapture;
+
+
+
+
+/*
+ * Copy data from the ring at index
+ * [18/10/2026]
+ */
+static void _capture_ring_get(uint32_t index, void *dst, uint32_t len) {
+	uint32_t	offset = index & glcapture.mask;
+	uint32_t	first = glcapture.mask + 1 - offset;
+
+
+	if (len <= first) {
+		memcpy(dst, &glcapture.buf[offset], len);
+		return;
+	}
+	memcpy(dst, &glcapture.buf[offset], first);
+	memcpy((uint8_t *) dst + first, glcapture.buf, len - first);
+}
+
+
+/*
+ * Copy data to the ring at index
+ * [18/10/2026]
+ */
+static void _capture_ring_put(uint32_t index, const void *src, uint32_t len) {
+	uint32_t	offset = index & glcapture.mask;
+	uint32_t	first = glcapture.mask + 1 - offset;
+
+
+	if (len <= first) {
+		memcpy(&glcapture.buf[offset], src, len);
+		return;
+	}
+	memcpy(&glcapture.buf[offset], src, first);
+	memcpy(glcapture.buf, (const uint8_t *) src + first, len - first);
+}
+
+
+/*
+ * Check if data of the port is captured in the direction
+ * [18/10/2026]
+ */
+int _capture_port(uint8_t uartno, uint8_t dir) {
+
+	if (!(glcapture.ports & (1 << uartno)))
+		return 0;
+	return (glcapture.flags & ((dir == LEIODC_CAPTURE_DIR_TX) ? LEIODC_CAPTURE_TX : LEIODC_CAPTURE_RX)) ? 1 : 0;
+}
+
+
+/*
+ * Record data in the capture ring, executed by the event thread
+ * Record is dropped if the ring is full, it never blocks
+ * [18/10/2026]
+ */
+void _capture_put(uint8_t uartno, uint8_t dir, const nanotime_t *timestamp, const struct iovec *iov, int iovcnt) {
+	static const uint64_t	notify = 1;
+	struct capturerechdr_s	rechdr;
+	uint8_t					pseudo[CAPTURE_PSEUDO_SIZE];
+	uint32_t				head, tail, origlen = 0, incllen, reclen, chunk;
+	int						i;
+
+
+	if (!_capture_port(uartno, dir))
+		return;
+
+	for (i = 0; i < iovcnt; i++)
+		origlen += iov[i].iov_len;
+	origlen += CAPTURE_PSEUDO_SIZE;
+	incllen = (origlen > CAPTURE_SNAPLEN) ? CAPTURE_SNAPLEN : origlen;
+	reclen = sizeof(rechdr) + incllen;
+
+	head = glcapture.head;
+	tail = __atomic_load_n(&glcapture.tail, __ATOMIC_ACQUIRE);
+	if (reclen > (glcapture.mask + 1 - (head - tail))) {
+		glcapture.stats.drops++;
+		return;
+	}
+
+	rechdr.tssec = timestamp->tv_sec;
+	rechdr.tsnsec = timestamp->tv_nsec;
+	rechdr.incllen = incllen;
+	rechdr.origlen = origlen;
+	_capture_ring_put(head, &rechdr, sizeof(rechdr));
+	head += sizeof(rechdr);
+
+	pseudo[0] = dir;
+	pseudo[1] = uartno + 1;
+	_capture_ring_put(head, pseudo, sizeof(pseudo));
+	head += sizeof(pseudo);
+	incllen -= sizeof(pseudo);
+
+	for (i = 0; (i < iovcnt) && incllen; i++) {
+		chunk = (iov[i].iov_len > incllen) ? incllen : iov[i].iov_len;
+		_capture_ring_put(head, iov[i].iov_base, chunk);
+		head += chunk;
+		incllen -= chunk;
+	}
+	__atomic_store_n(&glcapture.head, head, __ATOMIC_RELEASE);
+	glcapture.stats.records++;
+
+	/*
+	 * Writer is woken up early only if the ring fills up,
+	 * otherwise records are flushed in batches
+	 */
+	if (((head - tail) >= glcapture.highwater) && !__atomic_exchange_n(&glcapture.notified, 1, __ATOMIC_ACQ_REL)) {
+		if (write(glcapture.notifyfd, &notify, sizeof(notify)) < 0) {}
+	}
+}
+
+
+/*
+ * Open new capture file and write the pcap header
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _capture_file_open(void) {
+	struct capturefilehdr_s	filehdr;
+
+
+	if ((glcapture.filefd = open(glcapture.path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+		ERROR_STD_LOGGER("open(%s)", glcapture.path)
+		glcapture.filefd = 0;
+		return RETVAL_NEGATIVE;
+	}
+
+	memset(&filehdr, 0, sizeof(filehdr));
+	filehdr.magic = CAPTURE_PCAP_MAGIC_NS;
+	filehdr.major = 2;
+	filehdr.minor = 4;
+	filehdr.snaplen = CAPTURE_SNAPLEN;
+	filehdr.linktype = LEIODC_CAPTURE_LINKTYPE;
+	if (write(glcapture.filefd, &filehdr, sizeof(filehdr)) != sizeof(filehdr)) {
+		ERROR_STD_LOGGER("write(%s)", glcapture.path)
+		close(glcapture.filefd);
+		glcapture.filefd = 0;
+		return RETVAL_NEGATIVE;
+	}
+	glcapture.cursize = sizeof(filehdr);
+	return RETVAL_OK;
+}
+
+
+/*
+ * Rotate capture files, path -> path.1 -> path.2 ...
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _capture_file_rotate(void) {
+	lechar		oldpath[CAPTURE_PATH_LENGTH + 8];
+	lechar		newpath[CAPTURE_PATH_LENGTH + 8];
+	int			i;
+
+
+	close(glcapture.filefd);
+	glcapture.filefd = 0;
+
+	for (i = glcapture.files - 1; i > 0; i--) {
+		if (i > 1)
+			snprintf(oldpath, sizeof(oldpath), "%s.%u", glcapture.path, i - 1);
+		else
+			snprintf(oldpath, sizeof(oldpath), "%s", glcapture.path);
+		snprintf(newpath, sizeof(newpath), "%s.%u", glcapture.path, i);
+		if (rename(oldpath, newpath) && (errno != ENOENT)) {
+			ERROR_STD_LOGGER("rename(%s, %s)", oldpath, newpath)
+		}
+	}
+	glcapture.stats.rotations++;
+	return _capture_file_open();
+}
+
+
+/*
+ * Write records from the ring to the file in batches
+ * [18/10/2026]
+ * Partial batch removed from the file after short write
+ * [18/10/2026]
+ */
+static void _capture_flush(void) {
+	struct capturerechdr_s	rechdr;
+	struct iovec			iov[2];
+	uint32_t				head, tail, offset, first, len;
+	ssize_t					wlen;
+	int						rotate;
+
+
+	for (;;) {
+		tail = glcapture.tail;
+		head = __atomic_load_n(&glcapture.head, __ATOMIC_ACQUIRE);
+		if (head == tail)
+			break;
+
+		/*
+		 * Collect records fitting in the current file
+		 */
+		len = 0;
+		rotate = 0;
+		while ((tail + len) != head) {
+			_capture_ring_get(tail + len, &rechdr, sizeof(rechdr));
+			if (glcapture.filesize &&
+					((glcapture.cursize + len + sizeof(rechdr) + rechdr.incllen) > glcapture.filesize) &&
+					((glcapture.cursize + len) > sizeof(struct capturefilehdr_s))) {
+				rotate = 1;
+				break;
+			}
+			len += sizeof(rechdr) + rechdr.incllen;
+		}
+
+		if (len && glcapture.filefd) {
+			offset = tail & glcapture.mask;
+			first = glcapture.mask + 1 - offset;
+			iov[0].iov_base = &glcapture.buf[offset];
+			iov[0].iov_len = (len <= first) ? len : first;
+			iov[1].iov_base = glcapture.buf;
+			iov[1].iov_len = len - iov[0].iov_len;
+
+			wlen = writev(glcapture.filefd, iov, (iov[1].iov_len) ? 2 : 1);
+			glcapture.stats.writes++;
+			if (wlen != len) {
+				if (!glcapture.stats.errors) {
+					ERROR_STD_LOGGER("writev(%s, %u bytes)", glcapture.path, len)
+				}
+				glcapture.stats.errors++;
+
+				/*
+				 * Records of the batch are discarded, partially written
+				 * record would corrupt the file, it is truncated to
+				 * the last complete record or rotated if that fails
+				 */
+				if ((wlen > 0) && (ftruncate(glcapture.filefd, glcapture.cursize) ||
+						(lseek(glcapture.filefd, glcapture.cursize, SEEK_SET) < 0))) {
+					if (glcapture.stats.errors == 1) {
+						ERROR_STD_LOGGER("ftruncate(%s, %u)", glcapture.path, glcapture.cursize)
+					}
+					rotate = 1;
+				}
+			}
+			else {
+				glcapture.cursize += wlen;
+				glcapture.stats.bytes += wlen;
+			}
+		}
+		__atomic_store_n(&glcapture.tail, tail + len, __ATOMIC_RELEASE);
+
+		if (rotate || !glcapture.filefd) {
+			if (glcapture.filefd ? _capture_file_rotate() : _capture_file_open()) {
+				/*
+				 * Records are discarded until file can be opened
+				 */
+				__atomic_store_n(&glcapture.tail, head, __ATOMIC_RELEASE);
+				glcapture.stats.errors++;
+				break;
+			}
+		}
+	}
+}
+
+
+/*
+ * Writer thread, ring is flushed every flush interval
+ * or when filled above high water
+ * [18/10/2026]
+ */
+static void *_capture_thread(void *arg) {
+	struct pollfd	pfd = {.fd = glcapture.notifyfd, .events = POLLIN};
+	sigset_t		sigset;
+	uint64_t		notify;
+
+
+	/*
+	 * Signals are handled by application threads
+	 */
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+	while (!__atomic_load_n(&glcapture.stop, __ATOMIC_ACQUIRE)) {
+		if (poll(&pfd, 1, glcapture.flushms) > 0) {
+			if (read(glcapture.notifyfd, &notify, sizeof(notify)) < 0) {}
+		}
+		__atomic_store_n(&glcapture.notified, 0, __ATOMIC_RELEASE);
+		_capture_flush();
+	}
+	_capture_flush();
+	return NULL;
+}
+
+
+/*
+ * Start capturing traffic of the ports serviced by the serial I/O engine
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_capture_start(const leiodccapturecfg_t *capturecfg) {
+	uint32_t	size = 1;
+	int			retstat;
+
+
+	if (!capturecfg || !capturecfg->path) {
+		ERROR_LOGGER("Capture file is not specified")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (glcapture.buf) {
+		ERROR_LOGGER("Serial traffic capture is already running")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (strlen(capturecfg->path) >= sizeof(glcapture.path)) {
+		ERROR_LOGGER("Capture file path is too long (%s)", capturecfg->path)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (capturecfg->ringsize > CAPTURE_RING_MAX) {
+		ERROR_LOGGER("Capture ring size %u is too large, maximum %u", capturecfg->ringsize, CAPTURE_RING_MAX)
+		return RETVAL_NEGATIVE;
+	}
+
+	memset(&glcapture, 0, sizeof(glcapture));
+	strcpy(glcapture.path, capturecfg->path);
+	glcapture.files = (capturecfg->files) ? capturecfg->files : CAPTURE_FILES_DEFAULT;
+	glcapture.filesize = capturecfg->filesize;
+	glcapture.flushms = (capturecfg->flushms) ? capturecfg->flushms : CAPTURE_FLUSH_DEFAULT;
+
+	while (size < ((capturecfg->ringsize) ? capturecfg->ringsize : CAPTURE_RING_DEFAULT))
+		size <<= 1;
+	glcapture.mask = size - 1;
+	glcapture.highwater = size / 2;
+
+	if (_capture_file_open())
+		return RETVAL_NEGATIVE;
+
+	if ((glcapture.notifyfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("eventfd()")
+		glcapture.notifyfd = 0;
+		goto failed;
+	}
+
+	/*
+	 * Ring is touched here, no page faults on the event thread
+	 */
+	if (!(glcapture.buf = malloc(size))) {
+		ERROR_STD_LOGGER("malloc(%u)", size)
+		goto failed;
+	}
+	memset(glcapture.buf, 0, size);
+
+	if ((retstat = pthread_create(&glcapture.thread, NULL, _capture_thread, NULL))) {
+		ERROR_LOGGER("pthread_create(): %s", strerror(retstat))
+		goto failed;
+	}
+
+	/*
+	 * Event thread starts recording
+	 */
+	_evt_lock();
+	glcapture.flags = (capturecfg->flags) ? capturecfg->flags : LEIODC_CAPTURE_RX;
+	glcapture.ports = (capturecfg->ports) ? capturecfg->ports : ((1 << LEIODC_UART_COUNT) - 1);
+	_evt_unlock();
+	return RETVAL_OK;
+
+
+	failed:
+	free(glcapture.buf);
+	glcapture.buf = NULL;
+	if (glcapture.notifyfd)
+		close(glcapture.notifyfd);
+	if (glcapture.filefd)
+		close(glcapture.filefd);
+	memset(&glcapture, 0, sizeof(glcapture));
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_capture_start)
+
+
+/*
+ * Stop capturing, recorded data is written to the file
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_capture_stop(void) {
+	static const uint64_t	notify = 1;
+	int						retstat = RETVAL_OK;
+
+
+	if (!glcapture.buf)
+		return RETVAL_OK;
+
+	_evt_lock();
+	glcapture.ports = 0;
+	_evt_unlock();
+
+	__atomic_store_n(&glcapture.stop, 1, __ATOMIC_RELEASE);
+	if (write(glcapture.notifyfd, &notify, sizeof(notify)) < 0) {}
+	pthread_join(glcapture.thread, NULL);
+
+	if (glcapture.filefd && close(glcapture.filefd)) {
+		ERROR_STD_LOGGER("close(%s)", glcapture.path)
+		retstat = RETVAL_NEGATIVE;
+	}
+	glcapture.filefd = 0;
+	close(glcapture.notifyfd);
+	glcapture.notifyfd = 0;
+	free(glcapture.buf);
+	glcapture.buf = NULL;
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_capture_stop)
+
+
+/*
+ * Get capture statistics, kept after capture is stopped
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_capture_stats_get(leiodccapturestats_t *stats) {
+
+	memcpy(stats, &glcapture.stats, sizeof(*stats));
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_capture_stats_get)
@@ -0,0 +1,266 @@
+/*
+ ============================================================================
+ Name        : libleiodccounter.c
+ Author      : AK
+ Version     : V1.00
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC pulse counters. Edge events of the input pins are
+               accumulated by the library event thread to per pin counts,
+               period and pulse width statistics. Gaps of line_seqno
+               reveal edges lost by overflowed kernel event FIFO.
+               Counters are read without syscalls or locks (seqlock).
+
+  Change log :
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+
+#include "libleiodcint.h"
+
+
+#define COUNTER_READ_RETRIES	1000		// Attempts to read consistent counters
+
+
+/*
+ * Counted pin
+ */
+struct counterpin_s {
+	uint32_t			seq;			// Odd while counters are updated
+	uint8_t				active;			// Pin is counted
+	uint32_t			lineseq;		// line_seqno of the last edge, 0 - no edge yet
+	uint64_t			risens;			// Time of the last rising edge, 0 - unknown
+	uint64_t			fallns;			// Time of the last falling edge, 0 - unknown
+	leiodccounter_t		counter;
+};
+
+
+static struct {
+	__u32				pinmask[handle_count];	// Counted lines of each handle
+	struct counterpin_s	pins[lepin_count];
+} glcounter;
+
+
+
+
+/*
+ * Update min/max/last of the interval
+ * [18/10/2026]
+ */
+static inline void _counter_interval(uint64_t *last, uint64_t *min, uint64_t *max, uint64_t ns) {
+
+	*last = ns;
+	if (!*min || (ns < *min))
+		*min = ns;
+	if (ns > *max)
+		*max = ns;
+}
+
+
+/*
+ * Input pin edge, update counters
+ * [18/10/2026]
+ */
+static void _counter_edge(struct handle_s *lrhandle, leiodcpin_e lepin, const struct gpio_v2_line_event *event, void *arg) {
+	struct counterpin_s	*cpin = &glcounter.pins[lepin];
+	leiodccounter_t		*counter = &cpin->counter;
+	uint32_t			lost;
+
+
+	__atomic_store_n(&cpin->seq, cpin->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	if (cpin->lineseq && ((lost = event->line_seqno - cpin->lineseq - 1))) {
+		/*
+		 * Kernel FIFO overflowed, intervals spanning the gap are not valid
+		 */
+		counter->lost += lost;
+		cpin->risens = 0;
+		cpin->fallns = 0;
+	}
+	cpin->lineseq = event->line_seqno;
+	counter->lastns = event->timestamp_ns;
+
+	if (event->id == GPIO_V2_LINE_EVENT_RISING_EDGE) {
+		counter->rising++;
+		if (cpin->risens) {
+			_counter_interval(&counter->period, &counter->periodmin, &counter->periodmax,
+					event->timestamp_ns - cpin->risens);
+			counter->freqmhz = (counter->period) ? ((uint64_t) SECINNSEC * 1000) / counter->period : 0;
+		}
+		if (cpin->fallns)
+			_counter_interval(&counter->low, &counter->lowmin, &counter->lowmax,
+					event->timestamp_ns - cpin->fallns);
+		cpin->risens = event->timestamp_ns;
+	}
+	else {
+		counter->falling++;
+		if (cpin->risens)
+			_counter_interval(&counter->high, &counter->highmin, &counter->highmax,
+					event->timestamp_ns - cpin->risens);
+		cpin->fallns = event->timestamp_ns;
+	}
+
+	__atomic_store_n(&cpin->seq, cpin->seq + 1, __ATOMIC_RELEASE);
+}
+
+
+/*
+ * Start counting edges of the input pins,
+ * counters of the pins are cleared
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_counter_start(LIBARGDEF_INIT) {
+	struct handle_s		*lrhandle;
+	__u32				pinmask[handle_count];
+	int					i, h;
+
+
+	if (!pintable || !pincount) {
+		ERROR_LOGGER("Pulse counter pins are not specified")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("Pulse counters require GPIO line access (mode=%u)", libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+	memset(pinmask, 0, sizeof(pinmask));
+	for (i = 0; i < pincount; i++) {
+		if (!(lrhandle = _cdev_pin_handle_find(pintable[i], 1)))
+			return RETVAL_NEGATIVE;
+
+		if (!lrhandle->fd) {
+			if (leiodc_pin_init(&pintable[i], 1))
+				return RETVAL_NEGATIVE;
+		}
+		pinmask[lrhandle - glrhandles] |= HANDLE_PIN_BIT(lrhandle, pintable[i]);
+	}
+
+	_evt_lock();
+	for (h = 0; h < handle_count; h++) {
+		if (pinmask[h] & glcounter.pinmask[h]) {
+			ERROR_LOGGER("GPIO line handle '%s' lines 0x%x are already counted",
+					glrhandles[h].name, pinmask[h] & glcounter.pinmask[h])
+			goto failed;
+		}
+	}
+
+	for (i = 0; i < pincount; i++) {
+		glcounter.pins[pintable[i]].lineseq = 0;
+		glcounter.pins[pintable[i]].risens = 0;
+		glcounter.pins[pintable[i]].fallns = 0;
+		memset(&glcounter.pins[pintable[i]].counter, 0, sizeof(glcounter.pins[0].counter));
+	}
+
+	/*
+	 * New lines of a handle replace its consumer
+	 */
+	for (h = 0; h < handle_count; h++) {
+		if (!pinmask[h])
+			continue;
+
+		if (glcounter.pinmask[h]) {
+			if (_evt_edge_del(&glrhandles[h], glcounter.pinmask[h]))
+				goto failed;
+		}
+
+		if (_evt_edge_add(&glrhandles[h], glcounter.pinmask[h] | pinmask[h], _counter_edge, NULL)) {
+			/*
+			 * Keep counting the previous lines
+			 */
+			if (glcounter.pinmask[h] && _evt_edge_add(&glrhandles[h], glcounter.pinmask[h], _counter_edge, NULL))
+				glcounter.pinmask[h] = 0;
+			goto failed;
+		}
+		glcounter.pinmask[h] |= pinmask[h];
+
+		for (i = 0; i < pincount; i++) {
+			if (pinmask[h] & HANDLE_PIN_BIT(&glrhandles[h], pintable[i]))
+				glcounter.pins[pintable[i]].active = 1;
+		}
+	}
+	_evt_unlock();
+	return RETVAL_OK;
+
+
+	failed:
+	_evt_unlock();
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_counter_start)
+
+
+/*
+ * Stop counting edges of all pins, counters can still be read
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_counter_stop(void) {
+	int		h, retstat = RETVAL_OK;
+
+
+	_evt_lock();
+	for (h = 0; h < handle_count; h++) {
+		if (glcounter.pinmask[h]) {
+			if (_evt_edge_del(&glrhandles[h], glcounter.pinmask[h]))
+				retstat = RETVAL_NEGATIVE;
+			glcounter.pinmask[h] = 0;
+		}
+	}
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_counter_stop)
+
+
+/*
+ * Read consistent snapshot of the pin counters without syscalls,
+ * event thread is not blocked by readers
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_counter_get(leiodcpin lepin, leiodccounter_t *counter) {
+	const struct counterpin_s	*cpin;
+	uint32_t					seq;
+	int							retries;
+
+
+	if ((lepin >= lepin_count) || !glcounter.pins[lepin].active) {
+		ERROR_LOGGER("Edges of lepin (%u) are not counted", lepin)
+		return RETVAL_NEGATIVE;
+	}
+
+	cpin = &glcounter.pins[lepin];
+	for (retries = 0; retries < COUNTER_READ_RETRIES; retries++) {
+		seq = __atomic_load_n(&cpin->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+
+		memcpy(counter, &cpin->counter, sizeof(*counter));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (seq == __atomic_load_n(&cpin->seq, __ATOMIC_RELAXED))
+			return RETVAL_OK;
+	}
+
+	ERROR_LOGGER("Counters of lepin (%u) are updated continuously", lepin)
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_counter_get)
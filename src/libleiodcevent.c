@@ -0,0 +1,394 @@
+/*
+ ============================================================================
+ Name        : libleiodcevent.c
+ Author      : AK
+ Version     : V1.04
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC library event thread,
+               services GPIO line edge events and internal timers
+
+  Change log :
+
+  *********V1.04 18/10/2026**************
+  Line events are passed to the pin history recorder
+
+  *********V1.03 18/10/2026**************
+  More line events are read in one go for high rate pulse inputs
+
+  *********V1.02 18/10/2026**************
+  Number of serviced descriptors increased for reflex rule input handles
+
+  *********V1.01 18/10/2026**************
+  Epoll events of the descriptor can be changed,
+  callback receives epoll events
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#define _GNU_SOURCE			// Recursive mutex initializer
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <fcntl.h>			// File controls
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#include "libleiodcint.h"
+
+
+#define EVT_FD_MAX			24			// Maximal number of file descriptors serviced by the thread
+#define EVT_EDGE_MAX		16			// Maximal number of edge event consumers
+#define EVT_EPOLL_BATCH		8			// Number of epoll events processed in one go
+#define EVT_EDGE_BATCH		64			// Number of line events read in one go
+
+
+/*
+ * File descriptor serviced by the event thread
+ */
+struct evtfd_s {
+	fddef			fd;
+	evtfd_cb		callback;
+	void			*arg;
+};
+
+
+/*
+ * Edge event consumer
+ */
+struct evtedge_s {
+	struct handle_s	*lrhandle;
+	__u32			pinmask;
+	evtedge_cb		callback;
+	void			*arg;
+};
+
+
+static struct {
+	pthread_mutex_t		lock;
+	pthread_t			thread;
+	fddef				epfd;
+	struct evtfd_s		fds[EVT_FD_MAX];
+	struct evtedge_s	edges[EVT_EDGE_MAX];
+} glevt = {
+	.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP,
+};
+
+
+
+
+/*
+ * Event thread, callbacks are executed with the lock held
+ * [18/10/2026]
+ */
+static void *_evt_thread(void *arg) {
+	struct epoll_event	events[EVT_EPOLL_BATCH];
+	struct evtfd_s		*evfd;
+	sigset_t			sigset;
+	int					i, nfds;
+
+
+	/*
+	 * Signals are handled by application threads
+	 */
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+	for (;;) {
+		nfds = epoll_wait(glevt.epfd, events, ARRAY_SIZE(events), -1);
+		if (nfds < 0) {
+			if (errno == EINTR)
+				continue;
+			ERROR_STD_LOGGER("epoll_wait()")
+			break;
+		}
+
+		for (i = 0; i < nfds; i++) {
+			evfd = events[i].data.ptr;
+
+			pthread_mutex_lock(&glevt.lock);
+			if (evfd->callback)
+				evfd->callback(evfd->fd, events[i].events, evfd->arg);
+			pthread_mutex_unlock(&glevt.lock);
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Start the event thread if not running yet
+ * [18/10/2026]
+ */
+static int _evt_start(void) {
+	int		retstat;
+
+
+	if (glevt.epfd > 0)
+		return RETVAL_OK;
+
+	if ((glevt.epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("epoll_create1()")
+		glevt.epfd = 0;
+		return RETVAL_NEGATIVE;
+	}
+
+	if ((retstat = pthread_create(&glevt.thread, NULL, _evt_thread, NULL))) {
+		ERROR_LOGGER("pthread_create(): %s", strerror(retstat))
+		close(glevt.epfd);
+		glevt.epfd = 0;
+		return RETVAL_NEGATIVE;
+	}
+	pthread_detach(glevt.thread);
+	return RETVAL_OK;
+}
+
+
+/*
+ * Add file descriptor to the event thread,
+ * callback is executed when descriptor becomes readable
+ * [18/10/2026]
+ */
+int _evt_fd_add(fddef fd, evtfd_cb callback, void *arg) {
+	struct epoll_event	event;
+	struct evtfd_s		*evfd = NULL;
+	int					i, retstat = RETVAL_NEGATIVE;
+
+
+	pthread_mutex_lock(&glevt.lock);
+	if (_evt_start())
+		goto failed;
+
+	for (i = 0; i < ARRAY_SIZE(glevt.fds); i++) {
+		if (!glevt.fds[i].callback) {
+			evfd = &glevt.fds[i];
+			break;
+		}
+	}
+
+	if (!evfd) {
+		ERROR_LOGGER("Event thread can't service more than %u descriptors", EVT_FD_MAX)
+		goto failed;
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = evfd;
+	if (epoll_ctl(glevt.epfd, EPOLL_CTL_ADD, fd, &event)) {
+		ERROR_STD_LOGGER("epoll_ctl(%i, EPOLL_CTL_ADD)", fd)
+		goto failed;
+	}
+
+	evfd->fd = fd;
+	evfd->arg = arg;
+	evfd->callback = callback;
+	retstat = RETVAL_OK;
+
+
+	failed:
+	pthread_mutex_unlock(&glevt.lock);
+	return retstat;
+}
+
+
+/*
+ * Lock event thread, callbacks are not executed until unlocked
+ * [18/10/2026]
+ */
+void _evt_lock(void) {
+
+	pthread_mutex_lock(&glevt.lock);
+}
+
+
+/*
+ * Unlock event thread
+ * [18/10/2026]
+ */
+void _evt_unlock(void) {
+
+	pthread_mutex_unlock(&glevt.lock);
+}
+
+
+/*
+ * Change epoll events of the descriptor serviced by the event thread,
+ * e.g. EPOLLIN | EPOLLOUT while output is pending
+ * [18/10/2026]
+ */
+int _evt_fd_mod(fddef fd, uint32_t events) {
+	struct epoll_event	event;
+	int					i, retstat = RETVAL_NEGATIVE;
+
+
+	pthread_mutex_lock(&glevt.lock);
+	for (i = 0; i < ARRAY_SIZE(glevt.fds); i++) {
+		if (glevt.fds[i].callback && (glevt.fds[i].fd == fd)) {
+			memset(&event, 0, sizeof(event));
+			event.events = events;
+			event.data.ptr = &glevt.fds[i];
+			if (epoll_ctl(glevt.epfd, EPOLL_CTL_MOD, fd, &event)) {
+				ERROR_STD_LOGGER("epoll_ctl(%i, EPOLL_CTL_MOD, 0x%x)", fd, events)
+			}
+			else
+				retstat = RETVAL_OK;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&glevt.lock);
+	return retstat;
+}
+
+
+/*
+ * Remove file descriptor from the event thread,
+ * callback is not executed once this function returns
+ * [18/10/2026]
+ */
+int _evt_fd_del(fddef fd) {
+	int		i, retstat = RETVAL_NEGATIVE;
+
+
+	pthread_mutex_lock(&glevt.lock);
+	for (i = 0; i < ARRAY_SIZE(glevt.fds); i++) {
+		if (glevt.fds[i].callback && (glevt.fds[i].fd == fd)) {
+			if (epoll_ctl(glevt.epfd, EPOLL_CTL_DEL, fd, NULL)) {
+				ERROR_STD_LOGGER("epoll_ctl(%i, EPOLL_CTL_DEL)", fd)
+			}
+			else
+				retstat = RETVAL_OK;
+			memset(&glevt.fds[i], 0, sizeof(glevt.fds[i]));
+			break;
+		}
+	}
+	pthread_mutex_unlock(&glevt.lock);
+	return retstat;
+}
+
+
+/*
+ * Read line events of the handle and pass them to the consumers
+ * [18/10/2026]
+ */
+static void _evt_edge_read(fddef fd, uint32_t epevents, void *arg) {
+	struct handle_s				*lrhandle = arg;
+	struct gpio_v2_line_event	events[EVT_EDGE_BATCH];
+	struct evtedge_s			*consumer;
+	leiodcpin_e					lepin;
+	ssize_t						rdsize;
+	int							i, c;
+
+
+	while ((rdsize = read(fd, events, sizeof(events))) > 0) {
+		for (i = 0; i < (rdsize / sizeof(events[0])); i++) {
+			if (!(lepin = _cdev_offset_pin_get(lrhandle, events[i].offset)))
+				continue;
+			_history_edge(lepin, &events[i]);
+
+			for (c = 0; c < ARRAY_SIZE(glevt.edges); c++) {
+				consumer = &glevt.edges[c];
+				if ((consumer->lrhandle == lrhandle) &&
+						(consumer->pinmask & HANDLE_PIN_BIT(lrhandle, lepin)))
+					consumer->callback(lrhandle, lepin, &events[i], consumer->arg);
+			}
+		}
+
+		if (rdsize < sizeof(events))
+			break;
+	}
+}
+
+
+/*
+ * Enable edge detection on the handle lines and register consumer callback
+ * [18/10/2026]
+ */
+int _evt_edge_add(struct handle_s *lrhandle, __u32 pinmask, evtedge_cb callback, void *arg) {
+	struct evtedge_s	*consumer = NULL;
+	int					i, retstat = RETVAL_NEGATIVE;
+	int					flags, fdadded = 0;
+
+
+	pthread_mutex_lock(&glevt.lock);
+	for (i = 0; i < ARRAY_SIZE(glevt.edges); i++) {
+		if (glevt.edges[i].lrhandle == NULL) {
+			if (!consumer)
+				consumer = &glevt.edges[i];
+		}
+		else if ((glevt.edges[i].lrhandle == lrhandle) && (glevt.edges[i].pinmask & pinmask)) {
+			ERROR_LOGGER("GPIO line handle '%s' lines 0x%x already have edge event consumer",
+					lrhandle->name, glevt.edges[i].pinmask & pinmask)
+			goto failed;
+		}
+	}
+
+	if (!consumer) {
+		ERROR_LOGGER("Event thread can't service more than %u edge consumers", EVT_EDGE_MAX)
+		goto failed;
+	}
+
+	if (!lrhandle->edgemask) {
+		/*
+		 * First consumer of the handle, events are read by the event thread
+		 */
+		if (((flags = fcntl(lrhandle->fd, F_GETFL)) < 0) ||
+				fcntl(lrhandle->fd, F_SETFL, flags | O_NONBLOCK)) {
+			ERROR_STD_LOGGER("fcntl(%s, O_NONBLOCK)", lrhandle->name)
+			goto failed;
+		}
+
+		if (_evt_fd_add(lrhandle->fd, _evt_edge_read, lrhandle))
+			goto failed;
+		fdadded = 1;
+	}
+
+	if (_cdev_line_edge_set(lrhandle, lrhandle->edgemask | pinmask)) {
+		if (fdadded)
+			_evt_fd_del(lrhandle->fd);
+		goto failed;
+	}
+
+	consumer->pinmask = pinmask;
+	consumer->callback = callback;
+	consumer->arg = arg;
+	consumer->lrhandle = lrhandle;
+	retstat = RETVAL_OK;
+
+
+	failed:
+	pthread_mutex_unlock(&glevt.lock);
+	return retstat;
+}
+
+
+/*
+ * Disable edge detection on the handle lines and remove consumer
+ * [18/10/2026]
+ */
+int _evt_edge_del(struct handle_s *lrhandle, __u32 pinmask) {
+	int		i, retstat = RETVAL_OK;
+
+
+	pthread_mutex_lock(&glevt.lock);
+	for (i = 0; i < ARRAY_SIZE(glevt.edges); i++) {
+		if ((glevt.edges[i].lrhandle == lrhandle) && (glevt.edges[i].pinmask == pinmask)) {
+			memset(&glevt.edges[i], 0, sizeof(glevt.edges[i]));
+			break;
+		}
+	}
+
+	if (_cdev_line_edge_set(lrhandle, lrhandle->edgemask & ~pinmask))
+		retstat = RETVAL_NEGATIVE;
+
+	if (!lrhandle->edgemask)
+		_evt_fd_del(lrhandle->fd);
+
+	pthread_mutex_unlock(&glevt.lock);
+	return retstat;
+}
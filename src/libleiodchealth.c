@@ -0,0 +1,335 @@
+/*
+ ============================================================================
+ Name        : libleiodchealth.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC serial line health monitor. TIOCGICOUNT counters
+               of ports configured by the library are sampled by the event
+               thread, one ioctl per port per interval. Deltas and rates
+               are checked against thresholds, error bursts are correlated
+               with the interface mode to detect miswired RS485/RS422 pairs.
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  Configured ports are only recorded by the caller, pty check and
+  counter reset are done by the event thread at the next sample
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <linux/serial.h>	// serial port UAPI
+
+#include "libleiodcint.h"
+
+
+#define HEALTH_WIRING_MINRX		8				// Minimal characters in the interval to judge wiring
+
+
+/*
+ * Monitored port
+ */
+struct healthport_s {
+	fddef				fd;				// tty, 0 - port is not monitored
+	fddef				seenfd;			// Configured tty adopted by the event thread
+	uint8_t				primed;			// Reference counters are sampled
+	struct serial_icounter_struct icount;	// Counters of the previous sample
+	uint64_t			samplens;		// Time of the previous sample
+	leiodchealth_t		health;
+};
+
+
+static struct {
+	fddef				timerfd;		// Sampling timer, 0 - monitor is stopped
+	leiodchealthcfg_t	cfg;
+	struct healthport_s	ports[LEIODC_UART_COUNT];
+	fddef				configfd[LEIODC_UART_COUNT];	// tty last configured by the library
+} glhealth;
+
+
+
+
+/*
+ * Record port configured by the library, called on every UART
+ * configuration, doesn't lock or call the kernel. The event thread
+ * adds the port to the monitor at the next sample.
+ * [18/10/2026]
+ */
+void _health_port_set(uint8_t uartno, fddef fd) {
+
+	if ((uartno < LEIODC_UART_COUNT) && (__atomic_load_n(&glhealth.configfd[uartno], __ATOMIC_RELAXED) != fd))
+		__atomic_store_n(&glhealth.configfd[uartno], fd, __ATOMIC_RELAXED);
+}
+
+
+/*
+ * Adopt port configured since the last sample,
+ * counters are referenced at the next sample
+ * [18/10/2026]
+ */
+static void _health_port_adopt(uint8_t uartno) {
+	struct healthport_s	*port = &glhealth.ports[uartno];
+	fddef				fd = __atomic_load_n(&glhealth.configfd[uartno], __ATOMIC_RELAXED);
+
+
+	if (fd == port->seenfd)
+		return;
+
+	memset(port, 0, sizeof(*port));
+	port->seenfd = fd;
+	port->health.uartno = uartno;
+	if (fd && !_serial_is_pty(fd))
+		port->fd = fd;		// No line counters on pty
+}
+
+
+/*
+ * Add counter changes
+ * [18/10/2026]
+ */
+static void _health_delta(leiodchealthcnt_t *delta, leiodchealthcnt_t *total,
+		const struct serial_icounter_struct *now, const struct serial_icounter_struct *prev) {
+
+	delta->rx = (uint32_t) now->rx - (uint32_t) prev->rx;
+	delta->tx = (uint32_t) now->tx - (uint32_t) prev->tx;
+	delta->frame = (uint32_t) now->frame - (uint32_t) prev->frame;
+	delta->parity = (uint32_t) now->parity - (uint32_t) prev->parity;
+	delta->overrun = (uint32_t) now->overrun - (uint32_t) prev->overrun;
+	delta->brk = (uint32_t) now->brk - (uint32_t) prev->brk;
+	delta->bufoverrun = (uint32_t) now->buf_overrun - (uint32_t) prev->buf_overrun;
+
+	total->rx += delta->rx;
+	total->tx += delta->tx;
+	total->frame += delta->frame;
+	total->parity += delta->parity;
+	total->overrun += delta->overrun;
+	total->brk += delta->brk;
+	total->bufoverrun += delta->bufoverrun;
+}
+
+
+/*
+ * Sample counters of the port and check thresholds
+ * [18/10/2026]
+ */
+static void _health_sample(struct healthport_s *port, uint64_t nowns) {
+	leiodchealth_t					*health = &port->health;
+	struct serial_icounter_struct	icount;
+	uint32_t						errors, wiringmin;
+
+
+	memset(&icount, 0, sizeof(icount));
+	STATS_KCALL(lestatk_tty)
+	if (ioctl(port->fd, TIOCGICOUNT, &icount)) {
+		ERROR_STD_LOGGER("UART ioctl(%d, %s), COM%u is not monitored anymore",
+				port->fd, STRINGIFY_(TIOCGICOUNT), health->uartno + 1)
+		port->fd = 0;
+		health->flags = LEIODC_HEALTH_FAILED;
+		if (glhealth.cfg.callback)
+			glhealth.cfg.callback(health, glhealth.cfg.arg);
+		return;
+	}
+
+	if (!port->primed) {
+		port->icount = icount;
+		port->samplens = nowns;
+		port->primed = 1;
+		return;
+	}
+
+	_health_delta(&health->delta, &health->total, &icount, &port->icount);
+	port->icount = icount;
+	health->intervalns = nowns - port->samplens;
+	port->samplens = nowns;
+	health->interface = _state_uart_get(health->uartno);
+
+	errors = health->delta.frame + health->delta.parity + health->delta.overrun +
+			health->delta.brk + health->delta.bufoverrun;
+	if (health->intervalns) {
+		health->rxrate = ((uint64_t) health->delta.rx * SECINNSEC) / health->intervalns;
+		health->errrate = ((uint64_t) errors * SECINNSEC) / health->intervalns;
+	}
+	health->errppm = (health->delta.rx) ? (((uint64_t) errors * 1000000) / health->delta.rx) : 0;
+
+	health->flags = 0;
+	if (errors && (errors >= glhealth.cfg.errthreshold))
+		health->flags |= LEIODC_HEALTH_ERRORS;
+	if (glhealth.cfg.ppmthreshold && (health->errppm >= glhealth.cfg.ppmthreshold))
+		health->flags |= LEIODC_HEALTH_RATE;
+
+	/*
+	 * Inverted differential pair makes most characters arrive with
+	 * framing or parity errors, line idles in break condition
+	 */
+	switch (health->interface) {
+	case leuart_RS485def:
+	case leuart_RS485rev:
+	case leuart_RS422def:
+	case leuart_RS422rev:
+		if ((health->delta.rx >= HEALTH_WIRING_MINRX) &&
+				((health->delta.frame + health->delta.parity + health->delta.brk) >= (health->delta.rx / 2)))
+			health->wiring++;
+		else
+			health->wiring = 0;
+		break;
+
+	default:
+		health->wiring = 0;
+		break;
+	}
+
+	wiringmin = (glhealth.cfg.wiringintervals) ? glhealth.cfg.wiringintervals : LEIODC_HEALTH_WIRING_DEFAULT;
+	if (health->wiring >= wiringmin)
+		health->flags |= LEIODC_HEALTH_WIRING;
+
+	if (health->flags && glhealth.cfg.callback)
+		glhealth.cfg.callback(health, glhealth.cfg.arg);
+}
+
+
+/*
+ * Sampling timer expired
+ * [18/10/2026]
+ */
+static void _health_timer(fddef fd, uint32_t events, void *arg) {
+	nanotime_t		now;
+	uint64_t		expirations, nowns;
+	int				i;
+
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	nowns = ((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec;
+	for (i = 0; i < LEIODC_UART_COUNT; i++) {
+		_health_port_adopt(i);
+		if (glhealth.ports[i].fd)
+			_health_sample(&glhealth.ports[i], nowns);
+	}
+}
+
+
+/*
+ * Start serial line health monitor, ports configured by leiodc_uart_int(),
+ * leiodc_uart_int_all() and leiodc_serial_config() are sampled
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_health_start(const leiodchealthcfg_t *healthcfg) {
+	struct itimerspec	tspec;
+	uint32_t			intervalms;
+	int					i, retstat = RETVAL_NEGATIVE;
+
+
+	_evt_lock();
+	if (glhealth.timerfd) {
+		ERROR_LOGGER("Serial line health monitor is already running")
+		goto failed;
+	}
+
+	if (healthcfg)
+		glhealth.cfg = *healthcfg;
+	else
+		memset(&glhealth.cfg, 0, sizeof(glhealth.cfg));
+	intervalms = (glhealth.cfg.intervalms) ? glhealth.cfg.intervalms : LEIODC_HEALTH_INTERVAL_DEFAULT;
+
+	for (i = 0; i < LEIODC_UART_COUNT; i++)
+		glhealth.ports[i].primed = 0;
+
+	if ((glhealth.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("timerfd_create()")
+		glhealth.timerfd = 0;
+		goto failed;
+	}
+
+	if (_evt_fd_add(glhealth.timerfd, _health_timer, NULL))
+		goto release;
+
+	/*
+	 * First expiration references the counters
+	 */
+	tspec.it_interval.tv_sec = intervalms / 1000;
+	tspec.it_interval.tv_nsec = (intervalms % 1000) * 1000000;
+	tspec.it_value.tv_sec = 0;
+	tspec.it_value.tv_nsec = 1;
+	if (timerfd_settime(glhealth.timerfd, 0, &tspec, NULL)) {
+		ERROR_STD_LOGGER("timerfd_settime(%u ms)", intervalms)
+		_evt_fd_del(glhealth.timerfd);
+		goto release;
+	}
+	retstat = RETVAL_OK;
+	goto failed;
+
+
+	release:
+	close(glhealth.timerfd);
+	glhealth.timerfd = 0;
+
+	failed:
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_health_start)
+
+
+/*
+ * Stop serial line health monitor,
+ * callback is not executed once this function returns
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_health_stop(void) {
+	int		retstat = RETVAL_OK;
+
+
+	_evt_lock();
+	if (glhealth.timerfd) {
+		if (_evt_fd_del(glhealth.timerfd))
+			retstat = RETVAL_NEGATIVE;
+		close(glhealth.timerfd);
+		glhealth.timerfd = 0;
+	}
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_health_stop)
+
+
+/*
+ * Get health of the port sampled in the last interval
+ * Return -1 if port is not monitored
+ * [18/10/2026]
+ */
+int leiodc_health_get(uint8_t uartno, leiodchealth_t *health) {
+	int		retstat = RETVAL_OK;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	*health = glhealth.ports[uartno].health;
+	if (!glhealth.ports[uartno].fd && !(health->flags & LEIODC_HEALTH_FAILED)) {
+		ERROR_LOGGER("COM%u is not configured by the library, health is not monitored", uartno + 1)
+		retstat = RETVAL_NEGATIVE;
+	}
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_health_get)
@@ -0,0 +1,628 @@
+/*
+ ============================================================================
+ Name        : libleiodchistory.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC pin history recorder. Pin, UART mode and optionally
+               input edge changes are encoded as compact records to a memory
+               mapped ring file. Records store only changes, time as delta
+               from the previous record and toggle runs are collapsed to one
+               record updated in place. Every block starts with a state
+               snapshot and decodes on its own. Written blocks are flushed
+               in batches to reduce flash writes.
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  Recorder lock is a priority inheritance mutex
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#define _GNU_SOURCE			// sync_file_range()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <fcntl.h>			// File controls
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+#include "libleiodcint.h"
+
+
+#define HISTORY_FILESIZE_DEFAULT	(256 * 1024)
+#define HISTORY_FLUSH_DEFAULT		10000		// Flush interval (ms)
+#define HISTORY_BLOCKS_MIN			4
+#define HISTORY_RECORD_MAX			16			// Longest record (bytes)
+#define HISTORY_REPEAT_SIZE			7			// byte0, toggles, time
+
+#define HISTORY_CLASS_OUTPUT		1			// Toggle run classes
+#define HISTORY_CLASS_EDGE			2
+
+_Static_assert(lepin_count <= 32, "History snapshot bitmaps are 32-bit");
+
+
+static struct {
+	pthread_mutex_t		lock;
+	uint8_t				*map;			// NULL - recorder is stopped
+	size_t				mapsize;
+	fddef				fd;
+	fddef				timerfd;
+	uint32_t			flags;
+	uint32_t			blocks;
+	uint32_t			block;			// Current block index
+	uint32_t			seq;			// Sequence of the current block
+	uint32_t			dirty;			// Blocks written since the last flush
+	uint32_t			dirtyfirst;		// First block written since the last flush
+	uint64_t			lastus;			// CLOCK_MONOTONIC time of the last record (us)
+	uint32_t			values;			// Current state
+	uint32_t			outputs;
+	uint32_t			inputs;
+	uint8_t				uartint[LEIODC_UART_COUNT];
+	struct {
+		uint8_t			pin;			// Pin of the last record, 0 - no run possible
+		uint8_t			cls;			// HISTORY_CLASS_xxx of the last record
+		uint8_t			level;			// Level after the last record
+		uint16_t		repoff;			// Offset of the REPEAT record, 0 - last record is not REPEAT
+		uint64_t		startus;		// Time of the record before the toggles
+	} run;
+} glhistory = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+
+
+
+/*
+ * Library initialization constructor
+ * [18/10/2026]
+ */
+static void LELIBCONSTRUCTOR _history_init(void) {
+
+	_rt_mutex_init(&glhistory.lock);
+}
+
+
+/*
+ * Current block header
+ * [18/10/2026]
+ */
+static inline leiodchistblock_t *_history_block(void) {
+
+	return (leiodchistblock_t *) (glhistory.map + ((glhistory.block + 1) * LEIODC_HISTORY_BLOCK_SIZE));
+}
+
+
+/*
+ * Start next block with the state snapshot
+ * [18/10/2026]
+ */
+static void _history_block_next(uint64_t nowus) {
+	leiodchistblock_t	*blk;
+	nanotime_t			now;
+
+
+	if (glhistory.seq) {
+		if (++glhistory.block >= glhistory.blocks)
+			glhistory.block = 0;
+	}
+	glhistory.seq++;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	blk = _history_block();
+	blk->magic = 0;			// Block is not valid until header is complete
+	blk->seq = glhistory.seq;
+	blk->basens = ((int64_t) now.tv_sec * SECINNSEC) + now.tv_nsec;
+	blk->values = glhistory.values;
+	blk->outputs = glhistory.outputs;
+	blk->inputs = glhistory.inputs;
+	blk->used = 0;
+	memcpy(blk->uartint, glhistory.uartint, sizeof(blk->uartint));
+	blk->pad = 0;
+	__atomic_store_n(&blk->magic, LEIODC_HISTORY_BLOCK_MAGIC, __ATOMIC_RELEASE);
+
+	glhistory.lastus = nowus;
+	memset(&glhistory.run, 0, sizeof(glhistory.run));
+
+	if (!glhistory.dirty++)
+		glhistory.dirtyfirst = glhistory.block;
+}
+
+
+/*
+ * Append record, time is encoded as delta from the previous one
+ * [18/10/2026]
+ */
+static void _history_put(uint8_t type, uint8_t arg, uint64_t nowus, const uint8_t *extra, uint32_t extralen) {
+	leiodchistblock_t	*blk = _history_block();
+	uint8_t				*wr;
+	uint64_t			delta;
+
+
+	if ((blk->used + HISTORY_RECORD_MAX) > (LEIODC_HISTORY_BLOCK_SIZE - sizeof(*blk))) {
+		_history_block_next(nowus);
+		blk = _history_block();
+	}
+
+	wr = (uint8_t *) (blk + 1) + blk->used;
+	delta = (nowus > glhistory.lastus) ? nowus - glhistory.lastus : 0;
+	*wr++ = (type << 5) | (arg & 0x1F);
+	do {
+		*wr = delta & 0x7F;
+		if ((delta >>= 7))
+			*wr |= 0x80;
+		wr++;
+	} while (delta);
+
+	if (extralen) {
+		memcpy(wr, extra, extralen);
+		wr += extralen;
+	}
+
+	glhistory.lastus = (nowus > glhistory.lastus) ? nowus : glhistory.lastus;
+	glhistory.run.pin = 0;
+	glhistory.run.repoff = 0;
+	blk->used = wr - (uint8_t *) (blk + 1);
+}
+
+
+/*
+ * Record level change of the pin, toggle runs are collapsed
+ * [18/10/2026]
+ */
+static void _history_level(uint8_t type, leiodcpin lepin, uint8_t cls, uint8_t level, uint64_t nowus) {
+	leiodchistblock_t	*blk = _history_block();
+	uint8_t				*rec;
+	uint16_t			toggles;
+	uint32_t			runus;
+
+
+	if ((glhistory.run.pin == lepin) && (glhistory.run.cls == cls) && (glhistory.run.level != level)) {
+		if (glhistory.run.repoff) {
+			rec = (uint8_t *) (blk + 1) + glhistory.run.repoff;
+			memcpy(&toggles, rec + 1, sizeof(toggles));
+			if ((toggles < UINT16_MAX) && ((nowus - glhistory.run.startus) <= UINT32_MAX)) {
+				toggles++;
+				runus = nowus - glhistory.run.startus;
+				memcpy(rec + 1, &toggles, sizeof(toggles));
+				memcpy(rec + 1 + sizeof(toggles), &runus, sizeof(runus));
+				glhistory.run.level = level;
+				glhistory.lastus = nowus;
+				return;
+			}
+		}
+		else if ((blk->used + HISTORY_REPEAT_SIZE) <= (LEIODC_HISTORY_BLOCK_SIZE - sizeof(*blk)) &&
+				((nowus - glhistory.lastus) <= UINT32_MAX)) {
+			rec = (uint8_t *) (blk + 1) + blk->used;
+			toggles = 1;
+			runus = nowus - glhistory.lastus;
+			rec[0] = (LEIODC_HREC_REPEAT << 5) | lepin;
+			memcpy(rec + 1, &toggles, sizeof(toggles));
+			memcpy(rec + 1 + sizeof(toggles), &runus, sizeof(runus));
+			glhistory.run.repoff = blk->used;
+			glhistory.run.startus = glhistory.lastus;
+			glhistory.run.level = level;
+			glhistory.lastus = nowus;
+			blk->used += HISTORY_REPEAT_SIZE;
+			return;
+		}
+	}
+
+	_history_put(type, lepin, nowus, NULL, 0);
+	glhistory.run.pin = lepin;
+	glhistory.run.cls = cls;
+	glhistory.run.level = level;
+}
+
+
+/*
+ * Monotonic time (us)
+ * [18/10/2026]
+ */
+static inline uint64_t _history_now(void) {
+	nanotime_t		now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+
+/*
+ * Record pin change, only changes of the recorded state are written
+ * [18/10/2026]
+ */
+static void _history_pin_locked(leiodcpin lepin, leiodcpindir_e dir, int value, uint64_t nowus) {
+	uint32_t		pbit = (uint32_t) 1 << lepin;
+
+
+	if (dir == lepindir_in) {
+		if (!(glhistory.inputs & pbit)) {
+			glhistory.inputs |= pbit;
+			glhistory.outputs &= ~pbit;
+			_history_put(LEIODC_HREC_INPUT, lepin, nowus, NULL, 0);
+		}
+		return;
+	}
+
+	if ((value == LEIODC_STATE_UNKNOWN) || ((dir != lepindir_out) && !(glhistory.outputs & pbit)))
+		return;		// Values read from inputs are not changes made by the library
+
+	if ((glhistory.outputs & pbit) && (BOOL_CHECK(glhistory.values & pbit) == BOOL_CHECK(value)))
+		return;
+
+	glhistory.outputs |= pbit;
+	glhistory.inputs &= ~pbit;
+	if (value)
+		glhistory.values |= pbit;
+	else
+		glhistory.values &= ~pbit;
+	_history_level((value) ? LEIODC_HREC_HIGH : LEIODC_HREC_LOW, lepin, HISTORY_CLASS_OUTPUT, BOOL_CHECK(value), nowus);
+}
+
+
+/*
+ * Record changes of the handle lines
+ * dir - lepindir_unknown if direction is not changed
+ * [18/10/2026]
+ */
+void _history_lines(struct handle_s *lrhandle, __u32 linemask, __u32 values, leiodcpindir_e dir) {
+	leiodcpin_e		lepin;
+	uint64_t		nowus;
+
+
+	if (!__atomic_load_n(&glhistory.map, __ATOMIC_RELAXED))
+		return;
+
+	nowus = _history_now();
+	pthread_mutex_lock(&glhistory.lock);
+	if (glhistory.map) {
+		for (lepin = lrhandle->minp; lepin <= lrhandle->maxp; lepin++) {
+			if (linemask & HANDLE_PIN_BIT(lrhandle, lepin))
+				_history_pin_locked(lepin, dir, BOOL_CHECK(values & HANDLE_PIN_BIT(lrhandle, lepin)), nowus);
+		}
+	}
+	pthread_mutex_unlock(&glhistory.lock);
+}
+
+
+/*
+ * Record change of a single pin
+ * value - LEIODC_STATE_UNKNOWN if not known
+ * [18/10/2026]
+ */
+void _history_pin(leiodcpin lepin, leiodcpindir_e dir, int value) {
+	uint64_t		nowus;
+
+
+	if (!__atomic_load_n(&glhistory.map, __ATOMIC_RELAXED) || (lepin >= lepin_count))
+		return;
+
+	nowus = _history_now();
+	pthread_mutex_lock(&glhistory.lock);
+	if (glhistory.map)
+		_history_pin_locked(lepin, dir, value, nowus);
+	pthread_mutex_unlock(&glhistory.lock);
+}
+
+
+/*
+ * Record UART interface mode change
+ * [18/10/2026]
+ */
+void _history_uart(uint8_t uartno, uint8_t interface) {
+	uint64_t		nowus;
+
+
+	if (!__atomic_load_n(&glhistory.map, __ATOMIC_RELAXED) || (uartno >= LEIODC_UART_COUNT))
+		return;
+
+	nowus = _history_now();
+	pthread_mutex_lock(&glhistory.lock);
+	if (glhistory.map && (glhistory.uartint[uartno] != interface)) {
+		glhistory.uartint[uartno] = interface;
+		_history_put(LEIODC_HREC_UART, uartno, nowus, &interface, 1);
+	}
+	pthread_mutex_unlock(&glhistory.lock);
+}
+
+
+/*
+ * Record M.2 card config or board version
+ * [18/10/2026]
+ */
+void _history_ext(uint8_t ext, int value) {
+	uint64_t		nowus;
+	uint8_t			vbyte = value;
+
+
+	if (!__atomic_load_n(&glhistory.map, __ATOMIC_RELAXED) || (value < 0))
+		return;
+
+	nowus = _history_now();
+	pthread_mutex_lock(&glhistory.lock);
+	if (glhistory.map)
+		_history_put(LEIODC_HREC_EXT, ext, nowus, &vbyte, 1);
+	pthread_mutex_unlock(&glhistory.lock);
+}
+
+
+/*
+ * Record input edge, executed by the event thread
+ * [18/10/2026]
+ */
+void _history_edge(leiodcpin lepin, const struct gpio_v2_line_event *event) {
+	uint8_t		rising = (event->id == GPIO_V2_LINE_EVENT_RISING_EDGE);
+
+
+	if (!(__atomic_load_n(&glhistory.flags, __ATOMIC_RELAXED) & LEIODC_HISTORY_EDGES))
+		return;
+
+	pthread_mutex_lock(&glhistory.lock);
+	if (glhistory.map)
+		_history_level((rising) ? LEIODC_HREC_RISE : LEIODC_HREC_FALL, lepin, HISTORY_CLASS_EDGE,
+				rising, event->timestamp_ns / 1000);
+	pthread_mutex_unlock(&glhistory.lock);
+}
+
+
+/*
+ * Start writeback of the blocks written since the last flush
+ * [18/10/2026]
+ */
+static void _history_flush(void) {
+	uint32_t	first, count;
+
+
+	if (!glhistory.dirty)
+		return;
+
+	first = glhistory.dirtyfirst;
+	count = (glhistory.dirty < glhistory.blocks) ? glhistory.dirty : glhistory.blocks;
+	if ((first + count) > glhistory.blocks) {
+		/*
+		 * Wrapped, flush the beginning separately
+		 */
+		sync_file_range(glhistory.fd, LEIODC_HISTORY_BLOCK_SIZE,
+				(first + count - glhistory.blocks) * LEIODC_HISTORY_BLOCK_SIZE, SYNC_FILE_RANGE_WRITE);
+		count = glhistory.blocks - first;
+	}
+	sync_file_range(glhistory.fd, (first + 1) * LEIODC_HISTORY_BLOCK_SIZE,
+			count * LEIODC_HISTORY_BLOCK_SIZE, SYNC_FILE_RANGE_WRITE);
+
+	/*
+	 * Current block stays dirty, it is written again
+	 */
+	glhistory.dirty = 1;
+	glhistory.dirtyfirst = glhistory.block;
+}
+
+
+/*
+ * Flush timer expired
+ * [18/10/2026]
+ */
+static void _history_timer(fddef fd, uint32_t events, void *arg) {
+	uint64_t		expirations;
+
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return;
+
+	pthread_mutex_lock(&glhistory.lock);
+	if (glhistory.map)
+		_history_flush();
+	pthread_mutex_unlock(&glhistory.lock);
+}
+
+
+/*
+ * Open ring file, existing file with the same geometry is continued
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _history_file_open(const lechar *path, uint32_t blocks) {
+	leiodchistfile_t	*hdr;
+	leiodchistblock_t	*blk;
+	struct stat			filestat;
+	size_t				size = (size_t) (blocks + 1) * LEIODC_HISTORY_BLOCK_SIZE;
+	uint32_t			i;
+	int					err;
+
+
+	if ((glhistory.fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0) {
+		ERROR_STD_LOGGER("open(%s)", path)
+		glhistory.fd = 0;
+		return RETVAL_NEGATIVE;
+	}
+
+	if (fstat(glhistory.fd, &filestat) || (filestat.st_size != size)) {
+		if (ftruncate(glhistory.fd, 0) || ftruncate(glhistory.fd, size)) {
+			ERROR_STD_LOGGER("ftruncate(%s, %zu)", path, size)
+			goto failed;
+		}
+
+		/*
+		 * Blocks are allocated now, no ENOSPC when writing history
+		 */
+		if ((err = posix_fallocate(glhistory.fd, 0, size))) {
+			ERROR_LOGGER("posix_fallocate(%s, %zu): %s", path, size, strerror(err))
+			goto failed;
+		}
+	}
+
+	if ((glhistory.map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			glhistory.fd, 0)) == MAP_FAILED) {
+		ERROR_STD_LOGGER("mmap(%s, %zu)", path, size)
+		glhistory.map = NULL;
+		goto failed;
+	}
+	glhistory.mapsize = size;
+	glhistory.blocks = blocks;
+
+	hdr = (leiodchistfile_t *) glhistory.map;
+	if ((hdr->magic == LEIODC_HISTORY_MAGIC) && (hdr->version == LEIODC_HISTORY_VERSION) &&
+			(hdr->blocksize == LEIODC_HISTORY_BLOCK_SIZE) && (hdr->blocks == blocks)) {
+		/*
+		 * Continue after the latest block
+		 */
+		for (i = 0; i < blocks; i++) {
+			blk = (leiodchistblock_t *) (glhistory.map + ((i + 1) * LEIODC_HISTORY_BLOCK_SIZE));
+			if ((blk->magic == LEIODC_HISTORY_BLOCK_MAGIC) && (blk->seq > glhistory.seq)) {
+				glhistory.seq = blk->seq;
+				glhistory.block = i;
+			}
+		}
+	}
+	else {
+		memset(glhistory.map, 0, size);
+		hdr->version = LEIODC_HISTORY_VERSION;
+		hdr->blocksize = LEIODC_HISTORY_BLOCK_SIZE;
+		hdr->blocks = blocks;
+		hdr->magic = LEIODC_HISTORY_MAGIC;
+	}
+	return RETVAL_OK;
+
+
+	failed:
+	close(glhistory.fd);
+	glhistory.fd = 0;
+	return RETVAL_NEGATIVE;
+}
+
+
+/*
+ * Start recording pin history, current state of the pins
+ * set by this process is the snapshot of the first block
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_history_start(const leiodchistorycfg_t *historycfg) {
+	struct itimerspec	tspec;
+	uint32_t			filesize, flushms, blocks;
+	leiodcpin_e			lepin;
+	leiodcstate_t		state;
+	int					i;
+
+
+	if (!historycfg || !historycfg->path) {
+		ERROR_LOGGER("History file is not specified")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (glhistory.map) {
+		ERROR_LOGGER("Pin history recorder is already running")
+		return RETVAL_NEGATIVE;
+	}
+
+	filesize = (historycfg->filesize) ? historycfg->filesize : HISTORY_FILESIZE_DEFAULT;
+	flushms = (historycfg->flushms) ? historycfg->flushms : HISTORY_FLUSH_DEFAULT;
+	if ((blocks = (filesize / LEIODC_HISTORY_BLOCK_SIZE) - 1) < HISTORY_BLOCKS_MIN) {
+		ERROR_LOGGER("History file size %u is too small, minimum %u", filesize,
+				(HISTORY_BLOCKS_MIN + 1) * LEIODC_HISTORY_BLOCK_SIZE)
+		return RETVAL_NEGATIVE;
+	}
+
+	if ((glhistory.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("timerfd_create()")
+		glhistory.timerfd = 0;
+		return RETVAL_NEGATIVE;
+	}
+
+	pthread_mutex_lock(&glhistory.lock);
+	glhistory.seq = 0;
+	glhistory.block = 0;
+	glhistory.dirty = 0;
+	if (_history_file_open(historycfg->path, blocks))
+		goto failed;
+
+	/*
+	 * Snapshot of the state mirror
+	 */
+	leiodc_state_read(&state);
+	glhistory.values = glhistory.outputs = glhistory.inputs = 0;
+	for (lepin = 1; lepin < lepin_count; lepin++) {
+		if (state.pins[lepin].dir == lepindir_out)
+			glhistory.outputs |= (uint32_t) 1 << lepin;
+		else if (state.pins[lepin].dir == lepindir_in)
+			glhistory.inputs |= (uint32_t) 1 << lepin;
+		if (state.pins[lepin].value == 1)
+			glhistory.values |= (uint32_t) 1 << lepin;
+	}
+	for (i = 0; i < LEIODC_UART_COUNT; i++)
+		glhistory.uartint[i] = state.uartint[i];
+	_history_block_next(_history_now());
+	glhistory.flags = historycfg->flags;
+	pthread_mutex_unlock(&glhistory.lock);
+
+	if (_evt_fd_add(glhistory.timerfd, _history_timer, NULL))
+		goto stop;
+
+	tspec.it_interval.tv_sec = flushms / 1000;
+	tspec.it_interval.tv_nsec = (flushms % 1000) * MSECINNSEC;
+	tspec.it_value = tspec.it_interval;
+	if (timerfd_settime(glhistory.timerfd, 0, &tspec, NULL)) {
+		ERROR_STD_LOGGER("timerfd_settime(%u ms)", flushms)
+		goto stop;
+	}
+	return RETVAL_OK;
+
+
+	stop:
+	leiodc_history_stop();
+	return RETVAL_NEGATIVE;
+
+	failed:
+	pthread_mutex_unlock(&glhistory.lock);
+	close(glhistory.timerfd);
+	glhistory.timerfd = 0;
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_history_start)
+
+
+/*
+ * Stop recording, history is written to the file
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_history_stop(void) {
+	int		retstat = RETVAL_OK;
+
+
+	if (!glhistory.map)
+		return RETVAL_OK;
+
+	if (glhistory.timerfd) {
+		_evt_fd_del(glhistory.timerfd);
+		close(glhistory.timerfd);
+		glhistory.timerfd = 0;
+	}
+
+	pthread_mutex_lock(&glhistory.lock);
+	glhistory.flags = 0;
+	if (msync(glhistory.map, glhistory.mapsize, MS_SYNC)) {
+		ERROR_STD_LOGGER("msync(history)")
+		retstat = RETVAL_NEGATIVE;
+	}
+	munmap(glhistory.map, glhistory.mapsize);
+	__atomic_store_n(&glhistory.map, NULL, __ATOMIC_RELAXED);
+	if (close(glhistory.fd)) {
+		ERROR_STD_LOGGER("close(history)")
+		retstat = RETVAL_NEGATIVE;
+	}
+	glhistory.fd = 0;
+	pthread_mutex_unlock(&glhistory.lock);
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_history_stop)
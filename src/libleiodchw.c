@@ -2,12 +2,113 @@
  ============================================================================
  Name        : libleiodchw.c
  Author      : AK
- Version     : V3.00
+ Version     : V3.28
  Copyright   : Property of Londelec UK Ltd
  Description : LEIODC CPU pin control and serial interface configuration library
 
   Change log :
 
+  *********V3.28 18/10/2026**************
+  leiodc_uart_int_all() rejects missing interface table
+
+  *********V3.27 18/10/2026**************
+  leiodc_uart_int_get() ignores TX enable line of RS485 modes (raised by
+  RTS on send or userspace direction control) and reports 0 if all
+  control lines are low
+
+  *********V3.26 18/10/2026**************
+  Minor version bumped to match the header (V3.26), it was not bumped with
+  the functions added in V3.11, V3.12, V3.14, V3.15, V3.18 and V3.21 of the
+  header, library version is bumped together with the header from now on
+
+  *********V3.24 18/10/2026**************
+  Non-RS485 interface modes disable RS485 of the supplied tty,
+  leiodc_uart_int_get() reported an error after switching from RS485
+
+  *********V3.23 18/10/2026**************
+  Interface mode 0 passed to leiodc_uart_int() drives all UART control lines
+  low again (as before V3.07), it was ignored since modes of all UARTs are set in one step
+
+  *********V3.22 18/10/2026**************
+  Board version line handle is shared with the input sampler,
+  lines are requested once while any user holds the handle
+
+  *********V3.21 18/10/2026**************
+  UART cache invalidation of handle lines shared with the output sequence player
+
+  *********V3.20 18/10/2026**************
+  UART tty is recorded for the health monitor after RS485 settings are applied
+
+  *********V3.19 18/10/2026**************
+  Error strings are not formatted and UART GPIOs are not initialized
+  lazily in deterministic real-time mode (libleiodcrt.c)
+
+  *********V3.18 18/10/2026**************
+  Pin and UART interface GPIO operations are queued to the I/O thread
+  if the I/O actor is running (libleiodcactor.c)
+
+  *********V3.17 18/10/2026**************
+  ioctl() and sysfs calls are recorded by the kernel call flight recorder,
+  recorded calls can be replayed (libleiodcktrace.c)
+
+  *********V3.16 18/10/2026**************
+  GPIO line handle outside the handle table can be requested (input sampler)
+
+  *********V3.15 18/10/2026**************
+  Larger kernel line event buffer requested for pulse counting
+
+  *********V3.14 18/10/2026**************
+  Emergency safe-state payloads are rebuilt when edge detection lines change
+
+  *********V3.13 18/10/2026**************
+  Output values of several lines can be set with one ioctl
+
+  *********V3.12 18/10/2026**************
+  UART configured with tty descriptor is added to the serial line health monitor
+
+  *********V3.11 18/10/2026**************
+  RS485 setup is skipped on pseudo-terminals
+
+  *********V3.10 18/10/2026**************
+  cdev GPIO chip path can be overridden by LEIODC_GPIO_CHIP environment variable
+  RS485 transmitter enable pin lookup for userspace direction control
+
+  *********V3.09 18/10/2026**************
+  RS485 addressing flags are set only if requested by the serial port setup,
+  addressing support of the kernel is checked
+
+  *********V3.08 18/10/2026**************
+  RS485 RTS delays can be supplied by the serial port setup (libleiodcserial.c)
+
+  *********V3.07 18/10/2026**************
+  Interface modes of all UARTs can be set in one step,
+  control lines are changed with a single ioctl()
+
+  *********V3.06 18/10/2026**************
+  Applied UART interface modes are cached, redundant GPIO
+  and RS485 reconfiguration is skipped
+  UART interface mode read-back function created
+
+  *********V3.05 18/10/2026**************
+  Pin state mirror is updated after every successful
+  pin, UART, M.2 config and board version operation (libleiodcstate.c)
+
+  *********V3.04 18/10/2026**************
+  GPIO broker client mode, pin operations are forwarded
+  to the broker daemon if it is running (libleiodcbroker.c)
+  UART GPIO and RS485 settings split to separate functions
+
+  *********V3.03 18/10/2026**************
+  USDT probes on every ioctl() and sysfs open/write (libleiodcprobe.c)
+
+  *********V3.02 18/10/2026**************
+  API calls, kernel calls and errors are counted (libleiodcstats.c)
+
+  *********V3.01 18/10/2026**************
+  Definitions shared with new source files moved to libleiodcint.h
+  Edge detection lines of the handle are preserved when setting line config
+  M.2 card config change watch created (libleiodcm2.c)
+
   *********V3.00 26/01/2024**************
   M.2 card config pins defined, new API to read card config as a byte
   MB board version pins defined, new API to read Board version as a byte
@@ -35,16 +136,20 @@
 #include <errno.h>			// Error number
 #include <fcntl.h>			// File controls
 #include <unistd.h>			// getcwd, access
+#include <pthread.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>		// Open function constants
 #include <linux/gpio.h>		// cdev GPIO UAPI
 #include <linux/serial.h>	// serial port UAPI
 
-#include "libleiodchw.h"
+#include "libleiodcint.h"
 
 
 #define	LIBVERSION_MAJOR		3
-#define	LIBVERSION_MINOR		0
+#define	LIBVERSION_MINOR		28
+#if ((LIBVERSION_MAJOR * 100) + LIBVERSION_MINOR) != LEIODC_LIBVERSION
+#error "Library version must be bumped together with LEIODC_LIBVERSION of the header"
+#endif
 #if LIBVERSION_MINOR < 10
 #define	LIBVERSION_10TH_ZERO	"0"
 #else
@@ -66,16 +171,9 @@ const lechar *libleiodcVersion = " libleiodcVersion="\
 //#define DEBUG_LINUX_SERIAL
 #endif
 
-/*
- * GPIO char dev constants
- */
-#define	GPIO_CDEV_CHIP		"/dev/gpiochip"		// Path of the gpio chip device
-
 /*
  * GPIO sysfs constants
  */
-#define GPIO_PATH_LENGTH	256					// Length of the gpio directory name
-#define	GPIO_SYSFS_DIR		"/sys/class/gpio/"	// Path of the gpio sysfs directory
 #define	GPIO_DIR_PREF		"gpio"				// gpio name prefix
 #define	GPIO_EXPORT			"export"			// gpio export file
 #define	GPIO_DIRECTION		"/direction"		// gpio direction file
@@ -85,14 +183,6 @@ const lechar *libleiodcVersion = " libleiodcVersion="\
 #define	GPIO_HIGH			"high"				// gpio direction out and high value
 #define	GPIO_LOW			"low"				// gpio direction out and low value
 
-#define __EXPORT_SYMBOL(sym, sec) \
-	extern typeof(sym) sym;
-
-#define EXPORT_SYMBOL(sym)		__EXPORT_SYMBOL(sym, "")
-
-#define	RETVAL_OK			0
-#define	RETVAL_NEGATIVE		-1
-
 
 /*
  * Linux kernel structure
@@ -122,19 +212,12 @@ static const lechar *gpiodirection = GPIO_DIRECTION;
 static const lechar *sloginvalidpin = "GPIO pad is not mapped for the requested lepin[%u]";
 static const lechar *sloghandle0 = "GPIO line handle '%s' is not initialized";
 static const lechar *sloginvalidmode = "Internal error GPIO access mode=%u is not implemented";
+static const lechar *slogedgeline = "GPIO line handle '%s' lines 0x%x are used for edge detection";
 static const lechar *slognogpiochip = "Upgrade kernel/OS in order to %s (" GPIO_CDEV_CHIP " not found)";
-lechar LibErrorString[512];
+lechar LibErrorString[LIB_ERROR_STRING_LENGTH];
 
 
-/*
- * GPIO access modes
- */
-typedef enum {
-	mode_none = 0,
-	mode_sysfs,
-	mode_cdev,
-} libmode_e;
-static libmode_e libmode;
+libmode_e libmode;
 
 
 /*
@@ -230,25 +313,26 @@ static const struct {
 	[leuart_RS422def] = {{0, 1, 1, 0, 0}},
 	[leuart_RS422rev] = {{0, 0, 0, 1, 1}},
 };
+#define UART_INT_RS485(minterface) (((minterface) == leuart_RS485def) || ((minterface) == leuart_RS485rev))
+#define UART_INT_MODE(minterface) (((minterface) == UART_INT_OFF) ? 0 : (minterface))	// UartoeTable index
+#define UART_TXEN_INDEX(minterface) (((minterface) == leuart_RS485rev) ? 4 : 2)		// RS485 TX enable in UartpinTable
 
 
 /*
- * cdev GPIO handle types
+ * Interface modes applied to UARTs, used to skip redundant reconfiguration.
+ * GPIO modes are cached only in cdev mode because line requests are exclusive.
  */
-enum {
-	handle_uart = 0,
-	handle_modem,
-	handle_heartbeat,
-	handle_count		/* Number of handles, must be the last */
-};
+static struct {
+	uint8_t			interface;		// leiodcuartint_e applied to GPIOs, 0 - unknown
+	uint8_t			rs485int;		// leiodcuartint_e applied to RS485 settings, UART_INT_OFF - disabled, 0 - unknown
+	fddef			rs485fd;		// tty descriptor RS485 settings applied to
+} gluartcache[LEIODC_UART_COUNT];
 
-struct handle_s {
-	fddef			fd;
-	const lechar	*name;
-	leiodcpin_e		minp;
-	leiodcpin_e		maxp;
-};
-static struct handle_s glrhandles[handle_count] = {
+
+/*
+ * cdev GPIO handles
+ */
+struct handle_s glrhandles[handle_count] = {
 	[handle_uart]		= {0, "uart-gpio", lepin_COM1_RS232, lepin_COM3_RS422_TX2},
 	[handle_modem]		= {0, "modem-gpio", lepin_modem_reset, lepin_M2_cfg3},
 	[handle_heartbeat]	= {0, "hb-gpio", lepin_heartbeat, lepin_heartbeat},
@@ -256,12 +340,17 @@ static struct handle_s glrhandles[handle_count] = {
 
 
 /*
- * Error logger macros
+ * Board version lines, requested while held by
+ * leiodc_board_ver_get() or the input sampler
  */
-#define ERROR_LOGGER(...) _error_logger(__func__, __LINE__, NULL, __VA_ARGS__);
-#define ERROR_STD_LOGGER(...) _error_logger(__func__, __LINE__, strerror(errno), __VA_ARGS__);
+struct handle_s glbvhandle = {0, "boardver-gpio", lepin_board_ver0, lepin_board_ver3};
+static uint32_t glbvusers;
+static pthread_mutex_t glbvlock = PTHREAD_MUTEX_INITIALIZER;
+
+
 #define GPIO_CHIP_FROM_PAD(mpad) (mpad >> 5)
 #define GPIO_CHIP_MASK 0x1f
+#define GPIO_CDEV_EVENT_BUFFER 256		// Line events buffered by the kernel for each handle
 
 
 
@@ -271,13 +360,22 @@ static struct handle_s glrhandles[handle_count] = {
  * [05/03/2015]
  * Variable argument used
  * [31/10/2022]
+ * Not formatted in real-time mode
+ * [18/10/2026]
  */
-static void _error_logger(const lechar *cfunc, int lineno, const lechar *errstr, const lechar *format, ...) {
+void _error_logger(const lechar *cfunc, int lineno, const lechar *errstr, const lechar *format, ...) {
 	va_list 		ap;
 	lechar 			argbuf[256];
 	int 			retstat;
 
 
+	STATS_ERROR((errstr) ? errno : 0)
+
+	if (RT_ACTIVE()) {
+		_rt_error_logger(cfunc, lineno, (errstr) ? errno : 0, format);
+		return;
+	}
+
 	va_start(ap, format);
 	retstat = vsnprintf(argbuf, sizeof(argbuf) - 1, format, ap); // vnsprintf returns what it would have written, even if truncated
 	va_end(ap);
@@ -324,18 +422,46 @@ static cpupad_e _cpu_pad_get(leiodcpin_e lepin) {
 }
 
 
+/*
+ * Path prefix of the cdev GPIO chips,
+ * LEIODC_GPIO_CHIP environment variable selects a different set of chips
+ * (e.g. gpio-sim chips linked as <prefix>0...<prefix>3 for testing)
+ * [18/10/2026]
+ */
+const lechar *_cdev_chip_prefix(void) {
+	const lechar	*envpath;
+
+
+	if ((envpath = getenv(GPIO_CDEV_CHIP_ENV)) && *envpath)
+		return envpath;
+	return GPIO_CDEV_CHIP;
+}
+
 
 /*
  * Initialize GPIO access mode:
+ * /run/leiodc.sock	=> GPIO broker
  * /sys/class/gpio/	=> Legacy sysfs
  * /dev/gpiochipN	=> Linux CDEV API
  * [26/12/2022]
+ * Broker client mode added
+ * [18/10/2026]
  */
-static int _lib_mode(void) {
+int _lib_mode(void) {
 	const lechar	*syserr, *cdeverr;
+	lechar			chippath[GPIO_PATH_LENGTH];
 
 
-	if (access(GPIO_CDEV_CHIP "0", F_OK) == 0) {
+	if (_broker_connect() == RETVAL_OK) {
+		/*
+		 * GPIO broker is running, lines are owned by the broker
+		 */
+		libmode = mode_broker;
+		return RETVAL_OK;
+	}
+
+	snprintf(chippath, sizeof(chippath), "%s0", _cdev_chip_prefix());
+	if (access(chippath, F_OK) == 0) {
 		/*
 		 * /dev/gpiochip0 found, using Linux CDEV API
 		 */
@@ -353,7 +479,7 @@ static int _lib_mode(void) {
 	}
 	syserr = strerror(errno);
 
-	ERROR_LOGGER("'" GPIO_CDEV_CHIP "0' : %s; '" GPIO_SYSFS_DIR "' : %s", cdeverr, syserr)
+	ERROR_LOGGER("'%s' : %s; '" GPIO_SYSFS_DIR "' : %s", chippath, cdeverr, syserr)
 	return RETVAL_NEGATIVE;
 }
 
@@ -362,7 +488,7 @@ static int _lib_mode(void) {
  * close() function wrapper
  * [05/03/2015]
  */
-static int _close(fddef *fdptr, const lechar *filename, int verbose) {
+int _close(fddef *fdptr, const lechar *filename, int verbose) {
 	int retstat;
 
 
@@ -383,10 +509,18 @@ static int _close(fddef *fdptr, const lechar *filename, int verbose) {
  */
 static int _sysfile_write(fddef *fdptr, const lechar *filename, const lechar *wrstring, int closefl) {
 	int retstat = RETVAL_OK;
+	ssize_t wrsize;
+	PROBE_TIMESPEC(probets)
+	KTRACE_TIMESPEC(ktts)
 
 
 	if (!(*fdptr)) {
+		PROBE_TIME_BEGIN(sysfs_open, probets)
+		KTRACE_BEGIN(ktts)
+		STATS_KCALL(lestatk_sysfs)
 		*fdptr = open(filename, O_WRONLY);
+		KTRACE_SYSFS(leiodckt_sysfs_open, ktts, filename, NULL, (*fdptr < 0) ? -errno : *fdptr)
+		PROBE(sysfs_open, filename, *fdptr, PROBE_ELAPSED(sysfs_open, probets))
 		if (*fdptr < 1) {
 			ERROR_STD_LOGGER("open(%s)", filename)
 			*fdptr = 0;
@@ -394,7 +528,13 @@ static int _sysfile_write(fddef *fdptr, const lechar *filename, const lechar *wr
 		}
 	}
 
-	if (write(*fdptr, wrstring, strlen(wrstring)) < 0) {
+	PROBE_TIME_BEGIN(sysfs_write, probets)
+	KTRACE_BEGIN(ktts)
+	STATS_KCALL(lestatk_sysfs)
+	wrsize = write(*fdptr, wrstring, strlen(wrstring));
+	KTRACE_SYSFS(leiodckt_sysfs_write, ktts, filename, wrstring, (wrsize < 0) ? -errno : wrsize)
+	PROBE(sysfs_write, filename, wrstring, wrsize, PROBE_ELAPSED(sysfs_write, probets))
+	if (wrsize < 0) {
 		ERROR_STD_LOGGER("write(%s)", filename)
 		retstat = RETVAL_NEGATIVE;
 	}
@@ -443,7 +583,7 @@ static int _sysfs_action(leiodcpin lepin, const lechar *pathpostfix, const lecha
  * Find handle for current pin
  * [12/02/2024]
  */
-static struct handle_s *_cdev_pin_handle_find(leiodcpin lepin, int log) {
+struct handle_s *_cdev_pin_handle_find(leiodcpin lepin, int log) {
 	int 	i;
 	struct handle_s *handle = NULL;
 
@@ -462,23 +602,53 @@ static struct handle_s *_cdev_pin_handle_find(leiodcpin lepin, int log) {
 }
 
 
+/*
+ * Find pin of the handle from the GPIO chip line offset
+ * Return 0 if line doesn't belong to the handle
+ * [18/10/2026]
+ */
+leiodcpin_e _cdev_offset_pin_get(struct handle_s *lrhandle, __u32 offset) {
+	leiodcpin_e		lepin;
+
+
+	for (lepin = lrhandle->minp; lepin <= lrhandle->maxp; lepin++) {
+		if ((_cpu_pad_get(lepin) & GPIO_CHIP_MASK) == offset)
+			return lepin;
+	}
+	return 0;
+}
+
+
 /*
  * Get Values ioctl() of the cdev GPIO line handle
  * [12/02/2024]
  */
-static int _cdev_line_get_ioctl(struct handle_s *lrhandle, struct gpio_v2_line_values *linevals) {
+int _cdev_line_get_ioctl(struct handle_s *lrhandle, struct gpio_v2_line_values *linevals) {
+	int		retstat;
+	PROBE_TIMESPEC(probets)
+	KTRACE_TIMESPEC(ktts)
+
 
 	if (!lrhandle->fd) {
 		ERROR_LOGGER(sloghandle0, lrhandle->name)
 		return RETVAL_NEGATIVE;
 	}
 
-	if (ioctl(lrhandle->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, linevals)) {
+	PROBE_TIME_BEGIN(gpio_get_values, probets)
+	KTRACE_BEGIN(ktts)
+	STATS_KCALL_HANDLE(lrhandle)
+	retstat = ioctl(lrhandle->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, linevals);
+	KTRACE_HANDLE(leiodckt_get_values, ktts, lrhandle, (retstat) ? -errno : 0,
+			linevals->mask, linevals->bits, 0, 0, NULL)
+	PROBE(gpio_get_values, lrhandle->name, linevals->mask, linevals->bits, retstat,
+			PROBE_ELAPSED(gpio_get_values, probets))
+	if (retstat) {
 		ERROR_STD_LOGGER("GPIO ioctl(%s, %s)",
 				lrhandle->name, STRINGIFY_(GPIO_V2_LINE_GET_VALUES_IOCTL))
 		return RETVAL_NEGATIVE;
 	}
 
+	_state_lines_update(lrhandle, linevals->mask, linevals->bits, lepindir_unknown);
 	return RETVAL_OK;
 }
 
@@ -487,8 +657,11 @@ static int _cdev_line_get_ioctl(struct handle_s *lrhandle, struct gpio_v2_line_v
  * Set Config ioctl() of the cdev GPIO line handle
  * [26/12/2022]
  */
-static int _cdev_line_set_ioctl(struct handle_s *lrhandle, __u32 pinmask, __u32 valmask, enum gpio_v2_line_flag gflag) {
+int _cdev_line_set_ioctl(struct handle_s *lrhandle, __u32 pinmask, __u32 valmask, enum gpio_v2_line_flag gflag) {
 	struct gpio_v2_line_config linecfg;
+	int		retstat;
+	PROBE_TIMESPEC(probets)
+	KTRACE_TIMESPEC(ktts)
 
 
 	if (!lrhandle->fd) {
@@ -496,6 +669,11 @@ static int _cdev_line_set_ioctl(struct handle_s *lrhandle, __u32 pinmask, __u32
 		return RETVAL_NEGATIVE;
 	}
 
+	if (pinmask & lrhandle->edgemask) {
+		ERROR_LOGGER(slogedgeline, lrhandle->name, pinmask & lrhandle->edgemask)
+		return RETVAL_NEGATIVE;
+	}
+
 	memset(&linecfg, 0, sizeof(linecfg));
 	/*
 	 * Don't use global flag as it applies to all pins,
@@ -514,16 +692,128 @@ static int _cdev_line_set_ioctl(struct handle_s *lrhandle, __u32 pinmask, __u32
 		linecfg.attrs[1].attr.flags = gflag;
 	}
 
-	if (ioctl(lrhandle->fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &linecfg)) {
+	if (lrhandle->edgemask) {
+		/*
+		 * Lines not selected by pin mask get zero flags,
+		 * keep edge detection enabled on the watched lines
+		 */
+		linecfg.attrs[linecfg.num_attrs].mask = lrhandle->edgemask;
+		linecfg.attrs[linecfg.num_attrs].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+		linecfg.attrs[linecfg.num_attrs].attr.flags = GPIO_CDEV_EDGE_FLAGS;
+		linecfg.num_attrs++;
+	}
+
+	PROBE_TIME_BEGIN(gpio_set_config, probets)
+	KTRACE_BEGIN(ktts)
+	STATS_KCALL_HANDLE(lrhandle)
+	retstat = ioctl(lrhandle->fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &linecfg);
+	KTRACE_HANDLE(leiodckt_set_config, ktts, lrhandle, (retstat) ? -errno : 0,
+			pinmask, valmask, gflag, lrhandle->edgemask, NULL)
+	PROBE(gpio_set_config, lrhandle->name, pinmask, valmask, (uint64_t) gflag, lrhandle->edgemask, retstat,
+			PROBE_ELAPSED(gpio_set_config, probets))
+	if (retstat) {
 		ERROR_STD_LOGGER("GPIO ioctl(%s, %s)",
 				lrhandle->name, STRINGIFY_(GPIO_V2_LINE_SET_CONFIG_IOCTL))
 		return RETVAL_NEGATIVE;
 	}
 
+	_state_lines_update(lrhandle, pinmask, valmask,
+			(gflag & GPIO_V2_LINE_FLAG_OUTPUT) ? lepindir_out :
+			(gflag & GPIO_V2_LINE_FLAG_INPUT) ? lepindir_in : lepindir_unknown);
+	return RETVAL_OK;
+}
+
+
+/*
+ * Enable edge detection on the lines selected by the mask,
+ * edge detection is disabled on all other lines of the handle
+ * [18/10/2026]
+ */
+int _cdev_line_edge_set(struct handle_s *lrhandle, __u32 edgemask) {
+	struct gpio_v2_line_config linecfg;
+	__u32		inmask;
+	int			retstat;
+	PROBE_TIMESPEC(probets)
+	KTRACE_TIMESPEC(ktts)
+
+
+	if (!lrhandle->fd) {
+		ERROR_LOGGER(sloghandle0, lrhandle->name)
+		return RETVAL_NEGATIVE;
+	}
+
+	memset(&linecfg, 0, sizeof(linecfg));
+	if (edgemask) {
+		linecfg.attrs[linecfg.num_attrs].mask = edgemask;
+		linecfg.attrs[linecfg.num_attrs].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+		linecfg.attrs[linecfg.num_attrs].attr.flags = GPIO_CDEV_EDGE_FLAGS;
+		linecfg.num_attrs++;
+	}
+
+	if ((inmask = lrhandle->edgemask & ~edgemask)) {
+		/*
+		 * Lines released from edge detection remain inputs
+		 */
+		linecfg.attrs[linecfg.num_attrs].mask = inmask;
+		linecfg.attrs[linecfg.num_attrs].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+		linecfg.attrs[linecfg.num_attrs].attr.flags = GPIO_V2_LINE_FLAG_INPUT;
+		linecfg.num_attrs++;
+	}
+
+	if (!linecfg.num_attrs)
+		return RETVAL_OK;
+
+	PROBE_TIME_BEGIN(gpio_edge_config, probets)
+	KTRACE_BEGIN(ktts)
+	STATS_KCALL_HANDLE(lrhandle)
+	retstat = ioctl(lrhandle->fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &linecfg);
+	KTRACE_HANDLE(leiodckt_edge_config, ktts, lrhandle, (retstat) ? -errno : 0,
+			edgemask, lrhandle->edgemask, 0, 0, NULL)
+	PROBE(gpio_edge_config, lrhandle->name, edgemask, retstat, PROBE_ELAPSED(gpio_edge_config, probets))
+	if (retstat) {
+		ERROR_STD_LOGGER("GPIO ioctl(%s, %s, edgemask=0x%x)",
+				lrhandle->name, STRINGIFY_(GPIO_V2_LINE_SET_CONFIG_IOCTL), edgemask)
+		return RETVAL_NEGATIVE;
+	}
+
+	lrhandle->edgemask = edgemask;
+	_safe_handle_update(lrhandle);
+	_state_lines_update(lrhandle, edgemask | inmask, 0, lepindir_in);
 	return RETVAL_OK;
 }
 
 
+/*
+ * Forget cached interface mode of the UART the pin belongs to,
+ * pin is changed directly by the library caller
+ * [18/10/2026]
+ */
+static void _uart_cache_invalidate(leiodcpin lepin) {
+	int		uartno, i;
+
+
+	for (uartno = 0; uartno < ARRAY_SIZE(UartpinTable); uartno++) {
+		for (i = 0; i < UART_CTRL_PIN_COUNT; i++) {
+			if (UartpinTable[uartno].lepin[i] == lepin)
+				gluartcache[uartno].interface = 0;
+		}
+	}
+}
+
+
+/*
+ * Forget cached interface modes of all UARTs, async-signal-safe
+ * [18/10/2026]
+ */
+void _uart_cache_reset(void) {
+	int		uartno;
+
+
+	for (uartno = 0; uartno < ARRAY_SIZE(gluartcache); uartno++)
+		gluartcache[uartno].interface = 0;
+}
+
+
 /*
  * Perform an action on cdev GPIO
  * [25/12/2022]
@@ -533,15 +823,61 @@ static int _cdev_action(leiodcpin lepin, int state, enum gpio_v2_line_flag gflag
 	struct handle_s *handle;
 
 
+	if (ACTOR_QUEUED())
+		return _actor_call((gflag & GPIO_V2_LINE_FLAG_OUTPUT) ? brop_pin_dir_out_state_set : brop_pin_dir_in_set,
+				lepin, BOOL_CHECK(state));
+
 	if ((handle = _cdev_pin_handle_find(lepin, 1)) == NULL)
 		return RETVAL_NEGATIVE;
 
 
+	if (handle == &glrhandles[handle_uart])
+		_uart_cache_invalidate(lepin);
+
 	pbit = 1 << (lepin - handle->minp);
 	return _cdev_line_set_ioctl(handle, pbit, state ? pbit : 0, gflag);
 }
 
 
+/*
+ * Forget cached interface modes of the UARTs the lines belong to
+ * [18/10/2026]
+ */
+void _cdev_lines_uart_invalidate(struct handle_s *lrhandle, __u32 pinmask) {
+	leiodcpin_e		lepin;
+
+
+	if (lrhandle == &glrhandles[handle_uart]) {
+		for (lepin = lrhandle->minp; lepin <= lrhandle->maxp; lepin++) {
+			if (pinmask & HANDLE_PIN_BIT(lrhandle, lepin))
+				_uart_cache_invalidate(lepin);
+		}
+	}
+}
+
+
+/*
+ * Set output values of several lines of the handle with one ioctl
+ * [18/10/2026]
+ */
+int _cdev_lines_out_set(struct handle_s *lrhandle, __u32 pinmask, __u32 valmask) {
+
+	_cdev_lines_uart_invalidate(lrhandle, pinmask);
+	return _cdev_line_set_ioctl(lrhandle, pinmask, valmask, GPIO_V2_LINE_FLAG_OUTPUT);
+}
+
+
+/*
+ * Switch several lines of the handle to input with one ioctl
+ * [18/10/2026]
+ */
+int _cdev_lines_in_set(struct handle_s *lrhandle, __u32 pinmask) {
+
+	_cdev_lines_uart_invalidate(lrhandle, pinmask);
+	return _cdev_line_set_ioctl(lrhandle, pinmask, 0, GPIO_V2_LINE_FLAG_INPUT);
+}
+
+
 /*
  * Check and set file permissions
  * [09/07/2015]
@@ -605,7 +941,10 @@ static int _init_cdev_chip(lechar *gpiopath, struct handle_s *lrhandle, int dirl
 	fddef			fd;
 	int				i;
 	int				chip = GPIO_CHIP_FROM_PAD(_cpu_pad_get(lrhandle->minp));
+	int				retstat;
 	struct gpio_v2_line_request linereq;
+	PROBE_TIMESPEC(probets)
+	KTRACE_TIMESPEC(ktts)
 
 
 	memset(&linereq, 0, sizeof(linereq));
@@ -623,6 +962,7 @@ static int _init_cdev_chip(lechar *gpiopath, struct handle_s *lrhandle, int dirl
 	}
 
 	strcpy(linereq.consumer, lrhandle->name);
+	linereq.event_buffer_size = GPIO_CDEV_EVENT_BUFFER;
 	/*
 	 * Don't use global flag as it applies to all pins,
 	 * even those not selected by pin mask.
@@ -645,7 +985,15 @@ static int _init_cdev_chip(lechar *gpiopath, struct handle_s *lrhandle, int dirl
 		return RETVAL_NEGATIVE;
 	}
 
-	if (ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &linereq)) {
+	PROBE_TIME_BEGIN(gpio_get_line, probets)
+	KTRACE_BEGIN(ktts)
+	STATS_KCALL(lestatk_chip)
+	retstat = ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &linereq);
+	KTRACE_HANDLE(leiodckt_get_line, ktts, lrhandle, (retstat) ? -errno : linereq.fd,
+			linereq.num_lines, chip, 0, 0, NULL)
+	PROBE(gpio_get_line, gpiopath, lrhandle->name, linereq.num_lines, (retstat) ? retstat : linereq.fd,
+			PROBE_ELAPSED(gpio_get_line, probets))
+	if (retstat) {
 		ERROR_STD_LOGGER( "GPIO ioctl(%s, %s)",
 				gpiopath, STRINGIFY_(GPIO_V2_GET_LINE_IOCTL))
 	}
@@ -666,6 +1014,20 @@ static int _init_cdev_chip(lechar *gpiopath, struct handle_s *lrhandle, int dirl
 }
 
 
+/*
+ * Request lines of the handle which is not in the handle table
+ * [18/10/2026]
+ */
+int _cdev_handle_open(struct handle_s *lrhandle) {
+	lechar		gpiopath[GPIO_PATH_LENGTH];
+	size_t		len;
+
+
+	len = snprintf(gpiopath, sizeof(gpiopath) - 4, "%s", _cdev_chip_prefix());
+	return _init_cdev_chip(gpiopath, lrhandle, len);
+}
+
+
 /*
  * Initialize required pins
  * Return -1 on error
@@ -682,6 +1044,7 @@ int leiodc_pin_init(LIBARGDEF_INIT) {
 	leiodcpin		first = 0;
 	cpupad_e		cpupad;
 	fddef			fd = 0;
+	STATS_API(lestat_pin_init)
 
 
 	if (!libmode) {
@@ -691,8 +1054,7 @@ int leiodc_pin_init(LIBARGDEF_INIT) {
 
 	switch (libmode) {
 	case mode_cdev:
-		len = strlen(GPIO_CDEV_CHIP);
-		strcpy(gpiopath, GPIO_CDEV_CHIP);
+		len = snprintf(gpiopath, sizeof(gpiopath) - 4, "%s", _cdev_chip_prefix());
 		if (!pintable) {
 			ERROR_LOGGER("Can't initialize 'all' pins, need to pass pintable[] argument to %s()", __func__)
 			return RETVAL_NEGATIVE;
@@ -704,6 +1066,18 @@ int leiodc_pin_init(LIBARGDEF_INIT) {
  		strcpy(gpiopath, gpiodirpref);
  		break;
 
+	case mode_broker:
+		if (!pintable) {
+			ERROR_LOGGER("Can't initialize 'all' pins, need to pass pintable[] argument to %s()", __func__)
+			return RETVAL_NEGATIVE;
+		}
+
+		for (i = 0; i < pincount; i++) {
+			if (_broker_call(brop_pin_init, pintable[i], 0))
+				return RETVAL_NEGATIVE;
+		}
+		return RETVAL_OK;
+
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
 		return RETVAL_NEGATIVE;
@@ -776,13 +1150,20 @@ EXPORT_SYMBOL(leiodc_pin_init)
  * [06/12/2022]
  */
 int leiodc_pin_dir_out_state_set(LIBARGDEF_PINS) {
+	STATS_API(lestat_pin_dir_out_state_set)
 
 	switch (libmode) {
 	case mode_cdev:
 		return _cdev_action(lepin, state, GPIO_V2_LINE_FLAG_OUTPUT);
 
 	case mode_sysfs:
-		return _sysfs_action(lepin, gpiodirection, (state) ? GPIO_HIGH : GPIO_LOW);
+		if (_sysfs_action(lepin, gpiodirection, (state) ? GPIO_HIGH : GPIO_LOW))
+			return RETVAL_NEGATIVE;
+		_state_pin_update(lepin, lepindir_out, BOOL_CHECK(state));
+		return RETVAL_OK;
+
+	case mode_broker:
+		return _broker_call(brop_pin_dir_out_state_set, lepin, state);
 
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
@@ -799,13 +1180,20 @@ EXPORT_SYMBOL(leiodc_pin_dir_out_state_set)
  * [06/03/2015]
  */
 int leiodc_pin_state_set(LIBARGDEF_PINS) {
+	STATS_API(lestat_pin_state_set)
 
 	switch (libmode) {
 	case mode_cdev:
 		return _cdev_action(lepin, state, GPIO_V2_LINE_FLAG_OUTPUT);
 
 	case mode_sysfs:
-		return _sysfs_action(lepin, GPIO_VALUE, (state) ? "1" : "0");
+		if (_sysfs_action(lepin, GPIO_VALUE, (state) ? "1" : "0"))
+			return RETVAL_NEGATIVE;
+		_state_pin_update(lepin, lepindir_unknown, BOOL_CHECK(state));
+		return RETVAL_OK;
+
+	case mode_broker:
+		return _broker_call(brop_pin_state_set, lepin, state);
 
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
@@ -825,6 +1213,7 @@ int leiodc_pin_state_get(LIBARGDEF_PINS) {
 	int		pinstate = RETVAL_NEGATIVE;
 	struct handle_s *handle;
 	struct gpio_v2_line_values linevals;
+	STATS_API(lestat_pin_state_get)
 
 
 	switch (libmode) {
@@ -846,6 +1235,10 @@ int leiodc_pin_state_get(LIBARGDEF_PINS) {
 		ERROR_LOGGER(slognogpiochip, "get pin state")
 		break;
 
+	case mode_broker:
+		pinstate = _broker_call(brop_pin_state_get, lepin, 0);
+		break;
+
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
 		break;
@@ -863,13 +1256,20 @@ EXPORT_SYMBOL(leiodc_pin_state_get)
  * [06/12/2022]
  */
 int leiodc_pin_dir_in_set(LIBARGDEF_PINS) {
+	STATS_API(lestat_pin_dir_in_set)
 
 	switch (libmode) {
 	case mode_cdev:
 		return _cdev_action(lepin, 0, GPIO_V2_LINE_FLAG_INPUT);
 
 	case mode_sysfs:
-		return _sysfs_action(lepin, gpiodirection, GPIO_IN);
+		if (_sysfs_action(lepin, gpiodirection, GPIO_IN))
+			return RETVAL_NEGATIVE;
+		_state_pin_update(lepin, lepindir_in, LEIODC_STATE_UNKNOWN);
+		return RETVAL_OK;
+
+	case mode_broker:
+		return _broker_call(brop_pin_dir_in_set, lepin, 0);
 
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
@@ -881,34 +1281,30 @@ EXPORT_SYMBOL(leiodc_pin_dir_in_set)
 
 
 /*
- * Set interface mode of the UART
+ * Set UART interface control GPIOs,
+ * control lines of all UARTs are changed with a single ioctl() in cdev mode
+ * interface - leiodcuartint_e for each UART, 0 - leave unchanged,
+ * UART_INT_OFF - all control lines low
  * Return -1 on error
- * [14/04/2015]
- * Pin table created
- * [26/12/2022]
+ * [18/10/2026]
  */
-int leiodc_uart_int(LIBARGDEF_UART) {
-	int i;
-	 struct serial_rs485 rs485conf;
+int _uart_gpio_set(const uint8_t *interface) {
+	int i, uartno;
+	uint8_t mode;
 	__u32 pbit, pinmask = 0, valmask = 0;
 
 
-	memset(&rs485conf, 0, sizeof(rs485conf));
-
-	if ((uartno > 2) || (interface >= ARRAY_SIZE(UartoeTable))) {
-		//ERROR_LOGGER("UART number '%u' is to high, must be between 0...2", uartno)
-		return RETVAL_OK;		// Don't do anything if UART number argument is greater than 2
-	}
-
-	if (!libmode) {
-		if (_lib_mode())
-			return RETVAL_NEGATIVE;
-	}
-
-
 	switch (libmode) {
 	case mode_cdev:
+		if (ACTOR_QUEUED())
+			return _actor_call(brop_uart_int_all, interface[0] | (interface[1] << 4), interface[2]);
+
 		if (!glrhandles[handle_uart].fd) {
+			if (RT_ACTIVE()) {
+				ERROR_LOGGER(sloghandle0, glrhandles[handle_uart].name)
+				return RETVAL_NEGATIVE;
+			}
+
 			/*
 			 * One pin is sufficient to initialize UART GPIOs
 			 * because all pins are in Bank1
@@ -925,39 +1321,89 @@ int leiodc_uart_int(LIBARGDEF_UART) {
 			return RETVAL_NEGATIVE;
 		break;
 
+	case mode_broker:
+		return _broker_call(brop_uart_int_all,
+				interface[0] | (interface[1] << 4), interface[2]);
+
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
 		return RETVAL_NEGATIVE;
 	}
 
 
-	for (i = 0; i < UART_CTRL_PIN_COUNT; i++) {
-		switch (libmode) {
-		case mode_cdev:
-			pbit = 1 << (UartpinTable[uartno].lepin[i] - lepin_COM1_RS232);
-			pinmask |= pbit;
-			if (UartoeTable[interface].value[i])
-				valmask |= pbit;
-			break;
+	for (uartno = 0; uartno < ARRAY_SIZE(UartpinTable); uartno++) {
+		if (!interface[uartno])
+			continue;
+		mode = UART_INT_MODE(interface[uartno]);
 
-		case mode_sysfs:
-			if (leiodc_pin_dir_out_state_set(UartpinTable[uartno].lepin[i],
-					UartoeTable[interface].value[i]))
-				return RETVAL_NEGATIVE;
-			break;
+		for (i = 0; i < UART_CTRL_PIN_COUNT; i++) {
+			switch (libmode) {
+			case mode_cdev:
+				if (gluartcache[uartno].interface == interface[uartno])
+					break;		// Already applied
 
-		default:
-			ERROR_LOGGER(sloginvalidmode, libmode)
-			return RETVAL_NEGATIVE;
+				pbit = 1 << (UartpinTable[uartno].lepin[i] - lepin_COM1_RS232);
+				pinmask |= pbit;
+				if (UartoeTable[mode].value[i])
+					valmask |= pbit;
+				break;
+
+			case mode_sysfs:
+				if (leiodc_pin_dir_out_state_set(UartpinTable[uartno].lepin[i],
+						UartoeTable[mode].value[i]))
+					return RETVAL_NEGATIVE;
+				break;
+
+			default:
+				ERROR_LOGGER(sloginvalidmode, libmode)
+				return RETVAL_NEGATIVE;
+			}
 		}
 	}
 
 
-	if (libmode == mode_cdev) {
+	if ((libmode == mode_cdev) && pinmask) {
 		if (_cdev_line_set_ioctl(&glrhandles[handle_uart], pinmask, valmask, GPIO_V2_LINE_FLAG_OUTPUT))
 			return RETVAL_NEGATIVE;
 	}
 
+	for (uartno = 0; uartno < ARRAY_SIZE(UartpinTable); uartno++) {
+		if (!interface[uartno])
+			continue;
+
+		if (libmode == mode_cdev)
+			gluartcache[uartno].interface = interface[uartno];
+		_state_uart_update(uartno, UART_INT_MODE(interface[uartno]));
+	}
+	return RETVAL_OK;
+}
+
+
+#define RS485_ADDR_FLAGS (SER_RS485_ADDRB | SER_RS485_ADDR_RECV | SER_RS485_ADDR_DEST)
+/*
+ * Set RS485 mode of the UART tty
+ * rs485opt - RTS delays and addressing mode to apply, NULL - zero delays,
+ * settings are not applied again if the same interface mode was applied to the same tty
+ * Return -1 on error
+ * [18/10/2026]
+ * RS485 disabled when switching to non-RS485 mode
+ * [18/10/2026]
+ */
+int _uart_rs485_set(uint8_t uartno, uint8_t interface, const fddef *fdptr, const struct serial_rs485 *rs485opt) {
+	 struct serial_rs485 rs485conf;
+	__u32 addrflags = 0;
+	uint8_t rs485int = UART_INT_RS485(interface) ? interface : UART_INT_OFF;
+	int retstat;
+	PROBE_TIMESPEC(probets)
+	KTRACE_TIMESPEC(ktts)
+
+
+	memset(&rs485conf, 0, sizeof(rs485conf));
+	if (rs485opt) {
+		addrflags = rs485opt->flags & RS485_ADDR_FLAGS;
+		rs485conf.delay_rts_before_send = rs485opt->delay_rts_before_send;
+		rs485conf.delay_rts_after_send = rs485opt->delay_rts_after_send;
+	}
 
 	switch (interface) {
 	case leuart_RS485def:
@@ -978,15 +1424,12 @@ int leiodc_uart_int(LIBARGDEF_UART) {
 		}
 #else
 		rs485conf.flags = (SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND);
-		// FIXME check if these flags are backward compatible
-		rs485conf.flags |= (SER_RS485_ADDRB | SER_RS485_ADDR_RECV);
 		rs485conf.padding[0] = _cpu_pad_get(UartpinTable[uartno].lepin[2]);
 #endif
 		break;
 
 	case leuart_RS485rev:
 		rs485conf.flags = (SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND);
-		rs485conf.flags |= (SER_RS485_ADDRB | SER_RS485_ADDR_RECV);
 		rs485conf.padding[0] = _cpu_pad_get(UartpinTable[uartno].lepin[4]);
 		break;
 
@@ -994,25 +1437,313 @@ int leiodc_uart_int(LIBARGDEF_UART) {
 		break;
 	}
 
+	if (rs485conf.flags && addrflags) {
+		/*
+		 * 9-bit addressing, addresses share the first padding word with
+		 * the TX enable pad, kernels supporting addressing don't use the pad
+		 */
+		rs485conf.flags |= addrflags | SER_RS485_ADDRB;
+		rs485conf.padding[0] = 0;
+		rs485conf.addr_recv = rs485opt->addr_recv;
+		rs485conf.addr_dest = rs485opt->addr_dest;
+		addrflags = rs485conf.flags & RS485_ADDR_FLAGS;
+	}
+
 
-	if (fdptr && rs485conf.flags) {
-		if (ioctl(*fdptr, TIOCSRS485, &rs485conf)) {
+	/*
+	 * Non-RS485 modes disable RS485 of the tty,
+	 * it may have been enabled by a previous mode or application
+	 */
+	if (fdptr) {
+		if (!rs485opt && (gluartcache[uartno].rs485int == rs485int) && (gluartcache[uartno].rs485fd == *fdptr))
+			return RETVAL_OK;		// Already applied to this tty
+
+		PROBE_TIME_BEGIN(uart_rs485, probets)
+		KTRACE_BEGIN(ktts)
+		STATS_KCALL(lestatk_tty)
+		retstat = ioctl(*fdptr, TIOCSRS485, &rs485conf);
+		KTRACE(leiodckt_rs485, ktts, uartno, uartno, (retstat) ? -errno : 0, interface, rs485conf.flags, rs485conf.padding[0],
+				(rs485conf.delay_rts_before_send << 16) | (rs485conf.delay_rts_after_send & 0xFFFF), NULL)
+		PROBE(uart_rs485, *fdptr, uartno, interface, rs485conf.flags, rs485conf.padding[0], retstat,
+				PROBE_ELAPSED(uart_rs485, probets))
+		if (retstat && (errno == ENOTTY) && (!rs485conf.flags || _serial_is_pty(*fdptr))) {
+			/*
+			 * No RS485 support, nothing to disable.
+			 * No RS485 on pty, serial side is tested without UARTs.
+			 */
+			retstat = 0;
+			addrflags = 0;
+		}
+		if (retstat) {
 			ERROR_STD_LOGGER( "UART ioctl(%u, %s, rs485.flags=0x%x rs485.padding[0]=%u)",
 					*fdptr, STRINGIFY_(TIOCSRS485), rs485conf.flags, rs485conf.padding[0])
+			gluartcache[uartno].rs485int = 0;
 			return RETVAL_NEGATIVE;
 		}
+
+		/*
+		 * Kernel returns applied settings,
+		 * unsupported flags are cleared
+		 */
+		if (addrflags && ((rs485conf.flags & addrflags) != addrflags)) {
+			ERROR_LOGGER("COM%u RS485 addressing mode (flags=0x%x) is not supported by the kernel, applied flags=0x%x",
+					uartno + 1, addrflags, rs485conf.flags)
+			gluartcache[uartno].rs485int = 0;
+			return RETVAL_NEGATIVE;
+		}
+		gluartcache[uartno].rs485int = rs485int;
+		gluartcache[uartno].rs485fd = *fdptr;
+		_health_port_set(uartno, *fdptr);
 	}
 	return RETVAL_OK;
 }
+
+
+/*
+ * Set interface mode of the UART
+ * Return -1 on error
+ * [14/04/2015]
+ * Pin table created
+ * [26/12/2022]
+ * GPIO and RS485 settings split, GPIOs can be set by the broker
+ * [18/10/2026]
+ * Interface 0 drives all control lines low
+ * [18/10/2026]
+ */
+int leiodc_uart_int(LIBARGDEF_UART) {
+	uint8_t		inttable[LEIODC_UART_COUNT] = {0};
+	STATS_API(lestat_uart_int)
+
+
+	if ((uartno > 2) || (interface >= ARRAY_SIZE(UartoeTable))) {
+		//ERROR_LOGGER("UART number '%u' is to high, must be between 0...2", uartno)
+		return RETVAL_OK;		// Don't do anything if UART number argument is greater than 2
+	}
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	inttable[uartno] = (interface) ? interface : UART_INT_OFF;
+	if (_uart_gpio_set(inttable))
+		return RETVAL_NEGATIVE;
+
+	return _uart_rs485_set(uartno, interface, fdptr, NULL);
+}
 EXPORT_SYMBOL(leiodc_uart_int)
 
 
+/*
+ * Set interface modes of all UARTs in one step,
+ * control lines are changed first, then RS485 settings are applied
+ * interface - leiodcuartint_e for each UART, 0 - leave unchanged
+ * fdtable - tty descriptor for each UART or NULL, can be NULL
+ * Return -1 on error
+ * [18/10/2026]
+ * Interface table checked
+ * [18/10/2026]
+ */
+int leiodc_uart_int_all(LIBARGDEF_UARTS) {
+	int			uartno;
+	int			retval = RETVAL_OK;
+	STATS_API(lestat_uart_int_all)
+
+
+	if (!interface) {
+		ERROR_LOGGER("UART interface modes are not specified")
+		return RETVAL_NEGATIVE;
+	}
+
+	for (uartno = 0; uartno < LEIODC_UART_COUNT; uartno++) {
+		if (interface[uartno] >= ARRAY_SIZE(UartoeTable)) {
+			ERROR_LOGGER("COM%u interface mode %u is not valid", uartno + 1, interface[uartno])
+			return RETVAL_NEGATIVE;
+		}
+	}
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if (_uart_gpio_set(interface))
+		return RETVAL_NEGATIVE;
+
+	for (uartno = 0; uartno < LEIODC_UART_COUNT; uartno++) {
+		if (!interface[uartno])
+			continue;
+
+		if (_uart_rs485_set(uartno, interface[uartno], (fdtable) ? fdtable[uartno] : NULL, NULL))
+			retval = RETVAL_NEGATIVE;		// Apply remaining UARTs, error string is kept
+	}
+	return retval;
+}
+EXPORT_SYMBOL(leiodc_uart_int_all)
+
+
+/*
+ * Read UART control lines
+ * Return line values packed as bits in UartpinTable order or -1 on error
+ * [18/10/2026]
+ */
+int _uart_gpio_get(uint8_t uartno) {
+	struct gpio_v2_line_values linevals;
+	int		i, pattern = 0;
+
+
+	switch (libmode) {
+	case mode_cdev:
+		if (!glrhandles[handle_uart].fd) {
+			const leiodcpin pintable[] = {lepin_COM1_RS232};
+
+			if (RT_ACTIVE()) {
+				ERROR_LOGGER(sloghandle0, glrhandles[handle_uart].name)
+				return RETVAL_NEGATIVE;
+			}
+
+			if (leiodc_pin_init(pintable, ARRAY_SIZE(pintable)))
+				return RETVAL_NEGATIVE;
+		}
+		break;
+
+	case mode_sysfs:
+		ERROR_LOGGER(slognogpiochip, "read UART interface mode")
+		return RETVAL_NEGATIVE;
+
+	case mode_broker:
+		return _broker_call(brop_uart_gpio_get, uartno, 0);
+
+	default:
+		ERROR_LOGGER(sloginvalidmode, libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+
+	memset(&linevals, 0, sizeof(linevals));
+	for (i = 0; i < UART_CTRL_PIN_COUNT; i++)
+		linevals.mask |= 1 << (UartpinTable[uartno].lepin[i] - lepin_COM1_RS232);
+
+	if (_cdev_line_get_ioctl(&glrhandles[handle_uart], &linevals))
+		return RETVAL_NEGATIVE;
+
+	for (i = 0; i < UART_CTRL_PIN_COUNT; i++) {
+		if (linevals.bits & (1 << (UartpinTable[uartno].lepin[i] - lepin_COM1_RS232)))
+			pattern |= 1 << i;
+	}
+	return pattern;
+}
+
+
+/*
+ * Get RS485 transmitter enable pin of the UART
+ * Return lepin_count if interface is not RS485
+ * [18/10/2026]
+ */
+leiodcpin_e _uart_txen_pin_get(uint8_t uartno, uint8_t interface) {
+
+	if (uartno >= ARRAY_SIZE(UartpinTable))
+		return lepin_count;
+
+	switch (interface) {
+	case leuart_RS485def:
+	case leuart_RS485rev:
+		return UartpinTable[uartno].lepin[UART_TXEN_INDEX(interface)];
+
+	default:
+		break;
+	}
+	return lepin_count;
+}
+
+
+/*
+ * Get interface mode of the UART decoded from the control lines,
+ * RS485 settings of the tty are checked if descriptor is supplied,
+ * TX enable line of RS485 modes can be at any level
+ * Return leiodcuartint_e, 0 if all control lines are low or -1 on error
+ * [18/10/2026]
+ * TX enable masked, all lines low reported as 0
+ * [18/10/2026]
+ */
+int leiodc_uart_int_get(uint8_t uartno, const fddef *fdptr) {
+	struct serial_rs485 rs485conf;
+	int		interface, pattern, i;
+	int		rs485en = RETVAL_NEGATIVE;		// RS485 state unknown
+	STATS_API(lestat_uart_int_get)
+
+
+	if (uartno >= ARRAY_SIZE(UartpinTable)) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u",
+				uartno, (unsigned int) ARRAY_SIZE(UartpinTable) - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if ((pattern = _uart_gpio_get(uartno)) < 0)
+		return RETVAL_NEGATIVE;
+
+	if (fdptr) {
+		memset(&rs485conf, 0, sizeof(rs485conf));
+		STATS_KCALL(lestatk_tty)
+		if (ioctl(*fdptr, TIOCGRS485, &rs485conf)) {
+			ERROR_STD_LOGGER("UART ioctl(%u, %s)", *fdptr, STRINGIFY_(TIOCGRS485))
+			return RETVAL_NEGATIVE;
+		}
+		rs485en = BOOL_CHECK(rs485conf.flags & SER_RS485_ENABLED);
+	}
+
+
+	if (!pattern && (rs485en <= 0)) {
+		/*
+		 * Driven low by leiodc_uart_int() with interface 0
+		 */
+		if (libmode == mode_cdev)
+			gluartcache[uartno].interface = UART_INT_OFF;
+		return 0;
+	}
+
+	for (interface = leuart_RS232; interface < ARRAY_SIZE(UartoeTable); interface++) {
+		for (i = 0; i < UART_CTRL_PIN_COUNT; i++) {
+			if (UART_INT_RS485(interface) && (i == UART_TXEN_INDEX(interface)))
+				continue;		// Raised by RTS on send or userspace direction control
+			if (BOOL_CHECK(pattern & (1 << i)) != UartoeTable[interface].value[i])
+				break;
+		}
+		if (i < UART_CTRL_PIN_COUNT)
+			continue;
+
+		if ((rs485en >= 0) && (rs485en != UART_INT_RS485(interface)))
+			continue;		// Control lines match, RS485 settings don't
+
+		if (libmode == mode_cdev)
+			gluartcache[uartno].interface = interface;
+		return interface;
+	}
+
+	if (rs485en >= 0) {
+		ERROR_LOGGER("COM%u control lines 0x%02x and RS485 %s don't match any interface mode",
+				uartno + 1, pattern, rs485en ? "enabled" : "disabled")
+	}
+	else {
+		ERROR_LOGGER("COM%u control lines 0x%02x don't match any interface mode", uartno + 1, pattern)
+	}
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_uart_int_get)
+
+
 /*
  * Initialize M.2 card pins
  * Return -1 on error
  * [26/01/2024]
  */
 int leiodc_m2_init(void) {
+	STATS_API(lestat_m2_init)
 
 	if (!libmode) {
 		if (_lib_mode())
@@ -1035,6 +1766,11 @@ int leiodc_m2_init(void) {
 		ERROR_LOGGER(slognogpiochip, "initialize M.2 card")
 		goto failed;
 
+	case mode_broker:
+		if (_broker_call(brop_m2_init, 0, 0))
+			goto failed;
+		break;
+
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
 		goto failed;
@@ -1056,6 +1792,7 @@ EXPORT_SYMBOL(leiodc_m2_init)
 int leiodc_m2_config_get(void) {
 	struct gpio_v2_line_values linevals;
 	int		cfgbyte = RETVAL_NEGATIVE;
+	STATS_API(lestat_m2_config_get)
 
 
 	if (!libmode) {
@@ -1072,12 +1809,17 @@ int leiodc_m2_config_get(void) {
 			goto failed;
 
 		cfgbyte = linevals.bits >> (lepin_M2_cfg0 - glrhandles[handle_modem].minp);
+		_state_m2_update(cfgbyte);
 		break;
 
 	case mode_sysfs:
 		ERROR_LOGGER(slognogpiochip, "read M.2 config")
 		goto failed;
 
+	case mode_broker:
+		cfgbyte = _broker_call(brop_m2_config_get, 0, 0);
+		break;
+
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
 		goto failed;
@@ -1090,17 +1832,51 @@ int leiodc_m2_config_get(void) {
 EXPORT_SYMBOL(leiodc_m2_config_get)
 
 
+/*
+ * Hold board version line handle, lines are requested by the first user
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int _boardver_handle_get(void) {
+	int		retstat = RETVAL_OK;
+
+
+	pthread_mutex_lock(&glbvlock);
+	if (!glbvusers) {
+		if (_cdev_handle_open(&glbvhandle))
+			retstat = RETVAL_NEGATIVE;
+	}
+	if (!retstat)
+		glbvusers++;
+	pthread_mutex_unlock(&glbvlock);
+	return retstat;
+}
+
+
+/*
+ * Release board version line handle, lines are released by the last user
+ * [18/10/2026]
+ */
+void _boardver_handle_put(void) {
+
+	pthread_mutex_lock(&glbvlock);
+	if (glbvusers && !--glbvusers)
+		_close(&glbvhandle.fd, glbvhandle.name, 1);
+	pthread_mutex_unlock(&glbvlock);
+}
+
+
 /*
  * Read MB board version (as byte)
  * Return -1 if can't read version
  * [09/02/2024]
+ * Line handle shared with the input sampler
+ * [18/10/2026]
  */
 int leiodc_board_ver_get(void) {
 	struct gpio_v2_line_values linevals;
-	struct handle_s bvhandle;
 	int				verbyte = RETVAL_NEGATIVE;
-	lechar			gpiopath[GPIO_PATH_LENGTH];
-	size_t			len;
+	STATS_API(lestat_board_ver_get)
 
 
 	if (!libmode) {
@@ -1110,33 +1886,28 @@ int leiodc_board_ver_get(void) {
 
 	switch (libmode) {
 	case mode_cdev:
-		len = strlen(GPIO_CDEV_CHIP);
-		strcpy(gpiopath, GPIO_CDEV_CHIP);
-
-		memset(&bvhandle, 0, sizeof(bvhandle));
-		bvhandle.minp = lepin_board_ver0;
-		bvhandle.maxp = lepin_board_ver3;
-		bvhandle.name = "boardver-gpio";
-
-		if (_init_cdev_chip(gpiopath, &bvhandle, len))
+		if (_boardver_handle_get())
 			goto failed;
 
 
 		memset(&linevals, 0, sizeof(linevals));
 		linevals.mask = 0x0F;
 
-		if (_cdev_line_get_ioctl(&bvhandle, &linevals))
-			goto failed;
-
-		verbyte = linevals.bits;
-
-		_close(&bvhandle.fd, bvhandle.name, 1);
+		if (!_cdev_line_get_ioctl(&glbvhandle, &linevals)) {
+			verbyte = linevals.bits;
+			_state_boardver_update(verbyte);
+		}
+		_boardver_handle_put();
 		break;
 
 	case mode_sysfs:
 		ERROR_LOGGER(slognogpiochip, "read board version")
 		goto failed;
 
+	case mode_broker:
+		verbyte = _broker_call(brop_board_ver_get, 0, 0);
+		break;
+
 	default:
 		ERROR_LOGGER(sloginvalidmode, libmode)
 		goto failed;
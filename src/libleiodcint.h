@@ -0,0 +1,344 @@
+/*
+ ============================================================================
+ Name        : libleiodcint.h
+ Author      : AK
+ Version     : V1.00
+ Copyright   : Property of Londelec UK Ltd
+ Description : Internal header file for LEIODC CPU pin manipulation library,
+               definitions shared between library source files.
+               Not for use by library callers.
+
+  Change log :
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+#ifndef LIBLEIODCINT_H_
+#define LIBLEIODCINT_H_
+
+
+#include <pthread.h>
+#include <linux/gpio.h>		// cdev GPIO UAPI
+
+#include "libleiodchw.h"
+
+
+/*
+ * GPIO char dev constants
+ */
+#define	GPIO_CDEV_CHIP		"/dev/gpiochip"		// Path of the gpio chip device
+#define GPIO_CDEV_CHIP_ENV	"LEIODC_GPIO_CHIP"	// Environment variable overriding chip path prefix
+#define GPIO_PATH_LENGTH	256					// Length of the gpio directory name
+#define	GPIO_SYSFS_DIR		"/sys/class/gpio/"	// Path of the gpio sysfs directory
+
+#define	RETVAL_OK			0
+#define	RETVAL_NEGATIVE		-1
+
+#define __EXPORT_SYMBOL(sym, sec) \
+	extern typeof(sym) sym;
+
+#define EXPORT_SYMBOL(sym)		__EXPORT_SYMBOL(sym, "")
+
+#define LIBINTERNAL			__attribute__ ((visibility ("hidden")))	// Shared between library files, not exported
+
+
+/*
+ * GPIO access modes
+ */
+typedef enum {
+	mode_none = 0,
+	mode_sysfs,
+	mode_cdev,
+	mode_broker,
+} libmode_e;
+
+
+/*
+ * cdev GPIO handle types
+ */
+enum {
+	handle_uart = 0,
+	handle_modem,
+	handle_heartbeat,
+	handle_count		/* Number of handles, must be the last */
+};
+
+struct handle_s {
+	fddef			fd;
+	const lechar	*name;
+	leiodcpin_e		minp;
+	leiodcpin_e		maxp;
+	__u32			edgemask;		// Lines requested with edge detection
+};
+
+
+/*
+ * Error logger macros
+ */
+#define ERROR_LOGGER(...) _error_logger(__func__, __LINE__, NULL, __VA_ARGS__);
+#define ERROR_STD_LOGGER(...) _error_logger(__func__, __LINE__, (RT_ACTIVE()) ? "" : strerror(errno), __VA_ARGS__);
+#define LIB_ERROR_STRING_LENGTH		512
+
+
+/* Handle line bit of the pin */
+#define HANDLE_PIN_BIT(mhandle, mpin)	((__u32) 1 << ((mpin) - (mhandle)->minp))
+
+
+/* Line flags of the lines requested with edge detection */
+#define GPIO_CDEV_EDGE_FLAGS (GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING)
+
+
+/*
+ * Internal UART interface value, all control lines low (interface 0 of
+ * leiodc_uart_int()), 0 means unchanged when interfaces of all UARTs are set
+ */
+#define UART_INT_OFF		0x0F
+
+
+/*
+ * Library globals
+ */
+extern libmode_e libmode LIBINTERNAL;
+extern struct handle_s glrhandles[handle_count] LIBINTERNAL;
+extern struct handle_s glbvhandle LIBINTERNAL;
+
+
+/*
+ * Library internal functions
+ */
+extern void _error_logger(const lechar *cfunc, int lineno, const lechar *errstr, const lechar *format, ...) LIBINTERNAL;
+extern int _lib_mode(void) LIBINTERNAL;
+extern int _close(fddef *fdptr, const lechar *filename, int verbose) LIBINTERNAL;
+extern struct handle_s *_cdev_pin_handle_find(leiodcpin lepin, int log) LIBINTERNAL;
+extern leiodcpin_e _cdev_offset_pin_get(struct handle_s *lrhandle, __u32 offset) LIBINTERNAL;
+extern int _cdev_line_get_ioctl(struct handle_s *lrhandle, struct gpio_v2_line_values *linevals) LIBINTERNAL;
+extern int _cdev_line_set_ioctl(struct handle_s *lrhandle, __u32 pinmask, __u32 valmask, enum gpio_v2_line_flag gflag) LIBINTERNAL;
+extern int _cdev_line_edge_set(struct handle_s *lrhandle, __u32 edgemask) LIBINTERNAL;
+extern int _cdev_lines_out_set(struct handle_s *lrhandle, __u32 pinmask, __u32 valmask) LIBINTERNAL;
+extern int _cdev_lines_in_set(struct handle_s *lrhandle, __u32 pinmask) LIBINTERNAL;
+extern void _cdev_lines_uart_invalidate(struct handle_s *lrhandle, __u32 pinmask) LIBINTERNAL;
+extern const lechar *_cdev_chip_prefix(void) LIBINTERNAL;
+extern int _cdev_handle_open(struct handle_s *lrhandle) LIBINTERNAL;
+extern int _boardver_handle_get(void) LIBINTERNAL;
+extern void _boardver_handle_put(void) LIBINTERNAL;
+extern int _uart_gpio_get(uint8_t uartno) LIBINTERNAL;
+extern leiodcpin_e _uart_txen_pin_get(uint8_t uartno, uint8_t interface) LIBINTERNAL;
+extern int _uart_gpio_set(const uint8_t *interface) LIBINTERNAL;
+extern void _uart_cache_reset(void) LIBINTERNAL;
+struct serial_rs485;
+extern int _uart_rs485_set(uint8_t uartno, uint8_t interface, const fddef *fdptr, const struct serial_rs485 *rs485opt) LIBINTERNAL;
+
+
+/*
+ * Statistics (libleiodcstats.c),
+ * define LEIODC_NO_STATS to compile out instrumentation
+ */
+#ifdef LEIODC_NO_STATS
+#define STATS_API(mapi)
+#define STATS_KCALL(mkcall)
+#define STATS_KCALL_HANDLE(mhandle)
+#define STATS_ERROR(merrno)
+#else
+struct statsapi_s {
+	leiodcstatapi_e	api;
+	nanotime_t		start;
+};
+
+#define STATS_API(mapi)\
+		struct statsapi_s __statsapi __attribute__ ((cleanup (_stats_api_end))) = _stats_api_begin(mapi);
+#define STATS_KCALL(mkcall)				_stats_kcall(mkcall);
+#define STATS_KCALL_HANDLE(mhandle)		_stats_kcall(_stats_handle_kcall(mhandle));
+#define STATS_ERROR(merrno)				_stats_error(merrno);
+
+extern struct statsapi_s _stats_api_begin(leiodcstatapi_e api) LIBINTERNAL;
+extern void _stats_api_end(struct statsapi_s *sapi) LIBINTERNAL;
+extern void _stats_kcall(leiodcstatkcall_e kcall) LIBINTERNAL;
+extern leiodcstatkcall_e _stats_handle_kcall(struct handle_s *lrhandle) LIBINTERNAL;
+extern void _stats_error(int errnum) LIBINTERNAL;
+#endif
+
+
+/*
+ * USDT probes (libleiodcprobe.c),
+ * enabled if <sys/sdt.h> is available, define LEIODC_NO_USDT to disable
+ */
+#if !defined LEIODC_NO_USDT && defined __has_include
+#if __has_include(<sys/sdt.h>)
+#define LEIODC_USDT
+#endif
+#endif
+
+#define PROBE_LIST(mprobe)\
+		mprobe(gpio_get_line)\
+		mprobe(gpio_get_values)\
+		mprobe(gpio_set_config)\
+		mprobe(gpio_edge_config)\
+		mprobe(sysfs_open)\
+		mprobe(sysfs_write)\
+		mprobe(uart_rs485)\
+		mprobe(serial_config)\
+		mprobe(rs485_sw_write)
+
+#ifdef LEIODC_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define PROBE_SEMAPHORE(mname)		leiodc_##mname##_semaphore
+#define PROBE_SEMAPHORE_DECLARE(mname)\
+		extern unsigned short PROBE_SEMAPHORE(mname) LIBINTERNAL;
+PROBE_LIST(PROBE_SEMAPHORE_DECLARE)
+
+/* Probe is attached, elapsed time is measured only in this case */
+#define PROBE_TIMESPEC(mtspec)		nanotime_t mtspec;
+#define PROBE_ENABLED(mname)		__builtin_expect(PROBE_SEMAPHORE(mname), 0)
+#define PROBE_TIME_BEGIN(mname, mtspec)\
+		if (PROBE_ENABLED(mname))\
+			clock_gettime(CLOCK_MONOTONIC, &mtspec);
+#define PROBE_ELAPSED(mname, mtspec)	((PROBE_ENABLED(mname)) ? _probe_elapsed(&mtspec) : 0)
+#define PROBE(mname, ...)			STAP_PROBEV(leiodc, mname, __VA_ARGS__);
+
+extern uint64_t _probe_elapsed(const nanotime_t *start) LIBINTERNAL;
+#else
+#define PROBE_TIMESPEC(mtspec)
+#define PROBE_TIME_BEGIN(mname, mtspec)
+#define PROBE(mname, ...)
+#endif
+
+
+/*
+ * Kernel call flight recorder (libleiodcktrace.c),
+ * calls are timed only while recording
+ */
+#define KTRACE_TIMESPEC(mtspec)		nanotime_t mtspec = {0, 0};
+#define KTRACE_ACTIVE()				__builtin_expect(__atomic_load_n(&_ktrace_active, __ATOMIC_RELAXED), 0)
+#define KTRACE_BEGIN(mtspec)\
+		if (KTRACE_ACTIVE())\
+			clock_gettime(CLOCK_MONOTONIC, &mtspec);
+#define KTRACE(mop, mtspec, mminp, mmaxp, mret, ...)\
+		if (KTRACE_ACTIVE())\
+			_ktrace_put(mop, &mtspec, mminp, mmaxp, mret, __VA_ARGS__);
+#define KTRACE_HANDLE(mop, mtspec, mhandle, mret, ...)\
+		KTRACE(mop, mtspec, (mhandle)->minp, (mhandle)->maxp, mret, __VA_ARGS__)
+#define KTRACE_SYSFS(mop, mtspec, mfilename, mwrstring, mret)\
+		if (KTRACE_ACTIVE())\
+			_ktrace_sysfs(mop, &mtspec, mfilename, mwrstring, mret);
+
+extern uint32_t _ktrace_active LIBINTERNAL;
+extern void _ktrace_put(leiodcktop_e op, const nanotime_t *start, uint8_t minp, uint8_t maxp, int ret,
+		uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3, const lechar *payload) LIBINTERNAL;
+extern void _ktrace_sysfs(leiodcktop_e op, const nanotime_t *start, const lechar *filename, const lechar *wrstring, int ret) LIBINTERNAL;
+
+/*
+ * GPIO broker (libleiodcbroker.c)
+ */
+typedef enum {
+	brop_none = 0,
+	brop_pin_init,					// lepin
+	brop_pin_dir_out_state_set,		// lepin, state
+	brop_pin_state_set,				// lepin, state
+	brop_pin_state_get,				// lepin
+	brop_pin_dir_in_set,			// lepin
+	brop_uart_int,					// uartno, interface (GPIOs only)
+	brop_m2_init,
+	brop_m2_config_get,
+	brop_board_ver_get,
+	brop_uart_gpio_get,				// uartno
+	brop_uart_int_all,				// COM1 | (COM2 << 4), COM3 interfaces (GPIOs only)
+	brop_count						// Number of operations, must be the last
+} brokerop_e;
+
+extern int _broker_connect(void) LIBINTERNAL;
+extern int _broker_call(brokerop_e op, uint8_t arg0, uint8_t arg1) LIBINTERNAL;
+
+
+/*
+ * I/O actor (libleiodcactor.c), GPIO operations of the callers
+ * are queued while the I/O thread is running
+ */
+#define ACTOR_QUEUED()	(__builtin_expect(__atomic_load_n(&_actor_active, __ATOMIC_RELAXED), 0) && !_actor_thread)
+
+extern uint32_t _actor_active LIBINTERNAL;
+extern __thread int _actor_thread LIBINTERNAL;
+extern int _actor_call(brokerop_e op, uint8_t arg0, uint8_t arg1) LIBINTERNAL;
+
+
+/*
+ * Deterministic real-time mode (libleiodcrt.c),
+ * error strings are composed without formatting while active
+ */
+#define RT_ACTIVE()		__builtin_expect(__atomic_load_n(&_rt_active, __ATOMIC_RELAXED), 0)
+
+extern uint32_t _rt_active LIBINTERNAL;
+extern void _rt_error_logger(const lechar *cfunc, int lineno, int errnum, const lechar *format) LIBINTERNAL;
+extern void _rt_mutex_init(pthread_mutex_t *mutex) LIBINTERNAL;
+
+
+/*
+ * Pin state mirror (libleiodcstate.c)
+ */
+extern void _state_lines_update(struct handle_s *lrhandle, __u32 linemask, __u32 values, leiodcpindir_e dir) LIBINTERNAL;
+extern void _state_pin_update(leiodcpin lepin, leiodcpindir_e dir, int value) LIBINTERNAL;
+extern void _state_uart_update(uint8_t uartno, uint8_t interface) LIBINTERNAL;
+extern uint8_t _state_uart_get(uint8_t uartno) LIBINTERNAL;
+extern leiodcpindir_e _state_pin_dir_get(leiodcpin lepin) LIBINTERNAL;
+extern void _state_m2_update(int m2config) LIBINTERNAL;
+extern void _state_boardver_update(int boardver) LIBINTERNAL;
+
+
+/*
+ * Serial port setup and RS485 userspace direction control (libleiodcserial.c)
+ */
+extern uint64_t _serial_char_time(fddef fd) LIBINTERNAL;
+extern int _serial_is_pty(fddef fd) LIBINTERNAL;
+extern int _rs485_sw_txen_set(uint8_t uartno, int on) LIBINTERNAL;
+extern uint64_t _rs485_sw_charns(uint8_t uartno) LIBINTERNAL;
+extern int _rs485_sw_empty(uint8_t uartno) LIBINTERNAL;
+
+
+/*
+ * Serial line health monitor (libleiodchealth.c)
+ */
+extern void _health_port_set(uint8_t uartno, fddef fd) LIBINTERNAL;
+
+
+/*
+ * Serial traffic capture (libleiodccapture.c)
+ */
+struct iovec;
+extern int _capture_port(uint8_t uartno, uint8_t dir) LIBINTERNAL;
+extern void _capture_put(uint8_t uartno, uint8_t dir, const nanotime_t *timestamp, const struct iovec *iov, int iovcnt) LIBINTERNAL;
+
+
+/*
+ * Pin history recorder (libleiodchistory.c)
+ */
+extern void _history_lines(struct handle_s *lrhandle, __u32 linemask, __u32 values, leiodcpindir_e dir) LIBINTERNAL;
+extern void _history_pin(leiodcpin lepin, leiodcpindir_e dir, int value) LIBINTERNAL;
+extern void _history_uart(uint8_t uartno, uint8_t interface) LIBINTERNAL;
+extern void _history_ext(uint8_t ext, int value) LIBINTERNAL;
+extern void _history_edge(leiodcpin lepin, const struct gpio_v2_line_event *event) LIBINTERNAL;
+
+
+/*
+ * Emergency safe-state (libleiodcsafe.c)
+ */
+extern void _safe_handle_update(struct handle_s *lrhandle) LIBINTERNAL;
+
+
+/*
+ * Event thread (libleiodcevent.c)
+ */
+typedef void (*evtfd_cb)(fddef fd, uint32_t events, void *arg);
+typedef void (*evtedge_cb)(struct handle_s *lrhandle, leiodcpin_e lepin, const struct gpio_v2_line_event *event, void *arg);
+
+extern int _evt_fd_add(fddef fd, evtfd_cb callback, void *arg) LIBINTERNAL;
+extern int _evt_fd_del(fddef fd) LIBINTERNAL;
+extern int _evt_fd_mod(fddef fd, uint32_t events) LIBINTERNAL;
+extern void _evt_lock(void) LIBINTERNAL;
+extern void _evt_unlock(void) LIBINTERNAL;
+extern int _evt_edge_add(struct handle_s *lrhandle, __u32 pinmask, evtedge_cb callback, void *arg) LIBINTERNAL;
+extern int _evt_edge_del(struct handle_s *lrhandle, __u32 pinmask) LIBINTERNAL;
+#endif /* LIBLEIODCINT_H_ */
@@ -0,0 +1,562 @@
+/*
+ ============================================================================
+ Name        : libleiodcktrace.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC kernel call flight recorder. ioctl() and sysfs calls
+               of the library are recorded with arguments and duration to
+               a lock-free memory ring, writers only reserve a slot with an
+               atomic increment. Ring is dumped to a trace file on demand
+               or from the crash signal handler (async-signal-safe).
+               Recorded calls can be replayed through the library, e.g.
+               against gpio-sim chips selected by LEIODC_GPIO_CHIP.
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  Record payload is always zero terminated
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <fcntl.h>			// File controls
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>	// serial port UAPI
+
+#include "libleiodcint.h"
+
+
+#define KTRACE_RING_DEFAULT		8192		// Records kept in the ring
+#define KTRACE_RING_MAX			1048576
+#define KTRACE_DUMP_BATCH		64			// Records written to the trace file with one write()
+#define KTRACE_REPLAY_HANDLES	4			// Replayed line requests outside the handle table
+#define KTRACE_REPLAY_HANDLE(mhandle)\
+		(((mhandle) >= glktrace.replay) && ((mhandle) < &glktrace.replay[KTRACE_REPLAY_HANDLES]))
+
+
+/*
+ * Ring slot, sequence is odd while the record is written
+ */
+struct ktslot_s {
+	uint64_t			seq;			// 2 * index + 2 when record is complete
+	leiodcktrec_t		rec;
+};
+
+
+uint32_t _ktrace_active;
+
+
+static struct {
+	struct ktslot_s		*ring;
+	uint32_t			size;			// Power of 2
+	uint64_t			head;			// Index of the next record
+	uint32_t			writers;		// Writers between active check and slot completion
+	uint32_t			flags;			// LEIODC_KTRACE_xxx
+	lechar				dumppath[GPIO_PATH_LENGTH];
+	struct sigaction	oldact[5];		// Dispositions replaced by the crash dump handler
+	struct handle_s		replay[KTRACE_REPLAY_HANDLES];
+} glktrace;
+
+
+/*
+ * Signals the crash dump is installed for
+ */
+static const int KtsigTable[] = {
+	SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT,
+};
+
+
+
+
+/*
+ * Record kernel call, errno is preserved
+ * start - CLOCK_MONOTONIC time taken before the call,
+ * record is skipped if recording was started during the call
+ * [18/10/2026]
+ */
+void _ktrace_put(leiodcktop_e op, const nanotime_t *start, uint8_t minp, uint8_t maxp, int ret,
+		uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3, const lechar *payload) {
+	struct ktslot_s		*slot;
+	nanotime_t			now;
+	uint64_t			index;
+	size_t				len;
+	int					saverrno = errno;
+
+
+	__atomic_fetch_add(&glktrace.writers, 1, __ATOMIC_ACQUIRE);
+	if (!__atomic_load_n(&_ktrace_active, __ATOMIC_ACQUIRE) || (!start->tv_sec && !start->tv_nsec))
+		goto done;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	index = __atomic_fetch_add(&glktrace.head, 1, __ATOMIC_RELAXED);
+	slot = &glktrace.ring[index & (glktrace.size - 1)];
+
+	__atomic_store_n(&slot->seq, (index << 1) + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	slot->rec.start = ((uint64_t) start->tv_sec * SECINNSEC) + start->tv_nsec;
+	slot->rec.elapsed = (((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec) - slot->rec.start;
+	slot->rec.op = op;
+	slot->rec.minp = minp;
+	slot->rec.maxp = maxp;
+	slot->rec.pad = 0;
+	slot->rec.ret = ret;
+	slot->rec.arg[0] = arg0;
+	slot->rec.arg[1] = arg1;
+	slot->rec.arg[2] = arg2;
+	slot->rec.arg[3] = arg3;
+	len = (payload) ? strnlen(payload, sizeof(slot->rec.payload) - 1) : 0;
+	if (len)
+		memcpy(slot->rec.payload, payload, len);
+	slot->rec.payload[len] = '\0';
+
+	__atomic_store_n(&slot->seq, (index << 1) + 2, __ATOMIC_RELEASE);
+
+
+	done:
+	__atomic_fetch_sub(&glktrace.writers, 1, __ATOMIC_RELEASE);
+	errno = saverrno;
+}
+
+
+/*
+ * Record sysfs open() or write(), path is recorded
+ * relative to the sysfs GPIO directory
+ * [18/10/2026]
+ */
+void _ktrace_sysfs(leiodcktop_e op, const nanotime_t *start, const lechar *filename, const lechar *wrstring, int ret) {
+	lechar		payload[sizeof(((leiodcktrec_t *) 0)->payload)];
+
+
+	if (!strncmp(filename, GPIO_SYSFS_DIR, sizeof(GPIO_SYSFS_DIR) - 1))
+		filename += sizeof(GPIO_SYSFS_DIR) - 1;
+
+	snprintf(payload, sizeof(payload), "%s%s%s", filename, (wrstring) ? "=" : "", (wrstring) ? wrstring : "");
+	_ktrace_put(op, start, 0, 0, ret, 0, 0, 0, 0, payload);
+}
+
+
+/*
+ * Copy complete record of the ring index
+ * Return -1 if record was overwritten or is being written
+ * [18/10/2026]
+ */
+static int _ktrace_copy(uint64_t index, leiodcktrec_t *rec) {
+	const struct ktslot_s	*slot = &glktrace.ring[index & (glktrace.size - 1)];
+	uint64_t				seq;
+
+
+	seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+	if (seq != ((index << 1) + 2))
+		return RETVAL_NEGATIVE;
+
+	memcpy(rec, &slot->rec, sizeof(*rec));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq) ? RETVAL_OK : RETVAL_NEGATIVE;
+}
+
+
+/*
+ * Write records of the ring to the file oldest first,
+ * async-signal-safe: nothing is logged, allocated or locked
+ * Return number of records written or -1 on error
+ * [18/10/2026]
+ */
+static int _ktrace_dump_fd(fddef fd) {
+	leiodcktrec_t		batch[KTRACE_DUMP_BATCH];
+	leiodcktfile_t		filehdr;
+	uint64_t			index, head;
+	uint32_t			used = 0;
+	size_t				wrsize;
+
+
+	memset(&filehdr, 0, sizeof(filehdr));
+	filehdr.magic = LEIODC_KTRACE_MAGIC;
+	filehdr.version = LEIODC_KTRACE_VERSION;
+	filehdr.recsize = sizeof(leiodcktrec_t);
+	if (write(fd, &filehdr, sizeof(filehdr)) != sizeof(filehdr))
+		return RETVAL_NEGATIVE;
+
+	head = __atomic_load_n(&glktrace.head, __ATOMIC_ACQUIRE);
+	index = (head > glktrace.size) ? head - glktrace.size : 0;
+	filehdr.lost = index;
+	for (; index < head; index++) {
+		if (_ktrace_copy(index, &batch[used])) {
+			filehdr.lost++;
+			continue;
+		}
+
+		if (++used == ARRAY_SIZE(batch)) {
+			wrsize = used * sizeof(batch[0]);
+			if (write(fd, batch, wrsize) != wrsize)
+				return RETVAL_NEGATIVE;
+			filehdr.count += used;
+			used = 0;
+		}
+	}
+
+	if (used) {
+		wrsize = used * sizeof(batch[0]);
+		if (write(fd, batch, wrsize) != wrsize)
+			return RETVAL_NEGATIVE;
+		filehdr.count += used;
+	}
+
+	if (pwrite(fd, &filehdr, sizeof(filehdr), 0) != sizeof(filehdr))
+		return RETVAL_NEGATIVE;
+	return filehdr.count;
+}
+
+
+/*
+ * Restore signal dispositions replaced by the crash dump handler
+ * [18/10/2026]
+ */
+static void _ktrace_signals_restore(void) {
+	int		i;
+
+
+	if (!(glktrace.flags & LEIODC_KTRACE_CRASHDUMP))
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(KtsigTable); i++)
+		sigaction(KtsigTable[i], &glktrace.oldact[i], NULL);
+	glktrace.flags &= ~LEIODC_KTRACE_CRASHDUMP;
+}
+
+
+/*
+ * Crash signal handler, recording is stopped and the ring is dumped once,
+ * previous disposition of the signal is restored, SIGABRT is raised again,
+ * other signals are raised by the faulting instruction
+ * [18/10/2026]
+ */
+static void _ktrace_signal(int signo) {
+	fddef	fd;
+	int		i, saverrno = errno;
+
+
+	if (__atomic_exchange_n(&_ktrace_active, 0, __ATOMIC_ACQ_REL)) {
+		if ((fd = open(glktrace.dumppath, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0) {
+			_ktrace_dump_fd(fd);
+			close(fd);
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(KtsigTable); i++) {
+		if (KtsigTable[i] == signo) {
+			sigaction(signo, &glktrace.oldact[i], NULL);
+			break;
+		}
+	}
+
+	if (signo == SIGABRT)
+		raise(signo);		// Delivered when handler returns
+	errno = saverrno;
+}
+
+
+/*
+ * Start recording kernel calls, records of the previous recording are discarded
+ * ktracecfg - ring size and crash dump settings, can be NULL
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_ktrace_start(const leiodcktracecfg_t *ktracecfg) {
+	struct sigaction	sigact;
+	uint32_t			ringsize = KTRACE_RING_DEFAULT, size = 1;
+	int					i;
+
+
+	if (__atomic_load_n(&_ktrace_active, __ATOMIC_ACQUIRE)) {
+		ERROR_LOGGER("Kernel calls are already recorded")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (ktracecfg && ktracecfg->ringsize)
+		ringsize = ktracecfg->ringsize;
+	if (ringsize > KTRACE_RING_MAX) {
+		ERROR_LOGGER("Kernel call ring size %u exceeds %u", ringsize, KTRACE_RING_MAX)
+		return RETVAL_NEGATIVE;
+	}
+	while (size < ringsize)
+		size <<= 1;
+
+	if (ktracecfg && (ktracecfg->flags & LEIODC_KTRACE_CRASHDUMP)) {
+		if (!ktracecfg->dumppath || !*ktracecfg->dumppath ||
+				(strlen(ktracecfg->dumppath) >= sizeof(glktrace.dumppath))) {
+			ERROR_LOGGER("Kernel call crash dump file is not specified or too long")
+			return RETVAL_NEGATIVE;
+		}
+	}
+
+	/*
+	 * Writers which saw recording active finish before the ring is replaced
+	 */
+	while (__atomic_load_n(&glktrace.writers, __ATOMIC_ACQUIRE))
+		sched_yield();
+
+	if (glktrace.size != size) {
+		free(glktrace.ring);
+		glktrace.size = 0;
+		if (!(glktrace.ring = calloc(size, sizeof(*glktrace.ring)))) {
+			ERROR_STD_LOGGER("Kernel call ring (%u records)", size)
+			return RETVAL_NEGATIVE;
+		}
+		glktrace.size = size;
+	}
+	else
+		memset(glktrace.ring, 0, size * sizeof(*glktrace.ring));
+	glktrace.head = 0;
+
+	if (ktracecfg && (ktracecfg->flags & LEIODC_KTRACE_CRASHDUMP)) {
+		strcpy(glktrace.dumppath, ktracecfg->dumppath);
+
+		memset(&sigact, 0, sizeof(sigact));
+		sigact.sa_handler = _ktrace_signal;
+		sigact.sa_flags = SA_ONSTACK;
+		sigfillset(&sigact.sa_mask);
+		for (i = 0; i < ARRAY_SIZE(KtsigTable); i++) {
+			if (sigaction(KtsigTable[i], &sigact, &glktrace.oldact[i])) {
+				ERROR_STD_LOGGER("sigaction(%d)", KtsigTable[i])
+				while (i--)
+					sigaction(KtsigTable[i], &glktrace.oldact[i], NULL);
+				return RETVAL_NEGATIVE;
+			}
+		}
+		glktrace.flags |= LEIODC_KTRACE_CRASHDUMP;
+	}
+
+	__atomic_store_n(&_ktrace_active, 1, __ATOMIC_RELEASE);
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_ktrace_start)
+
+
+/*
+ * Stop recording, records are kept until the next start
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_ktrace_stop(void) {
+
+	__atomic_store_n(&_ktrace_active, 0, __ATOMIC_RELEASE);
+	_ktrace_signals_restore();
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_ktrace_stop)
+
+
+/*
+ * Write recorded kernel calls to the trace file,
+ * recording is not interrupted
+ * Return number of records written or -1 on error
+ * [18/10/2026]
+ */
+int leiodc_ktrace_dump(const lechar *path) {
+	fddef		fd;
+	int			retstat;
+
+
+	if (!glktrace.ring) {
+		ERROR_LOGGER("Kernel calls were not recorded")
+		return RETVAL_NEGATIVE;
+	}
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		ERROR_STD_LOGGER("open(%s)", path)
+		return RETVAL_NEGATIVE;
+	}
+
+	if ((retstat = _ktrace_dump_fd(fd)) < 0) {
+		ERROR_STD_LOGGER("write(%s)", path)
+	}
+
+	if (close(fd)) {
+		ERROR_STD_LOGGER("close(%s)", path)
+		retstat = RETVAL_NEGATIVE;
+	}
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_ktrace_dump)
+
+
+/*
+ * Find GPIO line handle of the recorded pin range,
+ * line requests outside the handle table (board version, sampler)
+ * are replayed with handles of the replay table
+ * [18/10/2026]
+ */
+static struct handle_s *_ktrace_handle_get(const leiodcktrec_t *rec) {
+	struct handle_s		*lrhandle;
+	int					i;
+
+
+	for (i = 0; i < handle_count; i++) {
+		if ((glrhandles[i].minp == rec->minp) && (glrhandles[i].maxp == rec->maxp))
+			return &glrhandles[i];
+	}
+
+	for (i = 0; i < KTRACE_REPLAY_HANDLES; i++) {
+		lrhandle = &glktrace.replay[i];
+		if ((lrhandle->minp == rec->minp) && (lrhandle->maxp == rec->maxp))
+			return lrhandle;
+	}
+
+	if ((rec->op == leiodckt_get_line) && (rec->minp > 0) && (rec->maxp < lepin_count) && (rec->minp <= rec->maxp)) {
+		for (i = 0; i < KTRACE_REPLAY_HANDLES; i++) {
+			lrhandle = &glktrace.replay[i];
+			if (!lrhandle->minp) {
+				lrhandle->name = "ktrace-replay";
+				lrhandle->minp = rec->minp;
+				lrhandle->maxp = rec->maxp;
+				return lrhandle;
+			}
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Replay sysfs write, sysfs file is opened and closed by the replay
+ * [18/10/2026]
+ */
+static int _ktrace_sysfs_replay(const leiodcktrec_t *rec) {
+	lechar		path[GPIO_PATH_LENGTH];
+	lechar		*wrstring;
+	ssize_t		wrsize;
+	fddef		fd;
+	KTRACE_TIMESPEC(ktts)
+
+
+	snprintf(path, sizeof(path), GPIO_SYSFS_DIR "%.*s", (int) sizeof(rec->payload), rec->payload);
+	if (!(wrstring = strchr(path, '=')))
+		return 1;
+	*wrstring++ = '\0';
+
+	KTRACE_BEGIN(ktts)
+	fd = open(path, O_WRONLY);
+	KTRACE_SYSFS(leiodckt_sysfs_open, ktts, path, NULL, (fd < 0) ? -errno : fd)
+	if (fd < 0) {
+		ERROR_STD_LOGGER("open(%s)", path)
+		return RETVAL_NEGATIVE;
+	}
+
+	KTRACE_BEGIN(ktts)
+	wrsize = write(fd, wrstring, strlen(wrstring));
+	KTRACE_SYSFS(leiodckt_sysfs_write, ktts, path, wrstring, (wrsize < 0) ? -errno : wrsize)
+	if (wrsize < 0) {
+		ERROR_STD_LOGGER("write(%s)", path)
+	}
+	close(fd);
+	return (wrsize < 0) ? RETVAL_NEGATIVE : RETVAL_OK;
+}
+
+
+/*
+ * Replay recorded kernel call through the library,
+ * GPIO calls are replayed only in GPIO line access mode,
+ * sysfs writes only in legacy sysfs mode
+ * ttyfd - tty (or pty) TIOCSRS485 is replayed on, 0 - RS485 calls are not replayed
+ * Return 1 if call was not replayed, -1 if replayed call failed
+ * [18/10/2026]
+ */
+int leiodc_ktrace_replay(const leiodcktrec_t *rec, fddef ttyfd) {
+	struct handle_s				*lrhandle;
+	struct gpio_v2_line_values	linevals;
+	struct serial_rs485			rs485opt;
+	int							retstat;
+	KTRACE_TIMESPEC(ktts)
+
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	switch (rec->op) {
+	case leiodckt_rs485:
+		if (!ttyfd || (rec->minp >= LEIODC_UART_COUNT))
+			return 1;
+		memset(&rs485opt, 0, sizeof(rs485opt));
+		rs485opt.delay_rts_before_send = rec->arg[3] >> 16;
+		rs485opt.delay_rts_after_send = rec->arg[3] & 0xFFFF;
+		return _uart_rs485_set(rec->minp, rec->arg[0], &ttyfd, &rs485opt);
+
+	case leiodckt_sysfs_write:
+		return (libmode == mode_sysfs) ? _ktrace_sysfs_replay(rec) : 1;
+
+	case leiodckt_sysfs_open:
+		return 1;		// Opened by the replayed write
+
+	default:
+		break;
+	}
+
+	if ((libmode != mode_cdev) || (rec->op >= leiodckt_count) || !(lrhandle = _ktrace_handle_get(rec)))
+		return 1;
+
+	if (rec->op == leiodckt_get_line) {
+		if (lrhandle->fd) {
+			if (!KTRACE_REPLAY_HANDLE(lrhandle))
+				return 1;		// Lines of the table handles are requested once
+			_close(&lrhandle->fd, lrhandle->name, 0);
+		}
+		lrhandle->edgemask = 0;
+		return _cdev_handle_open(lrhandle);
+	}
+
+	if (!lrhandle->fd)
+		return 1;
+
+	switch (rec->op) {
+	case leiodckt_set_config:
+		if (rec->arg[0] & lrhandle->edgemask)
+			return 1;
+		return _cdev_line_set_ioctl(lrhandle, rec->arg[0], rec->arg[1], rec->arg[2]);
+
+	case leiodckt_edge_config:
+		if (KTRACE_REPLAY_HANDLE(lrhandle))
+			return 1;
+		return _cdev_line_edge_set(lrhandle, rec->arg[0]);
+
+	case leiodckt_get_values:
+		memset(&linevals, 0, sizeof(linevals));
+		linevals.mask = rec->arg[0];
+		return _cdev_line_get_ioctl(lrhandle, &linevals);
+
+	case leiodckt_set_values:
+		memset(&linevals, 0, sizeof(linevals));
+		linevals.mask = rec->arg[0];
+		linevals.bits = rec->arg[1];
+
+		KTRACE_BEGIN(ktts)
+		STATS_KCALL_HANDLE(lrhandle)
+		retstat = ioctl(lrhandle->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &linevals);
+		KTRACE_HANDLE(leiodckt_set_values, ktts, lrhandle, (retstat) ? -errno : 0, linevals.mask, linevals.bits, 0, 0, NULL)
+		if (retstat) {
+			ERROR_STD_LOGGER("GPIO ioctl(%s, %s)", lrhandle->name, STRINGIFY_(GPIO_V2_LINE_SET_VALUES_IOCTL))
+			return RETVAL_NEGATIVE;
+		}
+		return RETVAL_OK;
+
+	default:
+		break;
+	}
+	return 1;
+}
+EXPORT_SYMBOL(leiodc_ktrace_replay)
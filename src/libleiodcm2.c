@@ -0,0 +1,185 @@
+/*
+ ============================================================================
+ Name        : libleiodcm2.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC M.2 card change detection using
+               edge events of the CONFIG pins
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  Event thread callback receives epoll events
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "libleiodcint.h"
+
+
+#define M2_WATCH_DEBOUNCE_MS	50			// Default debounce time of the CONFIG pin group
+#define M2_CONFIG_PIN_MASK		(HANDLE_PIN_BIT(&glrhandles[handle_modem], lepin_M2_cfg0) * 0x0F)
+
+
+static struct {
+	leiodcm2cb_t	callback;
+	void			*arg;
+	fddef			timerfd;
+	uint32_t		debouncems;
+	uint8_t			config;				// Last reported M.2 config
+	nanotime_t		edgetime;			// Time of the last CONFIG pin edge
+} glm2watch;
+
+
+
+
+/*
+ * CONFIG pin edge, (re)start debounce timer
+ * [18/10/2026]
+ */
+static void _m2_watch_edge(struct handle_s *lrhandle, leiodcpin_e lepin, const struct gpio_v2_line_event *event, void *arg) {
+	struct itimerspec	tspec;
+
+
+	glm2watch.edgetime.tv_sec = event->timestamp_ns / SECINNSEC;
+	glm2watch.edgetime.tv_nsec = event->timestamp_ns % SECINNSEC;
+
+	memset(&tspec, 0, sizeof(tspec));
+	tspec.it_value.tv_sec = glm2watch.debouncems / 1000;
+	tspec.it_value.tv_nsec = (glm2watch.debouncems % 1000) * MSECINNSEC;
+	if (timerfd_settime(glm2watch.timerfd, 0, &tspec, NULL)) {
+		ERROR_STD_LOGGER("timerfd_settime(%u ms)", glm2watch.debouncems)
+	}
+}
+
+
+/*
+ * CONFIG pins settled, report change if config differs from the last one
+ * [18/10/2026]
+ */
+static void _m2_watch_timer(fddef fd, uint32_t events, void *arg) {
+	leiodcm2event_t		m2event;
+	uint64_t			expirations;
+	int					cfgbyte;
+
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return;
+
+	if ((cfgbyte = leiodc_m2_config_get()) < 0)
+		return;
+
+	if (cfgbyte == glm2watch.config)
+		return;		// Glitch, CONFIG pins returned to the previous state
+
+	m2event.oldcfg = glm2watch.config;
+	m2event.newcfg = cfgbyte;
+	m2event.timestamp = glm2watch.edgetime;
+	glm2watch.config = cfgbyte;
+
+	glm2watch.callback(&m2event, glm2watch.arg);
+}
+
+
+/*
+ * Start watching M.2 card config changes,
+ * callback is executed from the library event thread
+ * when CONFIG pins settle for debounce time (0 - use default)
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_m2_watch_start(leiodcm2cb_t callback, void *arg, uint32_t debouncems) {
+	struct handle_s		*lrhandle = &glrhandles[handle_modem];
+	int					cfgbyte;
+
+
+	if (!callback) {
+		ERROR_LOGGER("M.2 config watch callback is not specified")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (glm2watch.callback) {
+		ERROR_LOGGER("M.2 config watch is already running")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (leiodc_m2_init())
+		return RETVAL_NEGATIVE;
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("M.2 config watch requires GPIO line access (not available with GPIO broker)")
+		return RETVAL_NEGATIVE;
+	}
+
+	if ((glm2watch.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("timerfd_create()")
+		glm2watch.timerfd = 0;
+		return RETVAL_NEGATIVE;
+	}
+
+	glm2watch.callback = callback;
+	glm2watch.arg = arg;
+	glm2watch.debouncems = (debouncems) ? debouncems : M2_WATCH_DEBOUNCE_MS;
+
+	if (_evt_fd_add(glm2watch.timerfd, _m2_watch_timer, NULL))
+		goto failed;
+
+	if (_evt_edge_add(lrhandle, M2_CONFIG_PIN_MASK, _m2_watch_edge, NULL)) {
+		_evt_fd_del(glm2watch.timerfd);
+		goto failed;
+	}
+
+	/*
+	 * Initial config is read after enabling edge detection,
+	 * change in between is reported when debounce timer expires
+	 */
+	if ((cfgbyte = leiodc_m2_config_get()) < 0) {
+		leiodc_m2_watch_stop();
+		return RETVAL_NEGATIVE;
+	}
+	glm2watch.config = cfgbyte;
+	return RETVAL_OK;
+
+
+	failed:
+	_close(&glm2watch.timerfd, "timerfd", 1);
+	memset(&glm2watch, 0, sizeof(glm2watch));
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_m2_watch_start)
+
+
+/*
+ * Stop watching M.2 card config changes,
+ * callback is not executed once this function returns
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_m2_watch_stop(void) {
+	int		retstat = RETVAL_OK;
+
+
+	if (!glm2watch.callback)
+		return RETVAL_OK;
+
+	if (_evt_edge_del(&glrhandles[handle_modem], M2_CONFIG_PIN_MASK))
+		retstat = RETVAL_NEGATIVE;
+
+	_evt_fd_del(glm2watch.timerfd);
+	_close(&glm2watch.timerfd, "timerfd", 1);
+	memset(&glm2watch, 0, sizeof(glm2watch));
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_m2_watch_stop)
@@ -0,0 +1,62 @@
+/*
+ ============================================================================
+ Name        : libleiodcprobe.c
+ Author      : AK
+ Version     : V1.00
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC library USDT probe semaphores.
+               Probes are placed on every kernel interaction, provider 'leiodc':
+
+  gpio_get_line(chip, handle, num_lines, fd_or_ret, elapsed_ns)
+  gpio_get_values(handle, mask, bits, ret, elapsed_ns)
+  gpio_set_config(handle, pinmask, valmask, flags, edgemask, ret, elapsed_ns)
+  gpio_edge_config(handle, edgemask, ret, elapsed_ns)
+  sysfs_open(path, fd, elapsed_ns)
+  sysfs_write(path, string, ret, elapsed_ns)
+  uart_rs485(ttyfd, uartno, interface, rs485flags, txpad, ret, elapsed_ns)
+  serial_config(ttyfd, uartno, baud, ret, elapsed_ns)
+  rs485_sw_write(uartno, len, ret, drain_ns, turn_ns)
+
+  Elapsed time is measured only while a probe is attached, e.g.
+  bpftrace -e 'usdt:/usr/lib/libleiodc.so.3:leiodc:gpio_set_config
+      { @[str(arg0)] = hist(arg6); }'
+
+  Change log :
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "libleiodcint.h"
+
+
+#ifdef LEIODC_USDT
+/*
+ * Semaphores are incremented by the tracer when probe is attached
+ */
+#define PROBE_SEMAPHORE_DEFINE(mname)\
+		unsigned short PROBE_SEMAPHORE(mname) __attribute__ ((section (".probes")));
+PROBE_LIST(PROBE_SEMAPHORE_DEFINE)
+
+
+
+
+/*
+ * Time elapsed since start (ns)
+ * [18/10/2026]
+ */
+uint64_t _probe_elapsed(const nanotime_t *start) {
+	nanotime_t		now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (((uint64_t) (now.tv_sec - start->tv_sec)) * SECINNSEC) + now.tv_nsec - start->tv_nsec;
+}
+#endif	// LEIODC_USDT
@@ -0,0 +1,255 @@
+/*
+ ============================================================================
+ Name        : libleiodcrt.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC deterministic real-time mode. All GPIO line handles
+               are requested, process memory is locked and the stack of
+               the calling thread is prefaulted when the mode is started.
+               While the mode is active pin and UART interface calls
+               don't allocate memory, don't format error strings and
+               don't initialize GPIO access lazily, errors are reported
+               with the unformatted message, line and errno.
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  Priority inheritance mutexes for locks taken by pin and UART calls
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+#include <malloc.h>			// mallopt
+#include <alloca.h>
+#include <pthread.h>
+#include <sys/mman.h>		// mlockall
+
+#include "libleiodcint.h"
+
+
+#define RT_STACK_DEFAULT		(64 * 1024)		// Stack prefaulted by default (bytes)
+#define RT_TRIM_THRESHOLD		(128 * 1024)	// glibc malloc defaults restored on stop
+#define RT_MMAP_MAX				65536
+
+
+uint32_t _rt_active;
+
+
+static struct {
+	uint32_t			flags;			// LEIODC_RT_xxx
+	int					locked;			// mlockall() succeeded
+} glrt;
+
+
+
+
+/*
+ * Append string to the error string
+ * [18/10/2026]
+ */
+static void _rt_error_append(size_t *lenptr, const lechar *str) {
+
+	while (*str && (*lenptr < (LIB_ERROR_STRING_LENGTH - 1)))
+		LibErrorString[(*lenptr)++] = *str++;
+	LibErrorString[*lenptr] = '\0';
+}
+
+
+/*
+ * Append decimal number to the error string
+ * [18/10/2026]
+ */
+static void _rt_error_number(size_t *lenptr, unsigned int num) {
+	lechar		digits[12];
+	int			pos = sizeof(digits) - 1;
+
+
+	digits[pos] = '\0';
+	do {
+		digits[--pos] = '0' + (num % 10);
+		num /= 10;
+	} while (num);
+	_rt_error_append(lenptr, &digits[pos]);
+}
+
+
+/*
+ * Compose error string without formatting,
+ * arguments of the message are not substituted
+ * [18/10/2026]
+ */
+void _rt_error_logger(const lechar *cfunc, int lineno, int errnum, const lechar *format) {
+	size_t		len = 0;
+
+
+	_rt_error_append(&len, "libleiodc ");
+	_rt_error_append(&len, cfunc);
+	_rt_error_append(&len, "(): ");
+	_rt_error_append(&len, format);
+	_rt_error_append(&len, " [line ");
+	_rt_error_number(&len, lineno);
+	if (errnum) {
+		_rt_error_append(&len, ", errno ");
+		_rt_error_number(&len, errnum);
+	}
+	_rt_error_append(&len, "]");
+}
+
+
+/*
+ * Initialize mutex taken by pin and UART calls with priority inheritance,
+ * a real-time caller blocked by a lower priority holder (e.g. the event
+ * thread) boosts the holder. Uncontended locking doesn't enter the kernel.
+ * [18/10/2026]
+ */
+void _rt_mutex_init(pthread_mutex_t *mutex) {
+	pthread_mutexattr_t		attr;
+
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+	pthread_mutex_init(mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+
+/*
+ * Touch every page of the stack below the caller
+ * [18/10/2026]
+ */
+static __attribute__((noinline)) void _rt_stack_prefault(uint32_t stacksize) {
+	volatile uint8_t	*stack;
+	long				pagesize = sysconf(_SC_PAGESIZE);
+	uint32_t			i;
+
+
+	stack = alloca(stacksize);
+	for (i = 0; i < stacksize; i += pagesize)
+		stack[i] = 0;
+}
+
+
+/*
+ * Start deterministic real-time mode, GPIO line handles are requested
+ * and memory is locked, must be called before real-time threads start
+ * rtcfg - stack size to prefault and flags, can be NULL
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_rt_start(const leiodcrtcfg_t *rtcfg) {
+	leiodcpin		pintable[handle_count];
+	uint32_t		stacksize = RT_STACK_DEFAULT;
+	int				h;
+
+
+	if (_rt_active) {
+		ERROR_LOGGER("Real-time mode is already active")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (rtcfg) {
+		glrt.flags = rtcfg->flags;
+		if (rtcfg->stacksize)
+			stacksize = rtcfg->stacksize;
+	}
+	else
+		glrt.flags = 0;
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("Real-time mode requires GPIO line access (mode=%u)", libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+	/*
+	 * One pin of each handle requests all lines of the handle
+	 */
+	for (h = 0; h < handle_count; h++)
+		pintable[h] = glrhandles[h].minp;
+	if (leiodc_pin_init(pintable, ARRAY_SIZE(pintable)))
+		return RETVAL_NEGATIVE;
+
+	if (!(glrt.flags & LEIODC_RT_NO_MLOCK)) {
+		/*
+		 * Freed memory stays mapped and locked,
+		 * large allocations don't create new mappings
+		 */
+		mallopt(M_TRIM_THRESHOLD, -1);
+		mallopt(M_MMAP_MAX, 0);
+
+		if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+			ERROR_STD_LOGGER("mlockall()")
+			goto failed;
+		}
+		glrt.locked = 1;
+	}
+
+	_rt_stack_prefault(stacksize);
+
+	__atomic_store_n(&_rt_active, 1, __ATOMIC_SEQ_CST);
+	return RETVAL_OK;
+
+
+	failed:
+	mallopt(M_TRIM_THRESHOLD, RT_TRIM_THRESHOLD);
+	mallopt(M_MMAP_MAX, RT_MMAP_MAX);
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_rt_start)
+
+
+/*
+ * Stop deterministic real-time mode, memory is unlocked,
+ * GPIO line handles remain requested
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_rt_stop(void) {
+
+	if (!_rt_active)
+		return RETVAL_OK;
+
+	__atomic_store_n(&_rt_active, 0, __ATOMIC_SEQ_CST);
+
+	if (glrt.locked) {
+		glrt.locked = 0;
+		mallopt(M_TRIM_THRESHOLD, RT_TRIM_THRESHOLD);
+		mallopt(M_MMAP_MAX, RT_MMAP_MAX);
+
+		if (munlockall()) {
+			ERROR_STD_LOGGER("munlockall()")
+			return RETVAL_NEGATIVE;
+		}
+	}
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_rt_stop)
+
+
+/*
+ * Prefault stack of the calling thread,
+ * called by every real-time thread before entering its loop
+ * stacksize - bytes to prefault, 0 - 64 KiB
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_rt_thread_prepare(uint32_t stacksize) {
+
+	_rt_stack_prefault((stacksize) ? stacksize : RT_STACK_DEFAULT);
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_rt_thread_prepare)
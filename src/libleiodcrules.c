@@ -0,0 +1,370 @@
+/*
+ ============================================================================
+ Name        : libleiodcrules.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC reflex rules. Input edge drives output pin directly
+               on the line event read path of the library event thread,
+               without a round trip through the application. Rules fired
+               by the same edge are merged to one ioctl per GPIO line handle.
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  Failed start removes edge detection only from handles it was added to
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+#include <time.h>
+
+#include "libleiodcint.h"
+
+
+#define RULE_PIN_BIT(mpin)		((uint64_t) 1 << (mpin))
+
+
+/*
+ * Compiled rule
+ */
+struct rule_s {
+	leiodcrule_t		def;
+	struct handle_s		*outhandle;
+	__u32				outbit;			// Line bit of the output pin
+	uint8_t				next;			// Next rule of the same input pin (index + 1), 0 - last
+	leiodcschedid_t		restoreid;		// Pending pulse restore
+	leiodcrulestats_t	stats;
+};
+
+
+static struct {
+	uint32_t			count;			// Number of rules, 0 - rules are not running
+	__u32				inmask[handle_count];	// Edge detection lines of each handle
+	uint64_t			levels;			// RULE_PIN_BIT() of input lines at high level
+	uint8_t				first[lepin_count];		// First rule of the input pin (index + 1)
+	struct rule_s		rules[LEIODC_RULE_MAX];
+} glrules;
+
+
+
+
+/*
+ * Monotonic time (ns)
+ * [18/10/2026]
+ */
+static inline uint64_t _rules_now(void) {
+	nanotime_t		now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec;
+}
+
+
+/*
+ * Update statistics of the fired rule
+ * [18/10/2026]
+ */
+static void _rules_stats(struct rule_s *rule, uint64_t latns) {
+	leiodcrulestats_t	*stats = &rule->stats;
+
+
+	stats->fired++;
+	stats->latlast = latns;
+	stats->latsum += latns;
+	if (!stats->latmin || (latns < stats->latmin))
+		stats->latmin = latns;
+	if (latns > stats->latmax)
+		stats->latmax = latns;
+}
+
+
+/*
+ * Input pin edge, fire matching rules
+ * [18/10/2026]
+ */
+static void _rules_edge(struct handle_s *lrhandle, leiodcpin_e lepin, const struct gpio_v2_line_event *event, void *arg) {
+	struct {
+		__u32			pinmask;
+		__u32			valmask;
+		uint64_t		donens;			// Time output was applied, 0 - failed
+	} out[handle_count];
+	struct rule_s		*rule;
+	uint8_t				fired[LEIODC_RULE_MAX];
+	uint8_t				edge, nfired = 0;
+	uint32_t			ri;
+	nanotime_t			when;
+	uint64_t			expiry;
+	int					h, i;
+
+
+	if (event->id == GPIO_V2_LINE_EVENT_RISING_EDGE) {
+		glrules.levels |= RULE_PIN_BIT(lepin);
+		edge = LEIODC_RULE_RISING;
+	}
+	else {
+		glrules.levels &= ~RULE_PIN_BIT(lepin);
+		edge = LEIODC_RULE_FALLING;
+	}
+
+	memset(out, 0, sizeof(out));
+	for (ri = glrules.first[lepin]; ri; ri = rule->next) {
+		rule = &glrules.rules[ri - 1];
+		if (!(rule->def.edge & edge))
+			continue;
+
+		if (rule->def.guardpin &&
+				(!(glrules.levels & RULE_PIN_BIT(rule->def.guardpin)) != !rule->def.guardstate)) {
+			rule->stats.blocked++;
+			continue;
+		}
+
+		h = rule->outhandle - glrhandles;
+		out[h].pinmask |= rule->outbit;
+		if (rule->def.outstate)
+			out[h].valmask |= rule->outbit;
+		else
+			out[h].valmask &= ~rule->outbit;
+		fired[nfired++] = ri - 1;
+	}
+
+	for (h = 0; h < handle_count; h++) {
+		if (out[h].pinmask && !_cdev_lines_out_set(&glrhandles[h], out[h].pinmask, out[h].valmask))
+			out[h].donens = _rules_now();
+	}
+
+	for (i = 0; i < nfired; i++) {
+		rule = &glrules.rules[fired[i]];
+		h = rule->outhandle - glrhandles;
+		if (!out[h].donens) {
+			rule->stats.errors++;
+			continue;
+		}
+		_rules_stats(rule, out[h].donens - event->timestamp_ns);
+
+		if (rule->def.pulsems) {
+			/*
+			 * Pulse is retriggered by the next edge
+			 */
+			if (rule->restoreid)
+				leiodc_sched_cancel(rule->restoreid);
+			expiry = out[h].donens + ((uint64_t) rule->def.pulsems * MSECINNSEC);
+			when.tv_sec = expiry / SECINNSEC;
+			when.tv_nsec = expiry % SECINNSEC;
+			if (leiodc_sched_set(rule->def.outpin, !rule->def.outstate, &when, &rule->restoreid)) {
+				rule->restoreid = 0;
+				rule->stats.errors++;
+			}
+		}
+	}
+}
+
+
+/*
+ * Check pin belongs to initialized GPIO line handle
+ * [18/10/2026]
+ */
+static struct handle_s *_rules_handle(leiodcpin lepin) {
+	struct handle_s		*lrhandle;
+
+
+	if (!(lrhandle = _cdev_pin_handle_find(lepin, 1)))
+		return NULL;
+
+	if (!lrhandle->fd) {
+		if (leiodc_pin_init(&lepin, 1))
+			return NULL;
+	}
+	return lrhandle;
+}
+
+
+/*
+ * Compile rules to the rule table
+ * [18/10/2026]
+ */
+static int _rules_compile(const leiodcrule_t *rules, uint32_t count) {
+	struct handle_s		*lrhandle;
+	struct rule_s		*rule;
+	uint32_t			i;
+	int					h;
+
+
+	for (i = 0; i < count; i++) {
+		rule = &glrules.rules[i];
+		rule->def = rules[i];
+
+		if (!rule->def.edge || (rule->def.edge & ~LEIODC_RULE_BOTH)) {
+			ERROR_LOGGER("Rule %u edge 0x%x is not valid", i, rule->def.edge)
+			return RETVAL_NEGATIVE;
+		}
+
+		if (!(lrhandle = _rules_handle(rule->def.inpin)))
+			return RETVAL_NEGATIVE;
+		glrules.inmask[lrhandle - glrhandles] |= HANDLE_PIN_BIT(lrhandle, rule->def.inpin);
+
+		if (rule->def.guardpin) {
+			if (!(lrhandle = _rules_handle(rule->def.guardpin)))
+				return RETVAL_NEGATIVE;
+			glrules.inmask[lrhandle - glrhandles] |= HANDLE_PIN_BIT(lrhandle, rule->def.guardpin);
+		}
+
+		if (!(rule->outhandle = _rules_handle(rule->def.outpin)))
+			return RETVAL_NEGATIVE;
+		rule->outbit = HANDLE_PIN_BIT(rule->outhandle, rule->def.outpin);
+
+		rule->next = glrules.first[rule->def.inpin];
+		glrules.first[rule->def.inpin] = i + 1;
+	}
+
+	/*
+	 * Output pins can't be edge detection lines
+	 */
+	for (i = 0; i < count; i++) {
+		rule = &glrules.rules[i];
+		h = rule->outhandle - glrhandles;
+		if ((glrules.inmask[h] | rule->outhandle->edgemask) & rule->outbit) {
+			ERROR_LOGGER("Rule %u output lepin (%u) is used for edge detection", i, rule->def.outpin)
+			return RETVAL_NEGATIVE;
+		}
+	}
+	return RETVAL_OK;
+}
+
+
+/*
+ * Start reflex rules, edge detection is enabled on the input and guard pins
+ * Return -1 on error
+ * [18/10/2026]
+ * Only added handles are released on failure
+ * [18/10/2026]
+ */
+int leiodc_rules_start(const leiodcrule_t *rules, uint32_t count) {
+	struct gpio_v2_line_values	linevals;
+	leiodcpin_e					lepin;
+	int							h;
+
+
+	if (!rules || !count || (count > LEIODC_RULE_MAX)) {
+		ERROR_LOGGER("Number of rules %u must be between 1...%u", count, LEIODC_RULE_MAX)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("Reflex rules require GPIO line access (mode=%u)", libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	if (glrules.count) {
+		ERROR_LOGGER("Reflex rules are already running")
+		_evt_unlock();
+		return RETVAL_NEGATIVE;
+	}
+
+	memset(&glrules, 0, sizeof(glrules));
+	if (_rules_compile(rules, count))
+		goto failed;
+
+	glrules.count = count;
+	for (h = 0; h < handle_count; h++) {
+		if (!glrules.inmask[h])
+			continue;
+
+		if (_evt_edge_add(&glrhandles[h], glrules.inmask[h], _rules_edge, NULL)) {
+			glrules.inmask[h] = 0;
+			goto release;
+		}
+
+		/*
+		 * Initial levels of the guard pins,
+		 * later tracked by the edges
+		 */
+		memset(&linevals, 0, sizeof(linevals));
+		linevals.mask = glrules.inmask[h];
+		if (_cdev_line_get_ioctl(&glrhandles[h], &linevals))
+			goto release;
+
+		for (lepin = glrhandles[h].minp; lepin <= glrhandles[h].maxp; lepin++) {
+			if (linevals.bits & HANDLE_PIN_BIT(&glrhandles[h], lepin))
+				glrules.levels |= RULE_PIN_BIT(lepin);
+		}
+	}
+	_evt_unlock();
+	return RETVAL_OK;
+
+
+	release:
+	while (++h < handle_count)
+		glrules.inmask[h] = 0;		// Edge detection not added, may be used by others
+	_evt_unlock();
+	leiodc_rules_stop();
+	return RETVAL_NEGATIVE;
+
+	failed:
+	memset(&glrules, 0, sizeof(glrules));
+	_evt_unlock();
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_rules_start)
+
+
+/*
+ * Stop reflex rules, pending pulses are completed
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_rules_stop(void) {
+	int		h, retstat = RETVAL_OK;
+
+
+	_evt_lock();
+	for (h = 0; h < handle_count; h++) {
+		if (glrules.inmask[h]) {
+			if (_evt_edge_del(&glrhandles[h], glrules.inmask[h]))
+				retstat = RETVAL_NEGATIVE;
+		}
+	}
+	memset(&glrules, 0, sizeof(glrules));
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_rules_stop)
+
+
+/*
+ * Get statistics of the rule
+ * ruleno - index of the rule passed to leiodc_rules_start()
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_rules_stats_get(uint32_t ruleno, leiodcrulestats_t *stats) {
+	int		retstat = RETVAL_OK;
+
+
+	_evt_lock();
+	if (ruleno < glrules.count)
+		*stats = glrules.rules[ruleno].stats;
+	else {
+		ERROR_LOGGER("Rule %u is not running (%u rules)", ruleno, glrules.count)
+		retstat = RETVAL_NEGATIVE;
+	}
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_rules_stats_get)
@@ -0,0 +1,318 @@
+/*
+ ============================================================================
+ Name        : libleiodcsafe.c
+ Author      : AK
+ Version     : V1.00
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC emergency safe-state. Safe pin states registered by
+               the application are compiled to GPIO_V2_LINE_SET_CONFIG_IOCTL
+               payloads in advance, the trigger only issues these ioctls
+               and is async-signal-safe. Trigger can be installed as
+               SIGTERM/SIGSEGV/SIGPWR handler.
+
+  Change log :
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+
+#include "libleiodcint.h"
+
+
+/*
+ * Safe-state lines of GPIO line handle
+ */
+struct safehandle_s {
+	fddef						fd;				// Handle line request, 0 - no safe-state lines
+	__u32						pinmask;		// Safe-state lines
+	__u32						valmask;		// Safe-state values
+	uint32_t					active;			// linecfg[] used by the trigger
+	struct gpio_v2_line_config	linecfg[2];		// Rebuilt in the inactive copy when edge lines change
+};
+
+
+static struct {
+	uint32_t			armed;			// Safe-state is registered
+	uint32_t			flags;			// LEIODC_SAFE_* flags of the registration
+	struct safehandle_s	handles[handle_count];
+	struct sigaction	oldact[3];		// Dispositions replaced by the trigger handler
+} glsafe;
+
+
+/*
+ * Signals the trigger can be installed for
+ */
+static const struct {
+	int			signo;
+	uint32_t	flag;
+} SafesigTable[] = {
+	{SIGTERM, LEIODC_SAFE_SIGTERM},
+	{SIGSEGV, LEIODC_SAFE_SIGSEGV},
+	{SIGPWR, LEIODC_SAFE_SIGPWR},
+};
+
+
+/*
+ * RS485/RS422 transmitter enable pins of all UARTs
+ */
+static const leiodcpin SafetxenTable[] = {
+	lepin_COM1_RS422_TX1, lepin_COM1_RS422_TX2,
+	lepin_COM2_RS422_TX1, lepin_COM2_RS422_TX2,
+	lepin_COM3_RS422_TX1, lepin_COM3_RS422_TX2,
+};
+
+
+
+
+/*
+ * Build SET_CONFIG payload, edge detection
+ * remains enabled on the watched lines
+ * [18/10/2026]
+ */
+static void _safe_config_build(struct gpio_v2_line_config *linecfg, const struct safehandle_s *sh, __u32 edgemask) {
+
+	memset(linecfg, 0, sizeof(*linecfg));
+	linecfg->attrs[0].mask = sh->pinmask;
+	linecfg->attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+	linecfg->attrs[0].attr.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+	linecfg->attrs[1].mask = sh->pinmask;
+	linecfg->attrs[1].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+	linecfg->attrs[1].attr.values = sh->valmask;
+	linecfg->num_attrs = 2;
+
+	if ((edgemask &= ~sh->pinmask)) {
+		linecfg->attrs[2].mask = edgemask;
+		linecfg->attrs[2].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+		linecfg->attrs[2].attr.flags = GPIO_CDEV_EDGE_FLAGS;
+		linecfg->num_attrs++;
+	}
+}
+
+
+/*
+ * Edge detection lines of the handle changed, rebuild payload
+ * [18/10/2026]
+ */
+void _safe_handle_update(struct handle_s *lrhandle) {
+	struct safehandle_s	*sh = &glsafe.handles[lrhandle - glrhandles];
+	uint32_t			inactive;
+
+
+	_evt_lock();
+	if (sh->fd) {
+		inactive = __atomic_load_n(&sh->active, __ATOMIC_RELAXED) ^ 1;
+		_safe_config_build(&sh->linecfg[inactive], sh, lrhandle->edgemask);
+		__atomic_store_n(&sh->active, inactive, __ATOMIC_RELEASE);
+	}
+	_evt_unlock();
+}
+
+
+/*
+ * Add safe state of the pin, GPIO line handle is initialized if required
+ * [18/10/2026]
+ */
+static int _safe_pin_add(struct safehandle_s *handles, leiodcpin lepin, uint8_t state) {
+	struct handle_s		*lrhandle;
+	struct safehandle_s	*sh;
+	__u32				pbit;
+
+
+	if (!(lrhandle = _cdev_pin_handle_find(lepin, 1)))
+		return RETVAL_NEGATIVE;
+
+	if (!lrhandle->fd) {
+		if (leiodc_pin_init(&lepin, 1))
+			return RETVAL_NEGATIVE;
+	}
+
+	pbit = HANDLE_PIN_BIT(lrhandle, lepin);
+	if (pbit & lrhandle->edgemask) {
+		ERROR_LOGGER("Safe-state lepin (%u) of GPIO line handle '%s' is used for edge detection", lepin, lrhandle->name)
+		return RETVAL_NEGATIVE;
+	}
+
+	sh = &handles[lrhandle - glrhandles];
+	sh->fd = lrhandle->fd;
+	sh->pinmask |= pbit;
+	if (state)
+		sh->valmask |= pbit;
+	else
+		sh->valmask &= ~pbit;
+	return RETVAL_OK;
+}
+
+
+/*
+ * Restore signal dispositions replaced by the trigger handler
+ * [18/10/2026]
+ */
+static void _safe_signals_restore(void) {
+	int		i;
+
+
+	for (i = 0; i < ARRAY_SIZE(SafesigTable); i++) {
+		if (glsafe.flags & SafesigTable[i].flag)
+			sigaction(SafesigTable[i].signo, &glsafe.oldact[i], NULL);
+	}
+	glsafe.flags &= ~(LEIODC_SAFE_SIGTERM | LEIODC_SAFE_SIGSEGV | LEIODC_SAFE_SIGPWR);
+}
+
+
+/*
+ * Signal handler, safe-state is applied once and previous disposition
+ * of the signal is restored, signal is raised again except SIGSEGV
+ * which is raised by the faulting instruction
+ * [18/10/2026]
+ */
+static void _safe_signal(int signo) {
+	int		i, saverrno = errno;
+
+
+	leiodc_safe_trigger();
+	for (i = 0; i < ARRAY_SIZE(SafesigTable); i++) {
+		if (SafesigTable[i].signo == signo) {
+			sigaction(signo, &glsafe.oldact[i], NULL);
+			break;
+		}
+	}
+
+	if (signo != SIGSEGV)
+		raise(signo);		// Delivered when handler returns
+	errno = saverrno;
+}
+
+
+/*
+ * Register emergency safe-state, replaces previous registration
+ * safetable - pin states applied by the trigger, can be NULL
+ * flags - LEIODC_SAFE_TXOFF adds all RS485/RS422 transmitters disabled,
+ * LEIODC_SAFE_SIG* install trigger as signal handler
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_safe_register(const leiodcsafepin_t *safetable, uint32_t count, uint32_t flags) {
+	struct safehandle_s	handles[handle_count];
+	struct sigaction	sigact;
+	int					i, h, retstat = RETVAL_NEGATIVE;
+
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("Safe-state requires GPIO line access (mode=%u)", libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+	memset(handles, 0, sizeof(handles));
+	if (flags & LEIODC_SAFE_TXOFF) {
+		for (i = 0; i < ARRAY_SIZE(SafetxenTable); i++) {
+			if (_safe_pin_add(handles, SafetxenTable[i], 0))
+				return RETVAL_NEGATIVE;
+		}
+	}
+
+	for (i = 0; safetable && (i < count); i++) {
+		if (_safe_pin_add(handles, safetable[i].lepin, safetable[i].state))
+			return RETVAL_NEGATIVE;
+	}
+
+
+	_evt_lock();
+	leiodc_safe_release();
+
+	for (h = 0; h < handle_count; h++) {
+		if (!handles[h].fd)
+			continue;
+		_safe_config_build(&handles[h].linecfg[0], &handles[h], glrhandles[h].edgemask);
+		handles[h].linecfg[1] = handles[h].linecfg[0];
+	}
+	memcpy(glsafe.handles, handles, sizeof(glsafe.handles));
+	__atomic_store_n(&glsafe.armed, 1, __ATOMIC_RELEASE);
+
+	memset(&sigact, 0, sizeof(sigact));
+	sigact.sa_handler = _safe_signal;
+	sigact.sa_flags = SA_ONSTACK;
+	sigfillset(&sigact.sa_mask);
+	for (i = 0; i < ARRAY_SIZE(SafesigTable); i++) {
+		if (!(flags & SafesigTable[i].flag))
+			continue;
+
+		if (sigaction(SafesigTable[i].signo, &sigact, &glsafe.oldact[i])) {
+			ERROR_STD_LOGGER("sigaction(%d)", SafesigTable[i].signo)
+			_safe_signals_restore();
+			goto failed;
+		}
+		glsafe.flags |= SafesigTable[i].flag;
+	}
+	glsafe.flags |= flags & LEIODC_SAFE_TXOFF;
+	retstat = RETVAL_OK;
+
+
+	failed:
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_safe_register)
+
+
+/*
+ * Apply registered safe-state, one ioctl per GPIO line handle,
+ * async-signal-safe: nothing is logged, allocated or locked
+ * and errno is preserved. Pin state mirror is not updated.
+ * Return -1 if safe-state is not registered or any ioctl failed
+ * [18/10/2026]
+ */
+int leiodc_safe_trigger(void) {
+	const struct safehandle_s	*sh;
+	int							h, saverrno = errno, retstat = RETVAL_OK;
+
+
+	if (!__atomic_load_n(&glsafe.armed, __ATOMIC_ACQUIRE))
+		return RETVAL_NEGATIVE;
+
+	for (h = 0; h < handle_count; h++) {
+		sh = &glsafe.handles[h];
+		if (!sh->fd)
+			continue;
+
+		if (ioctl(sh->fd, GPIO_V2_LINE_SET_CONFIG_IOCTL,
+				&sh->linecfg[__atomic_load_n(&sh->active, __ATOMIC_ACQUIRE)]))
+			retstat = RETVAL_NEGATIVE;
+	}
+
+	_uart_cache_reset();
+	errno = saverrno;
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_safe_trigger)
+
+
+/*
+ * Release safe-state registration and restore signal dispositions
+ * [18/10/2026]
+ */
+void leiodc_safe_release(void) {
+
+	_evt_lock();
+	__atomic_store_n(&glsafe.armed, 0, __ATOMIC_RELEASE);
+	_safe_signals_restore();
+	glsafe.flags = 0;
+	memset(glsafe.handles, 0, sizeof(glsafe.handles));
+	_evt_unlock();
+}
+EXPORT_SYMBOL(leiodc_safe_release)
@@ -0,0 +1,361 @@
+/*
+ ============================================================================
+ Name        : libleiodcsampler.c
+ Author      : AK
+ Version     : V1.02
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC fixed rate input sampler. Sampler thread reads input
+               lines with one GPIO_V2_LINE_GET_VALUES_IOCTL per handle per
+               tick and writes timestamped pin bitmaps to a ring with
+               single producer and any number of consumers. Consumers copy
+               blocks of samples without locks, samples overwritten during
+               the copy are detected and discarded.
+
+  Change log :
+
+  *********V1.02 18/10/2026**************
+  Board version line handle is shared with leiodc_board_ver_get()
+
+  *********V1.01 18/10/2026**************
+  Line reads are recorded by the kernel call flight recorder
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+
+#include "libleiodcint.h"
+
+
+#define SAMPLER_RATE_DEFAULT	1000		// Sampling rate (Hz)
+#define SAMPLER_RATE_MAX		100000
+#define SAMPLER_RING_DEFAULT	4096		// Samples in the ring
+#define SAMPLER_RING_MAX		(1 << 24)
+#define SAMPLER_M2_PIN_MASK		(LEIODC_SAMPLE_PIN(lepin_M2_cfg0) * 0x0F)
+
+/* Oldest sample which can be read, sample at the head index is being written */
+#define SAMPLER_OLDEST(mhead, msize)	(((mhead) >= (msize)) ? ((mhead) - (msize) + 1) : 0)
+
+
+static struct {
+	leiodcsample_t		*ring;			// NULL - sampler is stopped
+	uint64_t			mask;			// Ring size - 1
+	uint64_t			head;			// Samples written
+	uint32_t			stop;
+	uint64_t			periodns;
+	pthread_t			thread;
+	leiodcsamplerstats_t stats;
+} glsampler;
+
+
+
+
+/*
+ * Monotonic time (ns)
+ * [18/10/2026]
+ */
+static inline uint64_t _sampler_now(void) {
+	nanotime_t		now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec;
+}
+
+
+/*
+ * Read input lines of the handle
+ * pinmask - LEIODC_SAMPLE_PIN() of the pins to read
+ * [18/10/2026]
+ */
+static void _sampler_handle(struct handle_s *lrhandle, uint64_t pinmask, leiodcsample_t *sample) {
+	struct gpio_v2_line_values	linevals;
+	leiodcpin_e					lepin;
+	int							retstat;
+	KTRACE_TIMESPEC(ktts)
+
+
+	memset(&linevals, 0, sizeof(linevals));
+	for (lepin = lrhandle->minp; lepin <= lrhandle->maxp; lepin++) {
+		if (pinmask & LEIODC_SAMPLE_PIN(lepin))
+			linevals.mask |= HANDLE_PIN_BIT(lrhandle, lepin);
+	}
+
+	if (!linevals.mask || !lrhandle->fd)
+		return;
+
+	KTRACE_BEGIN(ktts)
+	STATS_KCALL_HANDLE(lrhandle)
+	retstat = ioctl(lrhandle->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &linevals);
+	KTRACE_HANDLE(leiodckt_get_values, ktts, lrhandle, (retstat) ? -errno : 0, linevals.mask, linevals.bits, 0, 0, NULL)
+	if (retstat) {
+		if (!glsampler.stats.errors++) {
+			ERROR_STD_LOGGER("GPIO ioctl(%s, %s)",
+					lrhandle->name, STRINGIFY_(GPIO_V2_LINE_GET_VALUES_IOCTL))
+		}
+		return;
+	}
+
+	for (lepin = lrhandle->minp; lepin <= lrhandle->maxp; lepin++) {
+		if (!(linevals.mask & HANDLE_PIN_BIT(lrhandle, lepin)))
+			continue;
+
+		sample->mask |= LEIODC_SAMPLE_PIN(lepin);
+		if (linevals.bits & HANDLE_PIN_BIT(lrhandle, lepin))
+			sample->values |= LEIODC_SAMPLE_PIN(lepin);
+	}
+}
+
+
+/*
+ * Sample all input lines
+ * [18/10/2026]
+ */
+static void _sampler_tick(uint64_t deadline) {
+	leiodcsample_t		*sample = &glsampler.ring[glsampler.head & glsampler.mask];
+	uint64_t			inmask = SAMPLER_M2_PIN_MASK;
+	leiodcpin_e			lepin;
+	int					h;
+
+
+	/*
+	 * Lines switched to input by this process,
+	 * M.2 CONFIG lines are always inputs
+	 */
+	for (lepin = 1; lepin < lepin_count; lepin++) {
+		if (_state_pin_dir_get(lepin) == lepindir_in)
+			inmask |= LEIODC_SAMPLE_PIN(lepin);
+	}
+
+	sample->timestamp = deadline;
+	sample->values = 0;
+	sample->mask = 0;
+	for (h = 0; h < handle_count; h++)
+		_sampler_handle(&glrhandles[h], inmask, sample);
+	_sampler_handle(&glbvhandle, ~0ULL, sample);
+	sample->latency = _sampler_now() - deadline;
+
+	__atomic_store_n(&glsampler.head, glsampler.head + 1, __ATOMIC_RELEASE);
+	glsampler.stats.ticks++;
+}
+
+
+/*
+ * Sampler thread, ticks missed by overrun are skipped
+ * [18/10/2026]
+ */
+static void *_sampler_thread(void *arg) {
+	nanotime_t		wakeup;
+	sigset_t		sigset;
+	uint64_t		deadline, nowns, missed;
+
+
+	/*
+	 * Signals are handled by application threads
+	 */
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+	deadline = _sampler_now();
+	while (!__atomic_load_n(&glsampler.stop, __ATOMIC_ACQUIRE)) {
+		wakeup.tv_sec = deadline / SECINNSEC;
+		wakeup.tv_nsec = deadline % SECINNSEC;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR);
+
+		_sampler_tick(deadline);
+
+		deadline += glsampler.periodns;
+		if ((nowns = _sampler_now()) >= deadline) {
+			missed = ((nowns - deadline) / glsampler.periodns) + 1;
+			glsampler.stats.missed += missed;
+			deadline += missed * glsampler.periodns;
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Start input sampler
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sampler_start(const leiodcsamplercfg_t *samplercfg) {
+	struct sched_param	sparam;
+	pthread_attr_t		attr;
+	uint32_t			ratehz = SAMPLER_RATE_DEFAULT, ringsize = SAMPLER_RING_DEFAULT;
+	uint64_t			size = 1;
+	int					retstat;
+
+
+	if (glsampler.ring) {
+		ERROR_LOGGER("Input sampler is already running")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (samplercfg) {
+		if (samplercfg->ratehz)
+			ratehz = samplercfg->ratehz;
+		if (samplercfg->ringsize)
+			ringsize = samplercfg->ringsize;
+	}
+
+	if ((ratehz > SAMPLER_RATE_MAX) || (ringsize > SAMPLER_RING_MAX)) {
+		ERROR_LOGGER("Sampling rate %u Hz or ring size %u is too high, maximum %u Hz/%u",
+				ratehz, ringsize, SAMPLER_RATE_MAX, SAMPLER_RING_MAX)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (leiodc_m2_init())
+		return RETVAL_NEGATIVE;
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("Input sampler requires GPIO line access (mode=%u)", libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+	memset(&glsampler, 0, sizeof(glsampler));
+	if (_boardver_handle_get())
+		return RETVAL_NEGATIVE;
+
+	glsampler.periodns = SECINNSEC / ratehz;
+	while (size < ringsize)
+		size <<= 1;
+	glsampler.mask = size - 1;
+
+	/*
+	 * Ring is touched here, no page faults on the sampler thread
+	 */
+	if (!(glsampler.ring = malloc(size * sizeof(leiodcsample_t)))) {
+		ERROR_STD_LOGGER("malloc(%llu samples)", (unsigned long long) size)
+		goto failed;
+	}
+	memset(glsampler.ring, 0, size * sizeof(leiodcsample_t));
+
+	pthread_attr_init(&attr);
+	if (samplercfg && samplercfg->priority) {
+		memset(&sparam, 0, sizeof(sparam));
+		sparam.sched_priority = samplercfg->priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &sparam);
+	}
+
+	retstat = pthread_create(&glsampler.thread, &attr, _sampler_thread, NULL);
+	pthread_attr_destroy(&attr);
+	if (retstat) {
+		ERROR_LOGGER("pthread_create(): %s", strerror(retstat))
+		goto failed;
+	}
+	return RETVAL_OK;
+
+
+	failed:
+	free(glsampler.ring);
+	glsampler.ring = NULL;
+	_boardver_handle_put();
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_sampler_start)
+
+
+/*
+ * Stop input sampler, consumers must not read anymore
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sampler_stop(void) {
+
+	if (!glsampler.ring)
+		return RETVAL_OK;
+
+	__atomic_store_n(&glsampler.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(glsampler.thread, NULL);
+
+	_boardver_handle_put();
+	free(glsampler.ring);
+	glsampler.ring = NULL;
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_sampler_stop)
+
+
+/*
+ * Copy samples following the cursor, any number of consumers
+ * can read concurrently, each with its own cursor
+ * cursor - index of the next sample to read, 0 - start from the oldest
+ * lost - incremented by the number of samples overwritten
+ * before they were read, can be NULL
+ * Return number of samples copied or -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sampler_read(uint64_t *cursor, leiodcsample_t *samples, uint32_t count, uint64_t *lost) {
+	const leiodcsample_t	*ring = glsampler.ring;
+	uint64_t				head, oldest, size, first;
+	uint32_t				n, chunk, overwritten = 0;
+
+
+	if (!ring) {
+		ERROR_LOGGER("Input sampler is not running")
+		return RETVAL_NEGATIVE;
+	}
+
+	size = glsampler.mask + 1;
+	head = __atomic_load_n(&glsampler.head, __ATOMIC_ACQUIRE);
+	if (*cursor < (oldest = SAMPLER_OLDEST(head, size))) {
+		if (lost)
+			*lost += oldest - *cursor;
+		*cursor = oldest;
+	}
+
+	if ((n = ((head - *cursor) < count) ? (head - *cursor) : count) == 0)
+		return 0;
+
+	first = *cursor & glsampler.mask;
+	chunk = ((size - first) < n) ? (size - first) : n;
+	memcpy(samples, &ring[first], chunk * sizeof(*samples));
+	if (chunk < n)
+		memcpy(&samples[chunk], ring, (n - chunk) * sizeof(*samples));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	/*
+	 * Producer may have overwritten the beginning of the copied block
+	 */
+	head = __atomic_load_n(&glsampler.head, __ATOMIC_RELAXED);
+	if (*cursor < (oldest = SAMPLER_OLDEST(head, size))) {
+		overwritten = ((oldest - *cursor) < n) ? (oldest - *cursor) : n;
+		memmove(samples, &samples[overwritten], (n - overwritten) * sizeof(*samples));
+		if (lost)
+			*lost += overwritten;
+	}
+
+	*cursor += n;
+	return n - overwritten;
+}
+EXPORT_SYMBOL(leiodc_sampler_read)
+
+
+/*
+ * Get input sampler statistics, kept after sampler is stopped
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sampler_stats_get(leiodcsamplerstats_t *stats) {
+
+	memcpy(stats, &glsampler.stats, sizeof(*stats));
+	stats->samples = __atomic_load_n(&glsampler.head, __ATOMIC_RELAXED);
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_sampler_stats_get)
@@ -0,0 +1,491 @@
+/*
+ ============================================================================
+ Name        : libleiodcsched.c
+ Author      : AK
+ Version     : V1.00
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC deadline scheduler of pin actions. Pending actions
+               are kept in a hierarchical timer wheel (4 levels of 64 slots,
+               1 ms ticks) serviced by the event thread with one timerfd
+               armed for the next occupied slot. Pin changes due in the same
+               tick are merged into one call per GPIO line handle.
+               Actions come from a fixed pool, cancel is O(1).
+
+  Change log :
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "libleiodcint.h"
+
+
+#define SCHED_LEVEL_BITS		6
+#define SCHED_LEVEL_SLOTS		(1 << SCHED_LEVEL_BITS)
+#define SCHED_LEVEL_MASK		(SCHED_LEVEL_SLOTS - 1)
+#define SCHED_LEVELS			4
+#define SCHED_RANGE				((uint64_t) 1 << (SCHED_LEVEL_BITS * SCHED_LEVELS))	// Ticks covered by the wheel
+#define SCHED_NONE				UINT64_MAX
+#define SCHED_INDEX_BITS		16			// Identifier: generation << 16 | pool index + 1
+
+
+/*
+ * Pending action
+ */
+struct schedent_s {
+	struct schedent_s	*next;
+	struct schedent_s	**pprev;		// NULL - entry is free
+	uint64_t			expiry;			// Tick
+	uint32_t			widthticks;		// Pulse width, 0 - single change
+	uint16_t			generation;
+	uint8_t				level;
+	uint8_t				slot;
+	leiodcpin			lepin;
+	uint8_t				state;
+};
+
+
+static struct {
+	fddef				timerfd;
+	uint64_t			tick;			// Last processed tick
+	uint64_t			armed;			// Tick the timer is armed for
+	uint64_t			occupied[SCHED_LEVELS];		// Non-empty slots
+	struct schedent_s	*slots[SCHED_LEVELS][SCHED_LEVEL_SLOTS];
+	struct schedent_s	*freelist;
+	struct schedent_s	pool[LEIODC_SCHED_MAX];
+	leiodcschedstats_t	stats;
+} glsched;
+
+
+
+
+/*
+ * Current tick
+ * [18/10/2026]
+ */
+static uint64_t _sched_now(void) {
+	nanotime_t		now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec) / LEIODC_SCHED_TICK_NS;
+}
+
+
+/*
+ * Place entry in the wheel relative to the current tick,
+ * entry must not expire before the current tick
+ * [18/10/2026]
+ */
+static void _sched_insert(struct schedent_s *ent) {
+	struct schedent_s	**head;
+	uint64_t			expiry = ent->expiry;
+	int					level;
+
+
+	/*
+	 * Entries beyond the wheel range are cascaded from the last slot again
+	 */
+	if ((expiry - glsched.tick) >= SCHED_RANGE)
+		expiry = glsched.tick + SCHED_RANGE - 1;
+
+	for (level = 0; level < (SCHED_LEVELS - 1); level++) {
+		if (((expiry >> (SCHED_LEVEL_BITS * level)) - (glsched.tick >> (SCHED_LEVEL_BITS * level))) < SCHED_LEVEL_SLOTS)
+			break;
+	}
+
+	ent->level = level;
+	ent->slot = (expiry >> (SCHED_LEVEL_BITS * level)) & SCHED_LEVEL_MASK;
+	head = &glsched.slots[level][ent->slot];
+	ent->next = *head;
+	if (ent->next)
+		ent->next->pprev = &ent->next;
+	ent->pprev = head;
+	*head = ent;
+	glsched.occupied[level] |= (uint64_t) 1 << ent->slot;
+}
+
+
+/*
+ * Remove entry from the wheel
+ * [18/10/2026]
+ */
+static void _sched_unlink(struct schedent_s *ent) {
+
+	*ent->pprev = ent->next;
+	if (ent->next)
+		ent->next->pprev = ent->pprev;
+	if (!glsched.slots[ent->level][ent->slot])
+		glsched.occupied[ent->level] &= ~((uint64_t) 1 << ent->slot);
+	ent->next = NULL;
+	ent->pprev = NULL;
+}
+
+
+/*
+ * Return entry to the pool, identifier becomes invalid
+ * [18/10/2026]
+ */
+static void _sched_free(struct schedent_s *ent) {
+
+	ent->generation++;
+	ent->next = glsched.freelist;
+	glsched.freelist = ent;
+	glsched.stats.pending--;
+}
+
+
+/*
+ * Find the next tick to be processed: first occupied slot of level 0
+ * or start of the first occupied slot of a higher level (cascade)
+ * [18/10/2026]
+ */
+static uint64_t _sched_next(void) {
+	uint64_t	next = SCHED_NONE, rotated, tick;
+	uint32_t	shift, start;
+	int			level;
+
+
+	for (level = 0; level < SCHED_LEVELS; level++) {
+		if (!glsched.occupied[level])
+			continue;
+
+		shift = SCHED_LEVEL_BITS * level;
+		start = ((glsched.tick >> shift) + 1) & SCHED_LEVEL_MASK;
+		rotated = (glsched.occupied[level] >> start) | ((start) ? (glsched.occupied[level] << (SCHED_LEVEL_SLOTS - start)) : 0);
+		tick = ((glsched.tick >> shift) + 1 + __builtin_ctzll(rotated)) << shift;
+		if (tick < next)
+			next = tick;
+	}
+	return next;
+}
+
+
+/*
+ * Apply merged pin changes of the handle
+ * [18/10/2026]
+ */
+static void _sched_apply(struct handle_s *lrhandle, __u32 pinmask, __u32 valmask) {
+	leiodcpin_e		lepin;
+	__u32			pbit;
+	int				retstat = RETVAL_OK;
+
+
+	glsched.stats.calls++;
+	if (libmode == mode_cdev) {
+		retstat = _cdev_lines_out_set(lrhandle, pinmask, valmask);
+	}
+	else {
+		/*
+		 * Broker merges changes of a batch in one request
+		 */
+		if (libmode == mode_broker)
+			leiodc_batch_begin();
+		for (lepin = lrhandle->minp; lepin <= lrhandle->maxp; lepin++) {
+			pbit = HANDLE_PIN_BIT(lrhandle, lepin);
+			if ((pinmask & pbit) && leiodc_pin_state_set(lepin, BOOL_CHECK(valmask & pbit)))
+				retstat = RETVAL_NEGATIVE;
+		}
+		if ((libmode == mode_broker) && leiodc_batch_end())
+			retstat = RETVAL_NEGATIVE;
+	}
+
+	if (retstat)
+		glsched.stats.errors++;
+}
+
+
+/*
+ * Process tick, higher levels are cascaded first
+ * [18/10/2026]
+ */
+static void _sched_tick(uint64_t tick) {
+	struct schedent_s	*ent, *next;
+	struct handle_s		*lrhandle;
+	__u32				pinmask[handle_count] = {0};
+	__u32				valmask[handle_count] = {0};
+	__u32				pbit;
+	uint32_t			shift;
+	int					level, slot, i;
+
+
+	glsched.tick = tick;
+	for (level = SCHED_LEVELS - 1; level > 0; level--) {
+		shift = SCHED_LEVEL_BITS * level;
+		if (tick & (((uint64_t) 1 << shift) - 1))
+			continue;
+
+		slot = (tick >> shift) & SCHED_LEVEL_MASK;
+		ent = glsched.slots[level][slot];
+		glsched.slots[level][slot] = NULL;
+		glsched.occupied[level] &= ~((uint64_t) 1 << slot);
+		for (; ent; ent = next) {
+			next = ent->next;
+			_sched_insert(ent);
+		}
+	}
+
+	slot = tick & SCHED_LEVEL_MASK;
+	ent = glsched.slots[0][slot];
+	glsched.slots[0][slot] = NULL;
+	glsched.occupied[0] &= ~((uint64_t) 1 << slot);
+	for (; ent; ent = next) {
+		next = ent->next;
+		lrhandle = _cdev_pin_handle_find(ent->lepin, 0);
+		i = lrhandle - glrhandles;
+		pbit = HANDLE_PIN_BIT(lrhandle, ent->lepin);
+		pinmask[i] |= pbit;
+		valmask[i] = (valmask[i] & ~pbit) | ((ent->state) ? pbit : 0);
+		glsched.stats.executed++;
+
+		if (ent->widthticks) {
+			/*
+			 * Pulse, pin is restored after the width
+			 */
+			ent->expiry = tick + ent->widthticks;
+			ent->widthticks = 0;
+			ent->state = !ent->state;
+			_sched_insert(ent);
+		}
+		else {
+			ent->pprev = NULL;
+			_sched_free(ent);
+		}
+	}
+
+	for (i = 0; i < handle_count; i++) {
+		if (pinmask[i])
+			_sched_apply(&glrhandles[i], pinmask[i], valmask[i]);
+	}
+}
+
+
+/*
+ * Arm the timer for the next occupied tick
+ * [18/10/2026]
+ */
+static void _sched_arm(void) {
+	struct itimerspec	tspec;
+	uint64_t			next = _sched_next();
+
+
+	if (next == glsched.armed)
+		return;
+
+	memset(&tspec, 0, sizeof(tspec));
+	if (next != SCHED_NONE) {
+		tspec.it_value.tv_sec = (next * LEIODC_SCHED_TICK_NS) / SECINNSEC;
+		tspec.it_value.tv_nsec = (next * LEIODC_SCHED_TICK_NS) % SECINNSEC;
+	}
+	if (timerfd_settime(glsched.timerfd, TFD_TIMER_ABSTIME, &tspec, NULL)) {
+		ERROR_STD_LOGGER("timerfd_settime(scheduler)")
+		return;
+	}
+	glsched.armed = next;
+}
+
+
+/*
+ * Scheduler timer expired, process all due ticks
+ * [18/10/2026]
+ */
+static void _sched_timer(fddef fd, uint32_t events, void *arg) {
+	nanotime_t		now;
+	uint64_t		expirations, nowtick, next, late;
+
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	nowtick = (((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec) / LEIODC_SCHED_TICK_NS;
+	glsched.armed = SCHED_NONE;
+
+	while (((next = _sched_next()) != SCHED_NONE) && (next <= nowtick)) {
+		late = ((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec - (next * LEIODC_SCHED_TICK_NS);
+		if (late > glsched.stats.latemax)
+			glsched.stats.latemax = late;
+		_sched_tick(next);
+	}
+	glsched.tick = nowtick;
+	_sched_arm();
+}
+
+
+/*
+ * Initialize the scheduler on first use
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _sched_init(void) {
+	int		i;
+
+
+	if (glsched.timerfd)
+		return RETVAL_OK;
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if ((glsched.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("timerfd_create()")
+		glsched.timerfd = 0;
+		return RETVAL_NEGATIVE;
+	}
+
+	if (_evt_fd_add(glsched.timerfd, _sched_timer, NULL)) {
+		close(glsched.timerfd);
+		glsched.timerfd = 0;
+		return RETVAL_NEGATIVE;
+	}
+
+	for (i = LEIODC_SCHED_MAX - 1; i >= 0; i--) {
+		glsched.pool[i].next = glsched.freelist;
+		glsched.freelist = &glsched.pool[i];
+	}
+	glsched.tick = _sched_now();
+	glsched.armed = SCHED_NONE;
+	return RETVAL_OK;
+}
+
+
+/*
+ * Schedule pin action at the tick
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _sched_add(leiodcpin lepin, uint8_t state, uint64_t expiry, uint32_t widthticks, leiodcschedid_t *idptr) {
+	struct schedent_s	*ent;
+	int					retstat = RETVAL_NEGATIVE;
+
+
+	if (!_cdev_pin_handle_find(lepin, 1))
+		return RETVAL_NEGATIVE;
+
+	_evt_lock();
+	if (_sched_init())
+		goto failed;
+
+	if (!(ent = glsched.freelist)) {
+		ERROR_LOGGER("Too many pending pin actions, maximum %u", LEIODC_SCHED_MAX)
+		goto failed;
+	}
+	glsched.freelist = ent->next;
+	glsched.stats.pending++;
+	glsched.stats.scheduled++;
+
+	if (glsched.stats.pending == 1)
+		glsched.tick = _sched_now() - 1;		// Wheel was idle, resync
+	if (expiry <= glsched.tick)
+		expiry = glsched.tick + 1;				// Already due
+
+	ent->expiry = expiry;
+	ent->widthticks = widthticks;
+	ent->lepin = lepin;
+	ent->state = BOOL_CHECK(state);
+	_sched_insert(ent);
+	_sched_arm();
+
+	if (idptr)
+		*idptr = ((leiodcschedid_t) ent->generation << SCHED_INDEX_BITS) | ((ent - glsched.pool) + 1);
+	retstat = RETVAL_OK;
+
+
+	failed:
+	_evt_unlock();
+	return retstat;
+}
+
+
+/*
+ * Set pin state at CLOCK_MONOTONIC time
+ * when - NULL to set at the next tick
+ * idptr - identifier for cancellation, can be NULL
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sched_set(LIBARGDEF_PINS, const nanotime_t *when, leiodcschedid_t *idptr) {
+	uint64_t	expiry = 0;
+
+
+	if (when)
+		expiry = (((uint64_t) when->tv_sec * SECINNSEC) + when->tv_nsec + LEIODC_SCHED_TICK_NS - 1) / LEIODC_SCHED_TICK_NS;
+	return _sched_add(lepin, state, expiry, 0, idptr);
+}
+EXPORT_SYMBOL(leiodc_sched_set)
+
+
+/*
+ * Set pin state after delay and restore the opposite state after width
+ * idptr - identifier for cancellation, can be NULL
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sched_pulse(LIBARGDEF_PINS, uint32_t delayms, uint32_t widthms, leiodcschedid_t *idptr) {
+	uint32_t	widthticks = ((uint64_t) widthms * 1000000) / LEIODC_SCHED_TICK_NS;
+
+
+	if (!widthticks) {
+		ERROR_LOGGER("Pulse width %u ms is too short", widthms)
+		return RETVAL_NEGATIVE;
+	}
+	return _sched_add(lepin, state, _sched_now() + (((uint64_t) delayms * 1000000) / LEIODC_SCHED_TICK_NS),
+			widthticks, idptr);
+}
+EXPORT_SYMBOL(leiodc_sched_pulse)
+
+
+/*
+ * Cancel pending action, pulse is cancelled including the restore
+ * Return -1 if action is not pending anymore
+ * [18/10/2026]
+ */
+int leiodc_sched_cancel(leiodcschedid_t id) {
+	struct schedent_s	*ent;
+	uint32_t			index = (id & ((1 << SCHED_INDEX_BITS) - 1));
+	int					retstat = RETVAL_NEGATIVE;
+
+
+	if (!index || (index > LEIODC_SCHED_MAX))
+		return RETVAL_NEGATIVE;
+
+	_evt_lock();
+	ent = &glsched.pool[index - 1];
+	if (ent->pprev && (ent->generation == (id >> SCHED_INDEX_BITS))) {
+		_sched_unlink(ent);
+		_sched_free(ent);
+		glsched.stats.cancelled++;
+		retstat = RETVAL_OK;
+	}
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_sched_cancel)
+
+
+/*
+ * Get scheduler statistics
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sched_stats_get(leiodcschedstats_t *stats) {
+
+	_evt_lock();
+	memcpy(stats, &glsched.stats, sizeof(*stats));
+	_evt_unlock();
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_sched_stats_get)
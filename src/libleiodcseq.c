@@ -0,0 +1,244 @@
+/*
+ ============================================================================
+ Name        : libleiodcseq.c
+ Author      : AK
+ Version     : V1.02
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC timed output sequence player. Steps of a sequence
+               are compiled to GPIO_V2_LINE_SET_VALUES_IOCTL payloads in
+               advance, the player applies each step with a single ioctl
+               at an absolute deadline reached by clock_nanosleep()
+               followed by a short busy-wait.
+
+  Change log :
+
+  *********V1.02 18/10/2026**************
+  Cached UART interface modes are invalidated if the sequence drives UART control lines
+
+  *********V1.01 18/10/2026**************
+  Steps are recorded by the kernel call flight recorder
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+
+#include "libleiodcint.h"
+
+
+/*
+ * Compiled step
+ */
+struct seqstep_s {
+	struct gpio_v2_line_values	linevals;
+	uint64_t					delayns;
+};
+
+
+/*
+ * Compiled sequence
+ */
+struct leiodcseq_s {
+	struct handle_s		*lrhandle;
+	uint32_t			count;
+	uint32_t			spinns;
+	struct seqstep_s	steps[];
+};
+
+
+
+
+/*
+ * Monotonic time (ns)
+ * [18/10/2026]
+ */
+static inline uint64_t _seq_now(void) {
+	nanotime_t		now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec;
+}
+
+
+/*
+ * Wait until deadline, sleep until spin time before it, then busy-wait
+ * [18/10/2026]
+ */
+static void _seq_wait(uint64_t deadline, uint32_t spinns) {
+	nanotime_t		wakeup;
+	uint64_t		nowns = _seq_now();
+
+
+	if ((nowns + spinns) < deadline) {
+		wakeup.tv_sec = (deadline - spinns) / SECINNSEC;
+		wakeup.tv_nsec = (deadline - spinns) % SECINNSEC;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR);
+	}
+
+	while (_seq_now() < deadline);
+}
+
+
+/*
+ * Compile output sequence, all pins must belong to one GPIO line handle
+ * and must be configured as outputs
+ * spinns - busy-wait before each step (ns), 0 - default
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_seq_compile(const leiodcseqstep_t *steps, uint32_t count, uint32_t spinns, leiodcseq_t **seqptr) {
+	struct handle_s		*lrhandle = NULL;
+	leiodcseq_t			*seq;
+	leiodcpin_e			lepin;
+	uint32_t			i;
+	__u32				pbit;
+
+
+	*seqptr = NULL;
+	if (!steps || !count) {
+		ERROR_LOGGER("Output sequence has no steps")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("Output sequence requires GPIO line access (mode=%u)", libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!(seq = calloc(1, sizeof(*seq) + (count * sizeof(seq->steps[0]))))) {
+		ERROR_STD_LOGGER("calloc(%u steps)", count)
+		return RETVAL_NEGATIVE;
+	}
+	seq->count = count;
+	seq->spinns = (spinns) ? spinns : LEIODC_SEQ_SPIN_DEFAULT;
+
+	for (i = 0; i < count; i++) {
+		if (!steps[i].mask || (steps[i].mask >> lepin_count)) {
+			ERROR_LOGGER("Output sequence step %u pin mask 0x%llx is not valid", i, (unsigned long long) steps[i].mask)
+			goto failed;
+		}
+
+		for (lepin = 0; lepin < lepin_count; lepin++) {
+			if (!(steps[i].mask & LEIODC_SEQ_PIN(lepin)))
+				continue;
+
+			if (!lrhandle) {
+				if (!(lrhandle = _cdev_pin_handle_find(lepin, 1)))
+					goto failed;
+				if (!lrhandle->fd) {
+					ERROR_LOGGER("GPIO line handle '%s' is not initialized", lrhandle->name)
+					goto failed;
+				}
+			}
+
+			if ((lepin < lrhandle->minp) || (lepin > lrhandle->maxp)) {
+				ERROR_LOGGER("Output sequence step %u lepin (%u) doesn't belong to GPIO line handle '%s'",
+						i, lepin, lrhandle->name)
+				goto failed;
+			}
+
+			if (_state_pin_dir_get(lepin) != lepindir_out) {
+				ERROR_LOGGER("Output sequence step %u lepin (%u) is not configured as output", i, lepin)
+				goto failed;
+			}
+
+			pbit = HANDLE_PIN_BIT(lrhandle, lepin);
+			seq->steps[i].linevals.mask |= pbit;
+			if (steps[i].values & LEIODC_SEQ_PIN(lepin))
+				seq->steps[i].linevals.bits |= pbit;
+		}
+
+		seq->steps[i].delayns = steps[i].delayns;
+	}
+
+	seq->lrhandle = lrhandle;
+	*seqptr = seq;
+	return RETVAL_OK;
+
+
+	failed:
+	free(seq);
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_seq_compile)
+
+
+/*
+ * Play output sequence, function returns after the delay of the last step
+ * errorns - achieved minus planned time of each step (ns), can be NULL
+ * Return -1 on error, sequence is aborted at the failed step
+ * [18/10/2026]
+ */
+int leiodc_seq_play(const leiodcseq_t *seq, int64_t *errorns) {
+	struct handle_s		*lrhandle = seq->lrhandle;
+	uint64_t			deadline, nowns;
+	__u32				donemask = 0, donevals = 0;
+	uint32_t			i;
+	int					retstat = RETVAL_OK;
+	KTRACE_TIMESPEC(ktts)
+
+
+	deadline = _seq_now();
+	for (i = 0; i < seq->count; i++) {
+		_seq_wait(deadline, seq->spinns);
+
+		KTRACE_BEGIN(ktts)
+		STATS_KCALL_HANDLE(lrhandle)
+		retstat = ioctl(lrhandle->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &seq->steps[i].linevals);
+		KTRACE_HANDLE(leiodckt_set_values, ktts, lrhandle, (retstat) ? -errno : 0,
+				seq->steps[i].linevals.mask, seq->steps[i].linevals.bits, 0, 0, NULL)
+		if (retstat) {
+			ERROR_STD_LOGGER("Output sequence step %u ioctl(%s, %s, mask=0x%llx)", i, lrhandle->name,
+					STRINGIFY_(GPIO_V2_LINE_SET_VALUES_IOCTL), (unsigned long long) seq->steps[i].linevals.mask)
+			retstat = RETVAL_NEGATIVE;
+			break;
+		}
+		nowns = _seq_now();
+
+		if (errorns)
+			errorns[i] = (int64_t) (nowns - deadline);
+		donemask |= seq->steps[i].linevals.mask;
+		donevals = (donevals & ~seq->steps[i].linevals.mask) | seq->steps[i].linevals.bits;
+		deadline += seq->steps[i].delayns;
+	}
+
+	if (!retstat)
+		_seq_wait(deadline, seq->spinns);
+
+	/*
+	 * State mirror and UART cache are updated once, it would delay the steps
+	 */
+	if (donemask) {
+		_cdev_lines_uart_invalidate(lrhandle, donemask);
+		_state_lines_update(lrhandle, donemask, donevals, lepindir_unknown);
+	}
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_seq_play)
+
+
+/*
+ * Free compiled output sequence
+ * [18/10/2026]
+ */
+void leiodc_seq_free(leiodcseq_t *seq) {
+
+	free(seq);
+}
+EXPORT_SYMBOL(leiodc_seq_free)
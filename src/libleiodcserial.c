@@ -0,0 +1,780 @@
+/*
+ ============================================================================
+ Name        : libleiodcserial.c
+ Author      : AK
+ Version     : V1.09
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC serial port setup. The tty is configured for
+               low latency in one call: interface mode GPIOs, raw termios,
+               ASYNC_LOW_LATENCY and RS485 RTS delays derived from baud rate.
+               RS485 direction can be controlled from userspace on kernels
+               without the TX enable pad patch. It can be tested on a pty
+               with gpio-sim chips selected by LEIODC_GPIO_CHIP.
+
+  Change log :
+
+  *********V1.09 18/10/2026**************
+  Missing serial port settings are reported instead of dereferenced
+
+  *********V1.08 18/10/2026**************
+  Disabled direction control releases TX enable line, synchronized with
+  the serial I/O engine by the event thread lock, TX enable changes are
+  passed to the pin state mirror, transmitter empty wait is limited
+
+  *********V1.07 18/10/2026**************
+  TX enable line changes are recorded by the kernel call flight recorder
+
+  *********V1.06 18/10/2026**************
+  Configured port is added to the serial line health monitor
+
+  *********V1.05 18/10/2026**************
+  GPIO access is required only if interface mode is set,
+  pseudo-terminal check for RS485 setup on ptys
+
+  *********V1.04 18/10/2026**************
+  Character time is available to the serial I/O engine
+
+  *********V1.03 18/10/2026**************
+  TX enable and transmitter empty helpers for the serial I/O engine
+
+  *********V1.02 18/10/2026**************
+  RS485 userspace direction control
+
+  *********V1.01 18/10/2026**************
+  RS485 9-bit addressing mode
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <fcntl.h>			// File controls
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <linux/major.h>	// Pseudo-terminal majors
+#include <linux/serial.h>	// serial port UAPI
+
+#include "libleiodcint.h"
+
+
+#define RS485_DRAIN_CHARS		4			// Character times transmitter may stay busy after the last one
+
+
+static const struct {
+	uint32_t		baud;
+	speed_t			speed;
+} BaudTable[] = {
+	{300,		B300},
+	{600,		B600},
+	{1200,		B1200},
+	{2400,		B2400},
+	{4800,		B4800},
+	{9600,		B9600},
+	{19200,		B19200},
+	{38400,		B38400},
+	{57600,		B57600},
+	{115200,	B115200},
+	{230400,	B230400},
+	{460800,	B460800},
+	{500000,	B500000},
+	{576000,	B576000},
+	{921600,	B921600},
+	{1000000,	B1000000},
+	{1152000,	B1152000},
+	{1500000,	B1500000},
+	{2000000,	B2000000},
+	{2500000,	B2500000},
+	{3000000,	B3000000},
+};
+
+
+
+/*
+ * RS485 userspace direction control of the UART
+ */
+static struct rs485sw_s {
+	fddef			fd;				// tty, 0 - disabled
+	uint8_t			lsr;			// TIOCSERGETLSR is supported
+	uint64_t		charns;			// Character time (ns)
+	struct gpio_v2_line_values txon;	// Pre-resolved TX enable line values
+	struct gpio_v2_line_values txoff;
+	leiodcrs485stats_t stats;
+} glrs485sw[LEIODC_UART_COUNT];
+
+
+
+
+/*
+ * Nanoseconds between two time stamps
+ * [18/10/2026]
+ */
+static uint64_t _serial_elapsed(const nanotime_t *start, const nanotime_t *end) {
+
+	return (((uint64_t) (end->tv_sec - start->tv_sec)) * SECINNSEC) + end->tv_nsec - start->tv_nsec;
+}
+
+
+/*
+ * Set raw termios of the tty
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _serial_termios_set(fddef fd, const leiodcserialcfg_t *sercfg) {
+	struct termios	tios;
+	speed_t			speed = B0;
+	int				i;
+
+
+	for (i = 0; i < ARRAY_SIZE(BaudTable); i++) {
+		if (BaudTable[i].baud == sercfg->baud) {
+			speed = BaudTable[i].speed;
+			break;
+		}
+	}
+	if (speed == B0) {
+		ERROR_LOGGER("Baud rate %u is not supported", sercfg->baud)
+		return RETVAL_NEGATIVE;
+	}
+
+	STATS_KCALL(lestatk_tty)
+	if (tcgetattr(fd, &tios)) {
+		ERROR_STD_LOGGER("tcgetattr(%d)", fd)
+		return RETVAL_NEGATIVE;
+	}
+
+	cfmakeraw(&tios);
+	tios.c_cflag &= ~(CSIZE | CSTOPB | PARENB | PARODD | CRTSCTS);
+	tios.c_cflag |= CLOCAL | CREAD;
+
+	switch (sercfg->databits) {
+	case 5:
+		tios.c_cflag |= CS5;
+		break;
+	case 6:
+		tios.c_cflag |= CS6;
+		break;
+	case 7:
+		tios.c_cflag |= CS7;
+		break;
+	case 0:
+	case 8:
+		tios.c_cflag |= CS8;
+		break;
+	default:
+		ERROR_LOGGER("Number of data bits %u is not valid", sercfg->databits)
+		return RETVAL_NEGATIVE;
+	}
+
+	switch (sercfg->parity) {
+	case 0:
+	case 'N':
+	case 'n':
+		break;
+	case 'E':
+	case 'e':
+		tios.c_cflag |= PARENB;
+		break;
+	case 'O':
+	case 'o':
+		tios.c_cflag |= PARENB | PARODD;
+		break;
+	default:
+		ERROR_LOGGER("Parity '%c' is not valid", sercfg->parity)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (sercfg->stopbits == 2)
+		tios.c_cflag |= CSTOPB;
+
+	tios.c_cc[VMIN] = 1;		// Return as soon as one byte is received
+	tios.c_cc[VTIME] = 0;
+	cfsetispeed(&tios, speed);
+	cfsetospeed(&tios, speed);
+
+	STATS_KCALL(lestatk_tty)
+	if (tcsetattr(fd, TCSANOW, &tios)) {
+		ERROR_STD_LOGGER("tcsetattr(%d, baud=%u)", fd, sercfg->baud)
+		return RETVAL_NEGATIVE;
+	}
+	return RETVAL_OK;
+}
+
+
+/*
+ * Request low latency receive processing
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _serial_low_latency_set(fddef fd) {
+	struct serial_struct	serinfo;
+
+
+	memset(&serinfo, 0, sizeof(serinfo));
+	STATS_KCALL(lestatk_tty)
+	if (ioctl(fd, TIOCGSERIAL, &serinfo)) {
+		if (errno == ENOTTY)
+			return RETVAL_OK;		// Not a serial driver (e.g. pty), nothing to tune
+		ERROR_STD_LOGGER("UART ioctl(%d, %s)", fd, STRINGIFY_(TIOCGSERIAL))
+		return RETVAL_NEGATIVE;
+	}
+
+	if (serinfo.flags & ASYNC_LOW_LATENCY)
+		return RETVAL_OK;
+
+	serinfo.flags |= ASYNC_LOW_LATENCY;
+	STATS_KCALL(lestatk_tty)
+	if (ioctl(fd, TIOCSSERIAL, &serinfo)) {
+		ERROR_STD_LOGGER("UART ioctl(%d, %s, ASYNC_LOW_LATENCY)", fd, STRINGIFY_(TIOCSSERIAL))
+		return RETVAL_NEGATIVE;
+	}
+	return RETVAL_OK;
+}
+
+
+/*
+ * Check if tty is a pseudo-terminal slave
+ * [18/10/2026]
+ */
+int _serial_is_pty(fddef fd) {
+	struct stat		fdstat;
+
+
+	if (fstat(fd, &fdstat) || !S_ISCHR(fdstat.st_mode))
+		return 0;
+	return ((major(fdstat.st_rdev) >= UNIX98_PTY_SLAVE_MAJOR) &&
+			(major(fdstat.st_rdev) < (UNIX98_PTY_SLAVE_MAJOR + UNIX98_PTY_MAJOR_COUNT)));
+}
+
+
+/*
+ * RS485 RTS delay (ms)
+ * Driver releases RTS when transmitter is empty, only a single bit time
+ * is added after send to cover the stop bit at slow baud rates.
+ * Nothing is needed before send, transceiver enable time is in microseconds.
+ * [18/10/2026]
+ */
+static __u32 _serial_rs485_delay(uint32_t baud, uint16_t cfgms, int after) {
+
+	if (cfgms != LEIODC_SERIAL_DELAY_AUTO)
+		return cfgms;
+	if (!after)
+		return 0;
+	return 1000 / baud;		// Zero at 1200 baud and above
+}
+
+
+/*
+ * Configure opened tty of the UART for low latency
+ * Return -1 on error
+ * [18/10/2026]
+ * Settings checked
+ * [18/10/2026]
+ */
+int leiodc_serial_config(uint8_t uartno, fddef fd, const leiodcserialcfg_t *sercfg) {
+	struct serial_rs485	rs485opt;
+	uint8_t				inttable[LEIODC_UART_COUNT] = {0};
+	int					retstat = RETVAL_NEGATIVE;
+	PROBE_TIMESPEC(probets)
+	STATS_API(lestat_serial_config)
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!sercfg) {
+		ERROR_LOGGER("COM%u serial port settings are not specified", uartno + 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	PROBE_TIME_BEGIN(serial_config, probets)
+	if (sercfg->interface) {
+		if (!libmode) {
+			if (_lib_mode())
+				goto failed;
+		}
+
+		if (sercfg->interface > leuart_RS422rev) {
+			ERROR_LOGGER("COM%u interface mode %u is not valid", uartno + 1, sercfg->interface)
+			goto failed;
+		}
+
+		inttable[uartno] = sercfg->interface;
+		if (_uart_gpio_set(inttable))
+			goto failed;
+	}
+
+	if (_serial_termios_set(fd, sercfg))
+		goto failed;
+
+	if (_serial_low_latency_set(fd))
+		goto failed;
+	_health_port_set(uartno, fd);
+
+	if (sercfg->interface) {
+		memset(&rs485opt, 0, sizeof(rs485opt));
+		rs485opt.delay_rts_before_send = _serial_rs485_delay(sercfg->baud, sercfg->rtsbeforems, 0);
+		rs485opt.delay_rts_after_send = _serial_rs485_delay(sercfg->baud, sercfg->rtsafterms, 1);
+		if (sercfg->addrflags & LEIODC_RS485_ADDR_RECV) {
+			rs485opt.flags |= SER_RS485_ADDRB | SER_RS485_ADDR_RECV;
+			rs485opt.addr_recv = sercfg->addrrecv;
+		}
+		if (sercfg->addrflags & LEIODC_RS485_ADDR_DEST) {
+			rs485opt.flags |= SER_RS485_ADDRB | SER_RS485_ADDR_DEST;
+			rs485opt.addr_dest = sercfg->addrdest;
+		}
+
+		if (_uart_rs485_set(uartno, sercfg->interface, &fd, &rs485opt))
+			goto failed;
+	}
+	retstat = RETVAL_OK;
+
+
+	failed:
+	PROBE(serial_config, fd, uartno, sercfg->baud, retstat, PROBE_ELAPSED(serial_config, probets))
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_serial_config)
+
+
+/*
+ * Open tty of the UART and configure it for low latency
+ * ttypath - NULL to open LEIODC_SERIAL_TTY
+ * Return tty file descriptor or -1 on error
+ * [18/10/2026]
+ */
+int leiodc_serial_open(uint8_t uartno, const lechar *ttypath, const leiodcserialcfg_t *sercfg) {
+	lechar		defpath[GPIO_PATH_LENGTH];
+	fddef		fd;
+
+
+	if (!ttypath) {
+		snprintf(defpath, sizeof(defpath), LEIODC_SERIAL_TTY, uartno);
+		ttypath = defpath;
+	}
+
+	STATS_KCALL(lestatk_tty)
+	if ((fd = open(ttypath, O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("open(%s)", ttypath)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (leiodc_serial_config(uartno, fd, sercfg)) {
+		close(fd);
+		return RETVAL_NEGATIVE;
+	}
+	return fd;
+}
+EXPORT_SYMBOL(leiodc_serial_open)
+
+
+/*
+ * Character time of the tty (ns)
+ * Return 0 on error
+ * [18/10/2026]
+ */
+uint64_t _serial_char_time(fddef fd) {
+	struct termios	tios;
+	speed_t			speed;
+	uint32_t		bits = 2;		// Start and stop bits
+	int				i;
+
+
+	STATS_KCALL(lestatk_tty)
+	if (tcgetattr(fd, &tios)) {
+		ERROR_STD_LOGGER("tcgetattr(%d)", fd)
+		return 0;
+	}
+
+	speed = cfgetospeed(&tios);
+	for (i = 0; i < ARRAY_SIZE(BaudTable); i++) {
+		if (BaudTable[i].speed == speed)
+			break;
+	}
+	if (i == ARRAY_SIZE(BaudTable)) {
+		ERROR_LOGGER("Baud rate of tty %d is not supported", fd)
+		return 0;
+	}
+
+	switch (tios.c_cflag & CSIZE) {
+	case CS5:
+		bits += 5;
+		break;
+	case CS6:
+		bits += 6;
+		break;
+	case CS7:
+		bits += 7;
+		break;
+	default:
+		bits += 8;
+		break;
+	}
+	if (tios.c_cflag & PARENB)
+		bits++;
+	if (tios.c_cflag & CSTOPB)
+		bits++;
+
+	return ((uint64_t) bits * SECINNSEC) / BaudTable[i].baud;
+}
+
+
+/*
+ * Enable RS485 userspace direction control,
+ * TX enable line of the interface is driven by leiodc_rs485_sw_write()
+ * Termios of the tty must be set before enabling
+ * Return -1 on error
+ * [18/10/2026]
+ * Event thread lock
+ * [18/10/2026]
+ */
+int leiodc_rs485_sw_enable(uint8_t uartno, uint8_t interface, fddef fd) {
+	struct rs485sw_s	*sw;
+	struct handle_s		*handle = &glrhandles[handle_uart];
+	leiodcpin_e			lepin;
+	__u32				pbit;
+	int					retstat = RETVAL_NEGATIVE;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	if ((lepin = _uart_txen_pin_get(uartno, interface)) == lepin_count) {
+		ERROR_LOGGER("COM%u interface mode %u is not RS485", uartno + 1, interface)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!libmode) {
+		if (_lib_mode())
+			return RETVAL_NEGATIVE;
+	}
+
+	if (libmode != mode_cdev) {
+		ERROR_LOGGER("RS485 userspace direction control requires cdev GPIO access (mode=%u)", libmode)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!handle->fd) {
+		const leiodcpin pintable[] = {lepin};
+
+		if (leiodc_pin_init(pintable, ARRAY_SIZE(pintable)))
+			return RETVAL_NEGATIVE;
+	}
+
+	/*
+	 * Settings are read by the serial I/O engine on the event thread
+	 */
+	_evt_lock();
+	sw = &glrs485sw[uartno];
+	memset(sw, 0, sizeof(*sw));
+	if (!(sw->charns = _serial_char_time(fd)))
+		goto failed;
+
+	/*
+	 * Transmitter is disabled until the first frame
+	 */
+	pbit = HANDLE_PIN_BIT(handle, lepin);
+	if (_cdev_lines_out_set(handle, pbit, 0))
+		goto failed;
+
+	sw->txon.mask = pbit;
+	sw->txon.bits = pbit;
+	sw->txoff.mask = pbit;
+	sw->txoff.bits = 0;
+	sw->lsr = 1;
+	sw->fd = fd;
+	retstat = RETVAL_OK;
+
+
+	failed:
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_rs485_sw_enable)
+
+
+/*
+ * Disable RS485 userspace direction control, TX enable line is released.
+ * Must not be called while leiodc_rs485_sw_write() of the UART is running.
+ * Return -1 on error
+ * [18/10/2026]
+ * TX enable released, event thread lock
+ * [18/10/2026]
+ */
+int leiodc_rs485_sw_disable(uint8_t uartno) {
+	int		retstat = RETVAL_OK;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	if (glrs485sw[uartno].fd) {
+		retstat = _rs485_sw_txen_set(uartno, 0);
+		glrs485sw[uartno].fd = 0;
+	}
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_rs485_sw_disable)
+
+
+/*
+ * Raise or release TX enable line of the UART,
+ * line is released already if direction control is disabled
+ * Return -1 on error
+ * [18/10/2026]
+ * Pin state mirror updated
+ * [18/10/2026]
+ */
+int _rs485_sw_txen_set(uint8_t uartno, int on) {
+	struct handle_s				*handle = &glrhandles[handle_uart];
+	struct gpio_v2_line_values	*linevals = (on) ? &glrs485sw[uartno].txon : &glrs485sw[uartno].txoff;
+	int							retstat;
+	KTRACE_TIMESPEC(ktts)
+
+
+	if (!glrs485sw[uartno].fd) {
+		if (!on)
+			return RETVAL_OK;
+		ERROR_LOGGER("RS485 userspace direction control is not enabled on COM%u", uartno + 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	KTRACE_BEGIN(ktts)
+	STATS_KCALL_HANDLE(handle)
+	retstat = ioctl(handle->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, linevals);
+	KTRACE_HANDLE(leiodckt_set_values, ktts, handle, (retstat) ? -errno : 0, linevals->mask, linevals->bits, 0, 0, NULL)
+	if (retstat) {
+		ERROR_STD_LOGGER("GPIO ioctl(%s, %s, TX %s)", handle->name,
+				STRINGIFY_(GPIO_V2_LINE_SET_VALUES_IOCTL), (on) ? "enable" : "disable")
+		return RETVAL_NEGATIVE;
+	}
+
+	/*
+	 * Values only are set, line is an output since enabling,
+	 * TX enable changes the UART control line pattern
+	 */
+	_cdev_lines_uart_invalidate(handle, linevals->mask);
+	_state_lines_update(handle, linevals->mask, linevals->bits, lepindir_out);
+	return RETVAL_OK;
+}
+
+
+/*
+ * Character time of the UART with userspace direction control (ns)
+ * Return 0 if direction control is not enabled
+ * [18/10/2026]
+ */
+uint64_t _rs485_sw_charns(uint8_t uartno) {
+
+	if ((uartno >= LEIODC_UART_COUNT) || !glrs485sw[uartno].fd)
+		return 0;
+	return glrs485sw[uartno].charns;
+}
+
+
+/*
+ * Check if transmitter is empty without blocking,
+ * only output queue is checked if line status register can't be read (e.g. pty)
+ * Return 1 if empty, 0 if not, -1 on error
+ * [18/10/2026]
+ */
+int _rs485_sw_empty(uint8_t uartno) {
+	struct rs485sw_s	*sw = &glrs485sw[uartno];
+	int					lsr, outq;
+
+
+	if (!sw->fd)
+		return 1;		// Direction control disabled, nothing to wait for
+
+	if (sw->lsr) {
+		STATS_KCALL(lestatk_tty)
+		if (ioctl(sw->fd, TIOCSERGETLSR, &lsr) == 0)
+			return BOOL_CHECK(lsr & TIOCSER_TEMT);
+
+		if ((errno != ENOTTY) && (errno != EINVAL)) {
+			ERROR_STD_LOGGER("UART ioctl(%d, %s)", sw->fd, STRINGIFY_(TIOCSERGETLSR))
+			return RETVAL_NEGATIVE;
+		}
+		sw->lsr = 0;
+	}
+
+	STATS_KCALL(lestatk_tty)
+	if (ioctl(sw->fd, TIOCOUTQ, &outq)) {
+		ERROR_STD_LOGGER("UART ioctl(%d, %s)", sw->fd, STRINGIFY_(TIOCOUTQ))
+		return RETVAL_NEGATIVE;
+	}
+	return BOOL_CHECK(!outq);
+}
+
+
+/*
+ * Wait until transmitter shift register is empty,
+ * tcdrain() is used if line status register can't be read (e.g. pty)
+ * Return -1 on error or if transmitter doesn't get empty in time (e.g. CTS stall)
+ * [18/10/2026]
+ * Wait limited to a few character times
+ * [18/10/2026]
+ */
+static int _rs485_sw_drain(struct rs485sw_s *sw) {
+	nanotime_t	start, now;
+	int			lsr;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (sw->lsr) {
+		STATS_KCALL(lestatk_tty)
+		if (ioctl(sw->fd, TIOCSERGETLSR, &lsr) == 0) {
+			if (lsr & TIOCSER_TEMT)
+				return RETVAL_OK;
+
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if (_serial_elapsed(&start, &now) > (RS485_DRAIN_CHARS * sw->charns)) {
+				errno = ETIMEDOUT;
+				ERROR_STD_LOGGER("UART transmitter (%d) is not empty after %u character times", sw->fd, RS485_DRAIN_CHARS)
+				return RETVAL_NEGATIVE;
+			}
+			continue;
+		}
+
+		if ((errno != ENOTTY) && (errno != EINVAL)) {
+			ERROR_STD_LOGGER("UART ioctl(%d, %s)", sw->fd, STRINGIFY_(TIOCSERGETLSR))
+			return RETVAL_NEGATIVE;
+		}
+		sw->lsr = 0;
+	}
+
+	STATS_KCALL(lestatk_tty)
+	if (tcdrain(sw->fd)) {
+		ERROR_STD_LOGGER("tcdrain(%d)", sw->fd)
+		return RETVAL_NEGATIVE;
+	}
+	return RETVAL_OK;
+}
+
+
+/*
+ * Write frame with RS485 userspace direction control:
+ * raise TX enable, write, wait for transmitter empty, release TX enable.
+ * Calling thread sleeps until the last character is being shifted out,
+ * only the last character time is spent polling the line status.
+ * Return number of bytes written or -1 on error
+ * [18/10/2026]
+ */
+int leiodc_rs485_sw_write(uint8_t uartno, const void *buf, uint32_t len) {
+	struct rs485sw_s	*sw;
+	struct pollfd		pfd;
+	nanotime_t			start, wend, empty, released;
+	uint64_t			deadline, drainns = 0, turnns = 0;
+	uint32_t			done = 0;
+	ssize_t				wlen;
+	int					retstat = RETVAL_NEGATIVE;
+
+
+	if ((uartno >= LEIODC_UART_COUNT) || !glrs485sw[uartno].fd) {
+		ERROR_LOGGER("RS485 userspace direction control is not enabled on COM%u", uartno + 1)
+		return RETVAL_NEGATIVE;
+	}
+	sw = &glrs485sw[uartno];
+
+	if (_rs485_sw_txen_set(uartno, 1)) {
+		sw->stats.errors++;
+		return RETVAL_NEGATIVE;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (done < len) {
+		STATS_KCALL(lestatk_tty)
+		if ((wlen = write(sw->fd, (const uint8_t *) buf + done, len - done)) >= 0) {
+			done += wlen;
+			continue;
+		}
+
+		if (errno == EINTR)
+			continue;
+		if (errno == EAGAIN) {
+			pfd.fd = sw->fd;
+			pfd.events = POLLOUT;
+			poll(&pfd, 1, -1);
+			continue;
+		}
+		ERROR_STD_LOGGER("write(%d, %u bytes)", sw->fd, len)
+		goto release;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &wend);
+
+	/*
+	 * Sleep while all but the last character are shifted out
+	 */
+	if (len > 1) {
+		deadline = ((uint64_t) start.tv_sec * SECINNSEC) + start.tv_nsec + ((len - 1) * sw->charns);
+		released.tv_sec = deadline / SECINNSEC;
+		released.tv_nsec = deadline % SECINNSEC;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &released, NULL) == EINTR);
+	}
+
+	if (_rs485_sw_drain(sw))
+		goto release;
+	clock_gettime(CLOCK_MONOTONIC, &empty);
+	drainns = _serial_elapsed(&wend, &empty);
+	retstat = len;
+
+
+	release:
+	if (_rs485_sw_txen_set(uartno, 0))
+		retstat = RETVAL_NEGATIVE;
+
+	if (retstat < 0) {
+		sw->stats.errors++;
+	}
+	else {
+		clock_gettime(CLOCK_MONOTONIC, &released);
+		turnns = _serial_elapsed(&empty, &released);
+		sw->stats.frames++;
+		sw->stats.turnlast = turnns;
+		sw->stats.turnsum += turnns;
+		if (turnns > sw->stats.turnmax)
+			sw->stats.turnmax = turnns;
+		if (drainns > sw->stats.drainmax)
+			sw->stats.drainmax = drainns;
+	}
+
+	PROBE(rs485_sw_write, uartno, len, retstat, drainns, turnns)
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_rs485_sw_write)
+
+
+/*
+ * Get RS485 userspace direction control statistics
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_rs485_sw_stats_get(uint8_t uartno, leiodcrs485stats_t *stats) {
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	memcpy(stats, &glrs485sw[uartno].stats, sizeof(*stats));
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_rs485_sw_stats_get)
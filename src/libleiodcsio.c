@@ -0,0 +1,1111 @@
+/*
+ ============================================================================
+ Name        : libleiodcsio.c
+ Author      : AK
+ Version     : V1.04
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC serial I/O engine. COM1...COM3 ttys are serviced
+               by the library event thread, received data is stored in
+               per-port lock-free RX rings, queued data is sent from
+               per-port TX rings with vectored writes.
+               Each ring has a single producer and a single consumer:
+               RX ring is read by one application thread,
+               TX ring is written by one application thread.
+               In framed receive mode bytes are collected until the line
+               is silent for the inter-frame gap, complete frames are
+               passed to a callback or queued in the RX ring.
+               Application calls hold the event thread lock, so the
+               port can't be removed while its rings are accessed.
+
+  Change log :
+
+  *********V1.04 18/10/2026**************
+  Read, write and frame functions hold the event thread lock, port
+  resources were released by leiodc_sio_port_del() while in use,
+  statistics destination checked
+
+  *********V1.03 18/10/2026**************
+  Direction control disabled while the port is serviced is not used
+
+  *********V1.02 18/10/2026**************
+  Traffic capture, data is recorded after it is handed over to the application
+
+  *********V1.01 18/10/2026**************
+  Framed receive mode
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <fcntl.h>			// File controls
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "libleiodcint.h"
+
+
+#define SIO_RING_MAX			(1 << 20)		// Maximal ring size
+#define SIO_DISCARD_SIZE		256				// Read size while RX ring is full
+
+
+/*
+ * Lock-free single producer single consumer ring,
+ * head and tail are free running counters
+ */
+struct sioring_s {
+	uint8_t			*buf;
+	uint32_t		mask;			// Size - 1
+	uint32_t		head;			// Written by the producer
+	uint32_t		tail;			// Written by the consumer
+};
+
+
+/*
+ * Framed receive
+ */
+struct sioframe_s {
+	uint8_t			*buf;
+	uint32_t		size;			// Maximal frame length
+	uint32_t		len;			// Length of the frame being received
+	uint32_t		flags;			// LEIODC_FRAME_xxx
+	nanotime_t		first;
+	nanotime_t		last;
+	uint64_t		gapns;			// Inter-frame gap
+	fddef			timerfd;		// Inter-frame gap timer
+	fddef			notifyfd;		// eventfd, frames queued in the RX ring
+	leiodcframecb_t	callback;
+	void			*arg;
+};
+
+
+/*
+ * Frame header in the RX ring
+ */
+struct sioframehdr_s {
+	uint32_t		len;
+	uint32_t		flags;
+	nanotime_t		first;
+	nanotime_t		last;
+};
+
+
+/*
+ * Serviced port
+ */
+struct sioport_s {
+	fddef			fd;				// tty, 0 - port is not serviced
+	uint8_t			uartno;
+	uint8_t			epollout;		// EPOLLOUT is armed, tty output buffer full
+	uint8_t			txen;			// RS485 transmitter enabled by the engine
+	uint32_t		txkick;			// Engine was notified about queued data
+	fddef			timerfd;		// RS485 transmitter empty timer
+	uint64_t		charns;			// Character time, RS485 userspace direction control only
+	uint64_t		charnsrx;		// Character time, framed receive only
+	struct sioring_s rx;
+	struct sioring_s tx;
+	leiodcsiocb_t	rxcallback;
+	void			*arg;
+	struct sioframe_s *frame;		// Framed receive, NULL - byte stream
+	leiodcsiostats_t stats;
+};
+
+
+static struct {
+	fddef				kickfd;			// eventfd, TX data queued
+	struct sioport_s	ports[LEIODC_UART_COUNT];
+} glsio;
+
+
+
+
+/*
+ * Allocate ring buffer
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _sio_ring_alloc(struct sioring_s *ring, uint32_t size) {
+	uint32_t	rsize = 1;
+
+
+	if (!size)
+		size = LEIODC_SIO_RING_DEFAULT;
+	if (size > SIO_RING_MAX) {
+		ERROR_LOGGER("Ring size %u is too large, maximum %u", size, SIO_RING_MAX)
+		return RETVAL_NEGATIVE;
+	}
+
+	while (rsize < size)
+		rsize <<= 1;
+
+	if (!(ring->buf = malloc(rsize))) {
+		ERROR_STD_LOGGER("malloc(%u)", rsize)
+		return RETVAL_NEGATIVE;
+	}
+	ring->mask = rsize - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	return RETVAL_OK;
+}
+
+
+/*
+ * Prepare I/O vectors of the contiguous ring regions starting at index
+ * Return number of vectors
+ * [18/10/2026]
+ */
+static int _sio_ring_iov(const struct sioring_s *ring, uint32_t index, uint32_t len, struct iovec *iov) {
+	uint32_t	offset = index & ring->mask;
+	uint32_t	first = ring->mask + 1 - offset;
+
+
+	iov[0].iov_base = &ring->buf[offset];
+	if (len <= first) {
+		iov[0].iov_len = len;
+		return 1;
+	}
+	iov[0].iov_len = first;
+	iov[1].iov_base = ring->buf;
+	iov[1].iov_len = len - first;
+	return 2;
+}
+
+
+/*
+ * Copy data to the ring at index
+ * [18/10/2026]
+ */
+static void _sio_ring_put(struct sioring_s *ring, uint32_t index, const void *src, uint32_t len) {
+	struct iovec	iov[2];
+	const uint8_t	*sptr = src;
+	int				i, cnt;
+
+
+	cnt = _sio_ring_iov(ring, index, len, iov);
+	for (i = 0; i < cnt; i++) {
+		memcpy(iov[i].iov_base, sptr, iov[i].iov_len);
+		sptr += iov[i].iov_len;
+	}
+}
+
+
+/*
+ * Copy data from the ring at index
+ * [18/10/2026]
+ */
+static void _sio_ring_get(const struct sioring_s *ring, uint32_t index, void *dst, uint32_t len) {
+	struct iovec	iov[2];
+	uint8_t			*dptr = dst;
+	int				i, cnt;
+
+
+	cnt = _sio_ring_iov(ring, index, len, iov);
+	for (i = 0; i < cnt; i++) {
+		memcpy(dptr, iov[i].iov_base, iov[i].iov_len);
+		dptr += iov[i].iov_len;
+	}
+}
+
+
+/*
+ * Arm RS485 transmitter empty timer
+ * [18/10/2026]
+ */
+static void _sio_timer_arm(struct sioport_s *port, uint64_t ns) {
+	struct itimerspec	tspec;
+
+
+	memset(&tspec, 0, sizeof(tspec));
+	tspec.it_value.tv_sec = ns / SECINNSEC;
+	tspec.it_value.tv_nsec = (ns % SECINNSEC) ? (ns % SECINNSEC) : 1;
+	if (timerfd_settime(port->timerfd, 0, &tspec, NULL)) {
+		ERROR_STD_LOGGER("timerfd_settime(COM%u)", port->uartno + 1)
+	}
+}
+
+
+/*
+ * Send queued data, RS485 transmitter is enabled before the first byte
+ * and released by the timer once all data is shifted out
+ * [18/10/2026]
+ * Disabled direction control
+ * [18/10/2026]
+ */
+static void _sio_tx(struct sioport_s *port) {
+	struct iovec	iov[2];
+	nanotime_t		now;
+	uint32_t		head, tail, len;
+	ssize_t			wlen;
+	int				outq;
+
+
+	for (;;) {
+		tail = port->tx.tail;
+		head = __atomic_load_n(&port->tx.head, __ATOMIC_ACQUIRE);
+		if (!(len = head - tail))
+			break;
+
+		if (port->charns && !port->txen) {
+			if (!_rs485_sw_charns(port->uartno))
+				port->charns = 0;		// Disabled by leiodc_rs485_sw_disable()
+			else if (_rs485_sw_txen_set(port->uartno, 1))
+				return;
+			else
+				port->txen = 1;
+		}
+
+		STATS_KCALL(lestatk_tty)
+		wlen = writev(port->fd, iov, _sio_ring_iov(&port->tx, tail, len, iov));
+		if (wlen < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN) {
+				if (!port->epollout && !_evt_fd_mod(port->fd, EPOLLIN | EPOLLOUT))
+					port->epollout = 1;
+				return;
+			}
+
+			ERROR_STD_LOGGER("writev(COM%u, %u bytes), queued data dropped", port->uartno + 1, len)
+			wlen = len;
+		}
+		else {
+			port->stats.txbytes += wlen;
+			port->stats.writes++;
+			if (_capture_port(port->uartno, LEIODC_CAPTURE_DIR_TX)) {
+				clock_gettime(CLOCK_REALTIME, &now);
+				_capture_put(port->uartno, LEIODC_CAPTURE_DIR_TX, &now,
+						iov, _sio_ring_iov(&port->tx, tail, wlen, iov));
+			}
+		}
+		__atomic_store_n(&port->tx.tail, tail + wlen, __ATOMIC_RELEASE);
+	}
+
+	if (port->epollout) {
+		if (!_evt_fd_mod(port->fd, EPOLLIN))
+			port->epollout = 0;
+	}
+
+	if (port->txen) {
+		/*
+		 * Wait until characters buffered by the driver are sent
+		 */
+		outq = 0;
+		STATS_KCALL(lestatk_tty)
+		ioctl(port->fd, TIOCOUTQ, &outq);
+		_sio_timer_arm(port, (outq + 1) * port->charns);
+	}
+}
+
+
+/*
+ * RS485 transmitter empty timer expired
+ * [18/10/2026]
+ */
+static void _sio_timer(fddef fd, uint32_t events, void *arg) {
+	struct sioport_s	*port = arg;
+	uint64_t			expirations;
+	int					empty;
+
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return;
+
+	if (!port->txen)
+		return;
+
+	if (__atomic_load_n(&port->tx.head, __ATOMIC_ACQUIRE) != port->tx.tail) {
+		_sio_tx(port);		// More data queued, transmitter stays enabled
+		return;
+	}
+
+	if ((empty = _rs485_sw_empty(port->uartno)) == 0) {
+		_sio_timer_arm(port, port->charns);
+		return;
+	}
+
+	_rs485_sw_txen_set(port->uartno, 0);
+	port->txen = 0;
+}
+
+
+/*
+ * tty hung up, stop servicing it,
+ * otherwise epoll keeps reporting the hangup
+ * [18/10/2026]
+ */
+static void _sio_hangup(struct sioport_s *port) {
+
+	_evt_fd_del(port->fd);
+	port->stats.hangup = 1;
+	if (port->rxcallback)
+		port->rxcallback(port->uartno, port->arg);
+}
+
+
+/*
+ * Read received data to the RX ring
+ * [18/10/2026]
+ */
+static void _sio_rx(struct sioport_s *port) {
+	struct iovec	iov[2];
+	uint8_t			discard[SIO_DISCARD_SIZE];
+	nanotime_t		capturets;
+	uint32_t		head, tail, space, start = port->rx.head;
+	ssize_t			rlen;
+	int				received = 0;
+
+
+	for (;;) {
+		head = port->rx.head;
+		tail = __atomic_load_n(&port->rx.tail, __ATOMIC_ACQUIRE);
+		space = port->rx.mask + 1 - (head - tail);
+
+		STATS_KCALL(lestatk_tty)
+		if (!space || port->txen)
+			rlen = read(port->fd, discard, sizeof(discard));
+		else
+			rlen = readv(port->fd, iov, _sio_ring_iov(&port->rx, head, space, iov));
+
+		if (rlen < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN)
+				goto hangup;
+			break;
+		}
+		if (!rlen)
+			goto hangup;
+
+		port->stats.reads++;
+		if (port->txen) {
+			port->stats.rxecho += rlen;		// Own transmission
+			continue;
+		}
+		if (!space) {
+			port->stats.rxoverrun += rlen;
+			continue;
+		}
+
+		if (!received && _capture_port(port->uartno, LEIODC_CAPTURE_DIR_RX))
+			clock_gettime(CLOCK_REALTIME, &capturets);
+
+		__atomic_store_n(&port->rx.head, head + rlen, __ATOMIC_RELEASE);
+		port->stats.rxbytes += rlen;
+		received = 1;
+		if (rlen < space)
+			break;
+	}
+
+	if (received && port->rxcallback)
+		port->rxcallback(port->uartno, port->arg);
+
+	/*
+	 * Data stays in the ring until the next read of this function
+	 */
+	if (received && _capture_port(port->uartno, LEIODC_CAPTURE_DIR_RX))
+		_capture_put(port->uartno, LEIODC_CAPTURE_DIR_RX, &capturets,
+				iov, _sio_ring_iov(&port->rx, start, port->rx.head - start, iov));
+	return;
+
+
+	hangup:
+	_sio_hangup(port);
+}
+
+
+/*
+ * Arm inter-frame gap timer relative to the last read
+ * [18/10/2026]
+ */
+static void _sio_frame_timer_arm(struct sioframe_s *frame) {
+	struct itimerspec	tspec;
+	uint64_t			deadline;
+
+
+	deadline = ((uint64_t) frame->last.tv_sec * SECINNSEC) + frame->last.tv_nsec + frame->gapns;
+	memset(&tspec, 0, sizeof(tspec));
+	tspec.it_value.tv_sec = deadline / SECINNSEC;
+	tspec.it_value.tv_nsec = deadline % SECINNSEC;
+	if (timerfd_settime(frame->timerfd, TFD_TIMER_ABSTIME, &tspec, NULL)) {
+		ERROR_STD_LOGGER("timerfd_settime(frame gap)")
+	}
+}
+
+
+/*
+ * Read received data to the frame buffer, every read is time stamped
+ * Return 1 if data was received
+ * [18/10/2026]
+ */
+static int _sio_frame_rx(struct sioport_s *port) {
+	struct sioframe_s	*frame = port->frame;
+	uint8_t				discard[SIO_DISCARD_SIZE];
+	nanotime_t			now;
+	uint32_t			space;
+	uint64_t			firstns;
+	ssize_t				rlen;
+	int					received = 0;
+
+
+	for (;;) {
+		space = frame->size - frame->len;
+
+		STATS_KCALL(lestatk_tty)
+		if (!space || port->txen)
+			rlen = read(port->fd, discard, sizeof(discard));
+		else
+			rlen = read(port->fd, &frame->buf[frame->len], space);
+
+		if (rlen < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN)
+				goto hangup;
+			break;
+		}
+		if (!rlen)
+			goto hangup;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		port->stats.reads++;
+		if (port->txen) {
+			port->stats.rxecho += rlen;
+			continue;
+		}
+
+		if (!frame->len && !frame->flags) {
+			/*
+			 * First byte was received (rlen - 1) characters before the read
+			 */
+			firstns = ((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec - ((rlen - 1) * port->charnsrx);
+			frame->first.tv_sec = firstns / SECINNSEC;
+			frame->first.tv_nsec = firstns % SECINNSEC;
+		}
+
+		if (space) {
+			frame->len += rlen;
+		}
+		else {
+			frame->flags |= LEIODC_FRAME_TRUNCATED;
+			port->stats.rxoverrun += rlen;
+		}
+		frame->last = now;
+		port->stats.rxbytes += rlen;
+		received = 1;
+	}
+
+	if (received)
+		_sio_frame_timer_arm(frame);
+	return received;
+
+
+	hangup:
+	_sio_hangup(port);
+	return received;
+}
+
+
+/*
+ * Inter-frame gap expired, deliver the frame
+ * [18/10/2026]
+ */
+static void _sio_frame_timer(fddef fd, uint32_t events, void *arg) {
+	static const uint64_t	notify = 1;
+	struct sioport_s		*port = arg;
+	struct sioframe_s		*frame = port->frame;
+	struct sioframehdr_s	hdr;
+	struct iovec			iov;
+	leiodcframe_t			fr;
+	nanotime_t				capturets, now;
+	uint64_t				expirations, firstns;
+	uint32_t				head, tail;
+	int						captured;
+
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return;
+
+	/*
+	 * Data could arrive just before the gap expired
+	 */
+	if (!port->stats.hangup && _sio_frame_rx(port))
+		return;
+
+	if (!frame->len && !frame->flags)
+		return;
+
+	port->stats.frames++;
+	captured = _capture_port(port->uartno, LEIODC_CAPTURE_DIR_RX);
+	if (captured) {
+		/*
+		 * Time of the first byte on the realtime clock
+		 */
+		clock_gettime(CLOCK_REALTIME, &capturets);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		firstns = ((uint64_t) capturets.tv_sec * SECINNSEC) + capturets.tv_nsec -
+				((((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec) -
+				(((uint64_t) frame->first.tv_sec * SECINNSEC) + frame->first.tv_nsec));
+		capturets.tv_sec = firstns / SECINNSEC;
+		capturets.tv_nsec = firstns % SECINNSEC;
+	}
+
+	if (frame->callback) {
+		fr.data = frame->buf;
+		fr.len = frame->len;
+		fr.flags = frame->flags;
+		fr.first = frame->first;
+		fr.last = frame->last;
+		frame->callback(port->uartno, &fr, frame->arg);
+	}
+	else {
+		head = port->rx.head;
+		tail = __atomic_load_n(&port->rx.tail, __ATOMIC_ACQUIRE);
+		if ((sizeof(hdr) + frame->len) > (port->rx.mask + 1 - (head - tail))) {
+			port->stats.framedrop++;
+		}
+		else {
+			hdr.len = frame->len;
+			hdr.flags = frame->flags;
+			hdr.first = frame->first;
+			hdr.last = frame->last;
+			_sio_ring_put(&port->rx, head, &hdr, sizeof(hdr));
+			_sio_ring_put(&port->rx, head + sizeof(hdr), frame->buf, frame->len);
+			__atomic_store_n(&port->rx.head, head + sizeof(hdr) + frame->len, __ATOMIC_RELEASE);
+
+			if (write(frame->notifyfd, &notify, sizeof(notify)) != sizeof(notify)) {
+				ERROR_STD_LOGGER("write(COM%u frame notify)", port->uartno + 1)
+			}
+		}
+	}
+
+	if (captured) {
+		iov.iov_base = frame->buf;
+		iov.iov_len = frame->len;
+		_capture_put(port->uartno, LEIODC_CAPTURE_DIR_RX, &capturets, &iov, 1);
+	}
+
+	frame->len = 0;
+	frame->flags = 0;
+}
+
+
+/*
+ * tty event
+ * [18/10/2026]
+ */
+static void _sio_tty_event(fddef fd, uint32_t events, void *arg) {
+	struct sioport_s	*port = arg;
+
+
+	if (events & EPOLLOUT)
+		_sio_tx(port);
+	if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+		if (port->frame)
+			_sio_frame_rx(port);
+		else
+			_sio_rx(port);
+	}
+}
+
+
+/*
+ * Data queued by the application
+ * [18/10/2026]
+ */
+static void _sio_kick(fddef fd, uint32_t events, void *arg) {
+	struct sioport_s	*port;
+	uint64_t			kicks;
+	int					i;
+
+
+	if (read(fd, &kicks, sizeof(kicks)) != sizeof(kicks))
+		return;
+
+	for (i = 0; i < LEIODC_UART_COUNT; i++) {
+		port = &glsio.ports[i];
+		if (!port->fd || port->stats.hangup)
+			continue;
+
+		if (__atomic_exchange_n(&port->txkick, 0, __ATOMIC_ACQ_REL) && !port->epollout)
+			_sio_tx(port);
+	}
+}
+
+
+/*
+ * Release port resources
+ * [18/10/2026]
+ */
+static void _sio_port_free(struct sioport_s *port) {
+	struct sioframe_s	*frame = port->frame;
+
+
+	if (frame) {
+		if (frame->timerfd) {
+			_evt_fd_del(frame->timerfd);
+			close(frame->timerfd);
+		}
+		if (frame->notifyfd)
+			close(frame->notifyfd);
+		free(frame->buf);
+		free(frame);
+	}
+
+	if (port->timerfd) {
+		_evt_fd_del(port->timerfd);
+		close(port->timerfd);
+	}
+	free(port->rx.buf);
+	free(port->tx.buf);
+	memset(port, 0, sizeof(*port));
+}
+
+
+/*
+ * Start servicing tty of the UART by the event thread,
+ * tty is switched to non-blocking mode
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sio_port_add(uint8_t uartno, fddef fd, const leiodcsiocfg_t *siocfg) {
+	struct sioport_s	*port;
+	int					flags, retstat = RETVAL_NEGATIVE;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	port = &glsio.ports[uartno];
+	if (port->fd) {
+		ERROR_LOGGER("COM%u is already serviced by the serial I/O engine", uartno + 1)
+		goto failed;
+	}
+
+	if (!glsio.kickfd) {
+		if ((glsio.kickfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+			ERROR_STD_LOGGER("eventfd()")
+			glsio.kickfd = 0;
+			goto failed;
+		}
+
+		if (_evt_fd_add(glsio.kickfd, _sio_kick, NULL)) {
+			close(glsio.kickfd);
+			glsio.kickfd = 0;
+			goto failed;
+		}
+	}
+
+	if (((flags = fcntl(fd, F_GETFL)) < 0) ||
+			fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
+		ERROR_STD_LOGGER("fcntl(COM%u, O_NONBLOCK)", uartno + 1)
+		goto failed;
+	}
+
+	port->uartno = uartno;
+	if (_sio_ring_alloc(&port->rx, (siocfg) ? siocfg->rxsize : 0) ||
+			_sio_ring_alloc(&port->tx, (siocfg) ? siocfg->txsize : 0))
+		goto release;
+
+	if ((port->charns = _rs485_sw_charns(uartno))) {
+		/*
+		 * RS485 direction is controlled by the engine
+		 */
+		if ((port->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+			ERROR_STD_LOGGER("timerfd_create(COM%u)", uartno + 1)
+			port->timerfd = 0;
+			goto release;
+		}
+
+		if (_evt_fd_add(port->timerfd, _sio_timer, port))
+			goto release;
+	}
+
+	if (siocfg) {
+		port->rxcallback = siocfg->rxcallback;
+		port->arg = siocfg->arg;
+	}
+
+	port->fd = fd;
+	if (_evt_fd_add(fd, _sio_tty_event, port))
+		goto release;
+	retstat = RETVAL_OK;
+	goto failed;
+
+
+	release:
+	_sio_port_free(port);
+
+	failed:
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_sio_port_add)
+
+
+/*
+ * Stop servicing tty of the UART, queued data is discarded
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sio_port_del(uint8_t uartno) {
+	struct sioport_s	*port;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	port = &glsio.ports[uartno];
+	if (port->fd) {
+		if (!port->stats.hangup)
+			_evt_fd_del(port->fd);
+		if (port->txen)
+			_rs485_sw_txen_set(uartno, 0);
+		_sio_port_free(port);
+	}
+	_evt_unlock();
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_sio_port_del)
+
+
+/*
+ * Read received data from the RX ring without blocking
+ * Return number of bytes read or -1 on error
+ * [18/10/2026]
+ * Event thread lock held
+ * [18/10/2026]
+ */
+int leiodc_sio_read(uint8_t uartno, void *buf, uint32_t size) {
+	struct sioport_s	*port;
+	uint32_t			head, tail, len;
+	int					retval = RETVAL_NEGATIVE;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	port = &glsio.ports[uartno];
+	if (!port->fd) {
+		ERROR_LOGGER("COM%u is not serviced by the serial I/O engine", uartno + 1)
+		goto failed;
+	}
+
+	if (port->frame) {
+		ERROR_LOGGER("COM%u is in framed receive mode, use leiodc_sio_frame_read()", uartno + 1)
+		goto failed;
+	}
+
+	tail = port->rx.tail;
+	head = __atomic_load_n(&port->rx.head, __ATOMIC_ACQUIRE);
+	if (!(len = head - tail)) {
+		retval = 0;
+		goto failed;
+	}
+	if (len > size)
+		len = size;
+
+	_sio_ring_get(&port->rx, tail, buf, len);
+	__atomic_store_n(&port->rx.tail, tail + len, __ATOMIC_RELEASE);
+	retval = len;
+
+
+	failed:
+	_evt_unlock();
+	return retval;
+}
+EXPORT_SYMBOL(leiodc_sio_read)
+
+
+/*
+ * Queue data for sending, data is queued either completely or not at all
+ * Return number of bytes queued or -1 if TX ring is full
+ * [18/10/2026]
+ * Event thread lock held
+ * [18/10/2026]
+ */
+int leiodc_sio_write(uint8_t uartno, const void *buf, uint32_t len) {
+	static const uint64_t	kick = 1;
+	struct sioport_s		*port;
+	uint32_t				head, tail;
+	int						retval = RETVAL_NEGATIVE;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	port = &glsio.ports[uartno];
+	if (!port->fd) {
+		ERROR_LOGGER("COM%u is not serviced by the serial I/O engine", uartno + 1)
+		goto failed;
+	}
+
+	head = port->tx.head;
+	tail = __atomic_load_n(&port->tx.tail, __ATOMIC_ACQUIRE);
+	if (len > (port->tx.mask + 1 - (head - tail))) {
+		port->stats.txfull++;
+		ERROR_LOGGER("COM%u TX ring is full, %u bytes not queued", uartno + 1, len)
+		goto failed;
+	}
+
+	_sio_ring_put(&port->tx, head, buf, len);
+	__atomic_store_n(&port->tx.head, head + len, __ATOMIC_RELEASE);
+
+	/*
+	 * Notify the engine only once until it picks up the data
+	 */
+	if (!__atomic_exchange_n(&port->txkick, 1, __ATOMIC_ACQ_REL)) {
+		if (write(glsio.kickfd, &kick, sizeof(kick)) != sizeof(kick)) {
+			ERROR_STD_LOGGER("write(COM%u kick)", uartno + 1)
+			goto failed;
+		}
+	}
+	retval = len;
+
+
+	failed:
+	_evt_unlock();
+	return retval;
+}
+EXPORT_SYMBOL(leiodc_sio_write)
+
+
+/*
+ * Get serial I/O engine statistics of the port
+ * Return -1 on error
+ * [18/10/2026]
+ * Destination checked, event thread lock held
+ * [18/10/2026]
+ */
+int leiodc_sio_stats_get(uint8_t uartno, leiodcsiostats_t *stats) {
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (!stats) {
+		ERROR_LOGGER("COM%u statistics destination is not specified", uartno + 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	memcpy(stats, &glsio.ports[uartno].stats, sizeof(*stats));
+	_evt_unlock();
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_sio_stats_get)
+
+
+/*
+ * Enable framed receive on the serviced port,
+ * frames are delimited by silence on the line longer than the inter-frame gap
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_sio_frame_enable(uint8_t uartno, const leiodcframecfg_t *framecfg) {
+	struct sioport_s	*port;
+	struct sioframe_s	*frame = NULL;
+	int					retstat = RETVAL_NEGATIVE;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	port = &glsio.ports[uartno];
+	if (!port->fd || port->stats.hangup) {
+		ERROR_LOGGER("COM%u is not serviced by the serial I/O engine", uartno + 1)
+		goto failed;
+	}
+	if (port->frame) {
+		ERROR_LOGGER("COM%u framed receive is already enabled", uartno + 1)
+		goto failed;
+	}
+
+	if (!(port->charnsrx = _serial_char_time(port->fd)))
+		goto failed;
+
+	if (!(frame = calloc(1, sizeof(*frame)))) {
+		ERROR_STD_LOGGER("calloc(frame)")
+		goto failed;
+	}
+
+	frame->size = (framecfg && framecfg->maxlen) ? framecfg->maxlen : LEIODC_FRAME_MAX_DEFAULT;
+	if (!(frame->buf = malloc(frame->size))) {
+		ERROR_STD_LOGGER("malloc(%u)", frame->size)
+		goto release;
+	}
+
+	if (framecfg && framecfg->gapus) {
+		frame->gapns = (uint64_t) framecfg->gapus * 1000;
+	}
+	else {
+		/*
+		 * 3.5 characters, fixed 1750 us above 19200 baud (Modbus RTU)
+		 */
+		frame->gapns = (port->charnsrx * 7) / 2;
+		if (frame->gapns < 1750000)
+			frame->gapns = 1750000;
+	}
+
+	if (framecfg) {
+		frame->callback = framecfg->callback;
+		frame->arg = framecfg->arg;
+	}
+
+	if ((frame->notifyfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("eventfd(COM%u frame)", uartno + 1)
+		frame->notifyfd = 0;
+		goto release;
+	}
+
+	if ((frame->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+		ERROR_STD_LOGGER("timerfd_create(COM%u frame)", uartno + 1)
+		frame->timerfd = 0;
+		goto release;
+	}
+
+	if (_evt_fd_add(frame->timerfd, _sio_frame_timer, port))
+		goto release;
+
+	/*
+	 * Byte stream received so far is discarded
+	 */
+	__atomic_store_n(&port->rx.tail, port->rx.head, __ATOMIC_RELEASE);
+	port->frame = frame;
+	retstat = RETVAL_OK;
+	goto failed;
+
+
+	release:
+	if (frame->timerfd)
+		close(frame->timerfd);
+	if (frame->notifyfd)
+		close(frame->notifyfd);
+	free(frame->buf);
+	free(frame);
+
+	failed:
+	_evt_unlock();
+	return retstat;
+}
+EXPORT_SYMBOL(leiodc_sio_frame_enable)
+
+
+/*
+ * Get pollable descriptor of the port in framed receive mode,
+ * descriptor is readable while frames are queued
+ * Return -1 on error
+ * [18/10/2026]
+ * Event thread lock held
+ * [18/10/2026]
+ */
+int leiodc_sio_frame_fd(uint8_t uartno) {
+	int		notifyfd = RETVAL_NEGATIVE;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	if (glsio.ports[uartno].frame)
+		notifyfd = glsio.ports[uartno].frame->notifyfd;
+	else
+		ERROR_LOGGER("COM%u framed receive is not enabled", uartno + 1)
+	_evt_unlock();
+	return notifyfd;
+}
+EXPORT_SYMBOL(leiodc_sio_frame_fd)
+
+
+/*
+ * Read queued frame without blocking, frame data is copied to buf
+ * and truncated if longer than size
+ * Return frame length, 0 if no frames are queued or -1 on error
+ * [18/10/2026]
+ * Event thread lock held
+ * [18/10/2026]
+ */
+int leiodc_sio_frame_read(uint8_t uartno, leiodcframe_t *frame, void *buf, uint32_t size) {
+	struct sioport_s		*port;
+	struct sioframehdr_s	hdr;
+	uint32_t				head, tail;
+	uint64_t				notify;
+	int						retval = RETVAL_NEGATIVE;
+
+
+	if (uartno >= LEIODC_UART_COUNT) {
+		ERROR_LOGGER("UART number '%u' is to high, must be between 0...%u", uartno, LEIODC_UART_COUNT - 1)
+		return RETVAL_NEGATIVE;
+	}
+
+	_evt_lock();
+	port = &glsio.ports[uartno];
+	if (!port->frame) {
+		ERROR_LOGGER("COM%u framed receive is not enabled", uartno + 1)
+		goto failed;
+	}
+
+	tail = port->rx.tail;
+	head = __atomic_load_n(&port->rx.head, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		/*
+		 * Clear notification, then check again for a frame queued meanwhile
+		 */
+		if (read(port->frame->notifyfd, &notify, sizeof(notify)) < 0) {}
+		head = __atomic_load_n(&port->rx.head, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			retval = 0;
+			goto failed;
+		}
+	}
+
+	_sio_ring_get(&port->rx, tail, &hdr, sizeof(hdr));
+	frame->len = hdr.len;
+	frame->flags = hdr.flags;
+	frame->first = hdr.first;
+	frame->last = hdr.last;
+	if (size < hdr.len) {
+		frame->flags |= LEIODC_FRAME_TRUNCATED;
+		frame->len = size;
+	}
+	_sio_ring_get(&port->rx, tail + sizeof(hdr), buf, frame->len);
+	frame->data = buf;
+
+	__atomic_store_n(&port->rx.tail, tail + sizeof(hdr) + hdr.len, __ATOMIC_RELEASE);
+	retval = frame->len;
+
+
+	failed:
+	_evt_unlock();
+	return retval;
+}
+EXPORT_SYMBOL(leiodc_sio_frame_read)
@@ -0,0 +1,400 @@
+/*
+ ============================================================================
+ Name        : libleiodcstate.c
+ Author      : AK
+ Version     : V1.05
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC pin state mirror. Shadow state of all pins is kept
+               by the process owning GPIO lines and can be published in
+               shared memory. Other processes read consistent snapshots
+               without syscalls, updates are protected by a seqlock.
+
+  Change log :
+
+  *********V1.05 18/10/2026**************
+  Reader yields between retries, shared memory object is always created
+  by the publisher, object of another user is not adopted
+
+  *********V1.04 18/10/2026**************
+  Update lock is a priority inheritance mutex
+
+  *********V1.03 18/10/2026**************
+  State changes are passed to the pin history recorder
+
+  *********V1.02 18/10/2026**************
+  Pin direction can be read by the library
+
+  *********V1.01 18/10/2026**************
+  Interface mode of the UART can be read by the library
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <fcntl.h>			// File controls
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libleiodcint.h"
+
+
+#define STATE_SHM_NAME			"/leiodc-state"			// Shared memory object name
+#define STATE_SHM_MAGIC			0x4C454F53				// 'LEOS'
+#define STATE_SHM_VERSION		1
+#define STATE_READ_RETRIES		1000					// Publisher may have died during update
+
+
+/*
+ * Shared memory page, sequence counter is odd while publisher is updating
+ */
+struct statepage_s {
+	uint32_t		magic;
+	uint16_t		version;
+	uint16_t		statesize;		// Size of the state structure
+	uint32_t		seq;
+	leiodcstate_t	state;
+};
+
+
+static struct statepage_s glprivpage = {
+	.magic = STATE_SHM_MAGIC,
+	.version = STATE_SHM_VERSION,
+	.statesize = sizeof(leiodcstate_t),
+	.state = {
+		.m2config = RETVAL_NEGATIVE,
+		.boardver = RETVAL_NEGATIVE,
+	},
+};
+static struct statepage_s *glpage = &glprivpage;		// Publisher page (private until published)
+static const struct statepage_s *glreadpage;			// Reader page
+static pthread_mutex_t glstatelock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+
+/*
+ * Library initialization constructor, pin values are unknown
+ * [18/10/2026]
+ */
+static void LELIBCONSTRUCTOR _state_init(void) {
+	int		i;
+
+
+	_rt_mutex_init(&glstatelock);
+	for (i = 0; i < lepin_count; i++)
+		glprivpage.state.pins[i].value = LEIODC_STATE_UNKNOWN;
+}
+
+
+/*
+ * Begin state update
+ * [18/10/2026]
+ */
+static leiodcstate_t *_state_update_begin(void) {
+
+	pthread_mutex_lock(&glstatelock);
+	__atomic_store_n(&glpage->seq, glpage->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return &glpage->state;
+}
+
+
+/*
+ * Complete state update
+ * [18/10/2026]
+ */
+static void _state_update_end(void) {
+	nanotime_t		now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	glpage->state.updatens = ((uint64_t) now.tv_sec * SECINNSEC) + now.tv_nsec;
+	glpage->state.updates++;
+
+	__atomic_store_n(&glpage->seq, glpage->seq + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&glstatelock);
+}
+
+
+/*
+ * Update state of the handle lines
+ * dir - lepindir_unknown if direction is not changed
+ * [18/10/2026]
+ */
+void _state_lines_update(struct handle_s *lrhandle, __u32 linemask, __u32 values, leiodcpindir_e dir) {
+	leiodcstate_t	*state;
+	leiodcpin_e		lepin;
+	__u32			pbit;
+
+
+	state = _state_update_begin();
+	for (lepin = lrhandle->minp; lepin <= lrhandle->maxp; lepin++) {
+		pbit = HANDLE_PIN_BIT(lrhandle, lepin);
+		if (!(linemask & pbit))
+			continue;
+
+		if (dir)
+			state->pins[lepin].dir = dir;
+		state->pins[lepin].value = (dir == lepindir_in) ? LEIODC_STATE_UNKNOWN : BOOL_CHECK(values & pbit);
+	}
+	_state_update_end();
+	_history_lines(lrhandle, linemask, values, dir);
+}
+
+
+/*
+ * Update state of a single pin
+ * value - LEIODC_STATE_UNKNOWN if not known
+ * [18/10/2026]
+ */
+void _state_pin_update(leiodcpin lepin, leiodcpindir_e dir, int value) {
+	leiodcstate_t	*state;
+
+
+	if (lepin >= lepin_count)
+		return;
+
+	state = _state_update_begin();
+	if (dir)
+		state->pins[lepin].dir = dir;
+	state->pins[lepin].value = value;
+	_state_update_end();
+	_history_pin(lepin, dir, value);
+}
+
+
+/*
+ * Update interface mode of the UART
+ * [18/10/2026]
+ */
+void _state_uart_update(uint8_t uartno, uint8_t interface) {
+	leiodcstate_t	*state;
+
+
+	if (uartno >= LEIODC_UART_COUNT)
+		return;
+
+	state = _state_update_begin();
+	state->uartint[uartno] = interface;
+	_state_update_end();
+	_history_uart(uartno, interface);
+}
+
+
+/*
+ * Get interface mode of the UART set by this process
+ * [18/10/2026]
+ */
+uint8_t _state_uart_get(uint8_t uartno) {
+
+	if (uartno >= LEIODC_UART_COUNT)
+		return 0;
+	return __atomic_load_n(&glpage->state.uartint[uartno], __ATOMIC_RELAXED);
+}
+
+
+/*
+ * Get direction of the pin set by this process
+ * [18/10/2026]
+ */
+leiodcpindir_e _state_pin_dir_get(leiodcpin lepin) {
+
+	if (lepin >= lepin_count)
+		return lepindir_unknown;
+	return __atomic_load_n(&glpage->state.pins[lepin].dir, __ATOMIC_RELAXED);
+}
+
+
+/*
+ * Update M.2 card config
+ * [18/10/2026]
+ */
+void _state_m2_update(int m2config) {
+	leiodcstate_t	*state;
+
+
+	state = _state_update_begin();
+	state->m2config = m2config;
+	_state_update_end();
+	_history_ext(LEIODC_HEXT_M2CONFIG, m2config);
+}
+
+
+/*
+ * Update MB board version
+ * [18/10/2026]
+ */
+void _state_boardver_update(int boardver) {
+	leiodcstate_t	*state;
+
+
+	state = _state_update_begin();
+	state->boardver = boardver;
+	_state_update_end();
+	_history_ext(LEIODC_HEXT_BOARDVER, boardver);
+}
+
+
+/*
+ * Publish pin state mirror in shared memory,
+ * must be called by the process owning GPIO lines
+ * Return -1 on error
+ * [18/10/2026]
+ * Stale object removed, new one created exclusively
+ * [18/10/2026]
+ */
+int leiodc_state_publish(void) {
+	struct statepage_s	*page;
+	fddef				fd;
+
+
+	if (glpage != &glprivpage)
+		return RETVAL_OK;		// Already published
+
+	/*
+	 * Object left by a previous publisher is removed, object of another
+	 * user can't be removed (sticky /dev/shm) and exclusive create fails
+	 */
+	if (shm_unlink(STATE_SHM_NAME) && (errno != ENOENT)) {
+		ERROR_STD_LOGGER("shm_unlink(%s)", STATE_SHM_NAME)
+		return RETVAL_NEGATIVE;
+	}
+
+	if ((fd = shm_open(STATE_SHM_NAME, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0) {
+		ERROR_STD_LOGGER("shm_open(%s)", STATE_SHM_NAME)
+		return RETVAL_NEGATIVE;
+	}
+
+	if (ftruncate(fd, sizeof(*page))) {
+		ERROR_STD_LOGGER("ftruncate(%s)", STATE_SHM_NAME)
+		close(fd);
+		return RETVAL_NEGATIVE;
+	}
+
+	page = mmap(NULL, sizeof(*page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (page == MAP_FAILED) {
+		ERROR_STD_LOGGER("mmap(%s)", STATE_SHM_NAME)
+		return RETVAL_NEGATIVE;
+	}
+
+	pthread_mutex_lock(&glstatelock);
+	__atomic_store_n(&page->seq, page->seq | 1, __ATOMIC_RELAXED);		// Page invalid while copying
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&page->state, &glprivpage.state, sizeof(page->state));
+	page->state.owner = getpid();
+	page->magic = STATE_SHM_MAGIC;
+	page->version = STATE_SHM_VERSION;
+	page->statesize = sizeof(page->state);
+	__atomic_store_n(&page->seq, page->seq + 1, __ATOMIC_RELEASE);
+	glpage = page;
+	pthread_mutex_unlock(&glstatelock);
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_state_publish)
+
+
+/*
+ * Open pin state mirror published by another process
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_state_open(void) {
+	struct statepage_s	*page;
+	fddef				fd;
+
+
+	if (glreadpage)
+		return RETVAL_OK;
+
+	if ((fd = shm_open(STATE_SHM_NAME, O_RDONLY | O_CLOEXEC, 0)) < 0) {
+		ERROR_STD_LOGGER("shm_open(%s), state is not published", STATE_SHM_NAME)
+		return RETVAL_NEGATIVE;
+	}
+
+	page = mmap(NULL, sizeof(*page), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (page == MAP_FAILED) {
+		ERROR_STD_LOGGER("mmap(%s)", STATE_SHM_NAME)
+		return RETVAL_NEGATIVE;
+	}
+
+	if ((page->magic != STATE_SHM_MAGIC) ||
+			(page->version != STATE_SHM_VERSION) ||
+			(page->statesize != sizeof(leiodcstate_t))) {
+		ERROR_LOGGER("Pin state mirror %s is not compatible (version %u, size %u)",
+				STATE_SHM_NAME, page->version, page->statesize)
+		munmap(page, sizeof(*page));
+		return RETVAL_NEGATIVE;
+	}
+
+	glreadpage = page;
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_state_open)
+
+
+/*
+ * Read consistent snapshot of the pin state without syscalls,
+ * state of this process is returned if mirror is not opened
+ * Return -1 if publisher keeps the page locked
+ * [18/10/2026]
+ * Yield between retries
+ * [18/10/2026]
+ */
+int leiodc_state_read(leiodcstate_t *state) {
+	const struct statepage_s	*page = (glreadpage) ? glreadpage : glpage;
+	uint32_t					seq;
+	int							retries;
+
+
+	for (retries = 0; retries < STATE_READ_RETRIES; retries++) {
+		if (retries)
+			sched_yield();		// Let preempted publisher complete the update
+
+		seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+
+		memcpy(state, &page->state, sizeof(*state));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (seq == __atomic_load_n(&page->seq, __ATOMIC_RELAXED))
+			return RETVAL_OK;
+	}
+
+	ERROR_LOGGER("Pin state mirror is locked by the publisher")
+	return RETVAL_NEGATIVE;
+}
+EXPORT_SYMBOL(leiodc_state_read)
+
+
+/*
+ * Close pin state mirror
+ * Return -1 on error
+ * [18/10/2026]
+ */
+int leiodc_state_close(void) {
+
+	if (!glreadpage)
+		return RETVAL_OK;
+
+	if (munmap((void *) glreadpage, sizeof(*glreadpage))) {
+		ERROR_STD_LOGGER("munmap(%s)", STATE_SHM_NAME)
+		return RETVAL_NEGATIVE;
+	}
+	glreadpage = NULL;
+	return RETVAL_OK;
+}
+EXPORT_SYMBOL(leiodc_state_close)
@@ -0,0 +1,514 @@
+/*
+ ============================================================================
+ Name        : libleiodcstats.c
+ Author      : AK
+ Version     : V1.02
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC library call counters and latency histograms,
+               every thread updates its own slot, slots are merged on read
+
+  Change log :
+
+  *********V1.02 18/10/2026**************
+  Slot read retries are limited, baseline is protected by reader lock
+
+  *********V1.01 18/10/2026**************
+  Shared slot lock is a priority inheritance mutex
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>			// Error number
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "libleiodcint.h"
+
+
+#ifndef LEIODC_NO_STATS
+#define STATS_SLOT_COUNT	16			// Number of per-thread slots, threads above this number share the last slot
+#define STATS_HIST_SHIFT	10			// First histogram bucket limit 2^10 ns
+#define STATS_READ_RETRIES	1000		// Attempts to read consistent slot, owner may be preempted during update
+
+
+/*
+ * Statistics slot, sequence counter is odd while the owner thread is updating
+ */
+struct statslot_s {
+	uint32_t		seq;
+	uint32_t		used;
+	uint32_t		gen;				// Reset generation of the maximum values
+	leiodcstats_t	stats;
+};
+
+
+static struct statslot_s glslots[STATS_SLOT_COUNT];
+static struct statslot_s *glshared = &glslots[STATS_SLOT_COUNT - 1];
+static pthread_mutex_t glsharedlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t glslotkey;
+static pthread_once_t glslotonce = PTHREAD_ONCE_INIT;
+static __thread struct statslot_s *tlslot;
+static pthread_mutex_t glreadlock = PTHREAD_MUTEX_INITIALIZER;	// Baseline and reset generation
+static leiodcstats_t glbaseline;				// Snapshot taken by leiodc_stats_reset()
+static uint32_t glresetgen;
+
+
+
+
+/*
+ * Library initialization constructor
+ * [18/10/2026]
+ */
+static void LELIBCONSTRUCTOR _stats_init(void) {
+
+	_rt_mutex_init(&glsharedlock);
+}
+
+
+/*
+ * Thread exits, slot can be taken by another thread,
+ * counters are preserved
+ * [18/10/2026]
+ */
+static void _stats_slot_release(void *arg) {
+	struct statslot_s	*slot = arg;
+
+
+	__atomic_store_n(&slot->used, 0, __ATOMIC_RELEASE);
+}
+
+
+/*
+ * Create slot release key
+ * [18/10/2026]
+ */
+static void _stats_key_create(void) {
+
+	pthread_key_create(&glslotkey, _stats_slot_release);
+}
+
+
+/*
+ * Get slot of the current thread, take a free slot on first use
+ * [18/10/2026]
+ */
+static struct statslot_s *_stats_slot_get(void) {
+	int		i;
+
+
+	if (tlslot)
+		return tlslot;
+
+	pthread_once(&glslotonce, _stats_key_create);
+	for (i = 0; i < (STATS_SLOT_COUNT - 1); i++) {
+		if (__sync_bool_compare_and_swap(&glslots[i].used, 0, 1)) {
+			tlslot = &glslots[i];
+			pthread_setspecific(glslotkey, tlslot);
+			return tlslot;
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Open slot for update, shared slot is locked
+ * [18/10/2026]
+ */
+static struct statslot_s *_stats_update_begin(void) {
+	struct statslot_s	*slot;
+
+
+	if (!(slot = _stats_slot_get())) {
+		pthread_mutex_lock(&glsharedlock);
+		slot = glshared;
+	}
+
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return slot;
+}
+
+
+/*
+ * Close slot update
+ * [18/10/2026]
+ */
+static void _stats_update_end(struct statslot_s *slot) {
+
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+
+	if (slot == glshared)
+		pthread_mutex_unlock(&glsharedlock);
+}
+
+
+/*
+ * Get monotonic time in nanoseconds
+ * [18/10/2026]
+ */
+static uint64_t _stats_nsec(const nanotime_t *tspec) {
+
+	return ((uint64_t) tspec->tv_sec * SECINNSEC) + tspec->tv_nsec;
+}
+
+
+/*
+ * API function entry
+ * [18/10/2026]
+ */
+struct statsapi_s _stats_api_begin(leiodcstatapi_e api) {
+	struct statsapi_s	sapi;
+
+
+	sapi.api = api;
+	clock_gettime(CLOCK_MONOTONIC, &sapi.start);
+	return sapi;
+}
+
+
+/*
+ * API function exit (executed when instrumented function returns)
+ * [18/10/2026]
+ */
+void _stats_api_end(struct statsapi_s *sapi) {
+	struct statslot_s	*slot;
+	nanotime_t			end;
+	uint64_t			latency;
+	int					bucket;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	latency = _stats_nsec(&end) - _stats_nsec(&sapi->start);
+
+	bucket = 0;
+	if (latency >> STATS_HIST_SHIFT) {
+		bucket = (63 - __builtin_clzll(latency)) - (STATS_HIST_SHIFT - 1);
+		if (bucket >= LEIODC_STATS_HIST_BUCKETS)
+			bucket = LEIODC_STATS_HIST_BUCKETS - 1;
+	}
+
+	slot = _stats_update_begin();
+	if (slot->gen != __atomic_load_n(&glresetgen, __ATOMIC_RELAXED)) {
+		memset(slot->stats.latmax, 0, sizeof(slot->stats.latmax));
+		slot->gen = glresetgen;
+	}
+	slot->stats.calls[sapi->api]++;
+	slot->stats.latsum[sapi->api] += latency;
+	if (latency > slot->stats.latmax[sapi->api])
+		slot->stats.latmax[sapi->api] = latency;
+	slot->stats.lathist[sapi->api][bucket]++;
+	_stats_update_end(slot);
+}
+
+
+/*
+ * Count kernel call
+ * [18/10/2026]
+ */
+void _stats_kcall(leiodcstatkcall_e kcall) {
+	struct statslot_s	*slot;
+
+
+	slot = _stats_update_begin();
+	slot->stats.kcalls[kcall]++;
+	_stats_update_end(slot);
+}
+
+
+/*
+ * Kernel call type of the GPIO line handle
+ * [18/10/2026]
+ */
+leiodcstatkcall_e _stats_handle_kcall(struct handle_s *lrhandle) {
+
+	if (lrhandle == &glrhandles[handle_uart])
+		return lestatk_uart;
+	if (lrhandle == &glrhandles[handle_modem])
+		return lestatk_modem;
+	if (lrhandle == &glrhandles[handle_heartbeat])
+		return lestatk_heartbeat;
+	return lestatk_chip;
+}
+
+
+/*
+ * Count error by cause
+ * [18/10/2026]
+ */
+void _stats_error(int errnum) {
+	struct statslot_s	*slot;
+	leiodcstaterr_e		cause;
+
+
+	switch (errnum) {
+	case 0:
+		cause = lestaterr_lib;
+		break;
+	case EPERM:
+	case EACCES:
+		cause = lestaterr_perm;
+		break;
+	case EBUSY:
+		cause = lestaterr_busy;
+		break;
+	case ENOENT:
+	case ENODEV:
+	case ENXIO:
+		cause = lestaterr_nodev;
+		break;
+	case EINVAL:
+	case ENOTTY:
+	case EOPNOTSUPP:
+		cause = lestaterr_inval;
+		break;
+	case EIO:
+		cause = lestaterr_io;
+		break;
+	default:
+		cause = lestaterr_other;
+		break;
+	}
+
+	slot = _stats_update_begin();
+	slot->stats.errors[cause]++;
+	_stats_update_end(slot);
+}
+
+
+/*
+ * Add (or subtract) cumulative counters of the source to the destination,
+ * maximum values are not cumulative and remain unchanged
+ * [18/10/2026]
+ */
+static void _stats_add(leiodcstats_t *dst, const leiodcstats_t *src, int subtract) {
+	uint64_t		latmax[lestat_api_count];
+	uint64_t		*dp = (uint64_t *) dst;
+	const uint64_t	*sp = (const uint64_t *) src;
+	int				i;
+
+
+	memcpy(latmax, dst->latmax, sizeof(latmax));
+	for (i = 0; i < (sizeof(*dst) / sizeof(uint64_t)); i++)
+		dp[i] = (subtract) ? (dp[i] - sp[i]) : (dp[i] + sp[i]);
+	memcpy(dst->latmax, latmax, sizeof(latmax));
+}
+
+
+/*
+ * Read consistent copy of the slot
+ * Return -1 if the slot is updated continuously
+ * [18/10/2026]
+ */
+static int _stats_slot_read(const struct statslot_s *slot, leiodcstats_t *copy, uint32_t *gen) {
+	uint32_t		seq;
+	int				retries;
+
+
+	for (retries = 0; retries < STATS_READ_RETRIES; retries++) {
+		if (retries)
+			sched_yield();		// Let preempted owner complete the update
+
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+
+		memcpy(copy, &slot->stats, sizeof(*copy));
+		*gen = slot->gen;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (seq == __atomic_load_n(&slot->seq, __ATOMIC_RELAXED))
+			return RETVAL_OK;
+	}
+	return RETVAL_NEGATIVE;
+}
+
+
+/*
+ * Merge all thread slots, called with reader lock held,
+ * maximum values of the slots not updated since last reset are ignored
+ * Return -1 on error
+ * [18/10/2026]
+ * Slot read retries limited
+ * [18/10/2026]
+ */
+static int _stats_merge(leiodcstats_t *stats) {
+	leiodcstats_t	copy;
+	uint32_t		gen;
+	int				i, a;
+
+
+	memset(stats, 0, sizeof(*stats));
+	for (i = 0; i < STATS_SLOT_COUNT; i++) {
+		if (_stats_slot_read(&glslots[i], &copy, &gen)) {
+			ERROR_LOGGER("Statistics slot %d is updated continuously", i)
+			return RETVAL_NEGATIVE;
+		}
+
+		if (gen == glresetgen) {
+			for (a = 0; a < lestat_api_count; a++) {
+				if (copy.latmax[a] > stats->latmax[a])
+					stats->latmax[a] = copy.latmax[a];
+			}
+		}
+		_stats_add(stats, &copy, 0);
+	}
+	return RETVAL_OK;
+}
+#endif	// LEIODC_NO_STATS
+
+
+/*
+ * Get statistics snapshot (since library load or last reset)
+ * Return -1 on error or if statistics are not compiled in
+ * [18/10/2026]
+ * Reader lock
+ * [18/10/2026]
+ */
+int leiodc_stats_get(leiodcstats_t *stats) {
+
+#ifdef LEIODC_NO_STATS
+	ERROR_LOGGER("Statistics are disabled in this library build")
+	return RETVAL_NEGATIVE;
+#else
+	if (!stats) {
+		ERROR_LOGGER("Statistics buffer is not specified")
+		return RETVAL_NEGATIVE;
+	}
+
+	pthread_mutex_lock(&glreadlock);
+	if (_stats_merge(stats)) {
+		pthread_mutex_unlock(&glreadlock);
+		return RETVAL_NEGATIVE;
+	}
+	_stats_add(stats, &glbaseline, 1);
+	pthread_mutex_unlock(&glreadlock);
+	return RETVAL_OK;
+#endif
+}
+EXPORT_SYMBOL(leiodc_stats_get)
+
+
+/*
+ * Reset statistics, counters of the current snapshot become baseline
+ * Return -1 on error or if statistics are not compiled in
+ * [18/10/2026]
+ * Reader lock
+ * [18/10/2026]
+ */
+int leiodc_stats_reset(void) {
+
+#ifdef LEIODC_NO_STATS
+	ERROR_LOGGER("Statistics are disabled in this library build")
+	return RETVAL_NEGATIVE;
+#else
+	leiodcstats_t	stats;
+
+
+	pthread_mutex_lock(&glreadlock);
+	if (_stats_merge(&stats)) {
+		pthread_mutex_unlock(&glreadlock);
+		return RETVAL_NEGATIVE;
+	}
+	memcpy(&glbaseline, &stats, sizeof(glbaseline));
+	__atomic_add_fetch(&glresetgen, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&glreadlock);
+	return RETVAL_OK;
+#endif
+}
+EXPORT_SYMBOL(leiodc_stats_reset)
+
+
+/*
+ * Print statistics snapshot to the buffer as text
+ * Return number of characters written or -1 on error
+ * [18/10/2026]
+ */
+int leiodc_stats_dump(lechar *buf, uint32_t size) {
+
+#ifdef LEIODC_NO_STATS
+	ERROR_LOGGER("Statistics are disabled in this library build")
+	return RETVAL_NEGATIVE;
+#else
+	static const lechar		*apinames[lestat_api_count] = {
+			[lestat_pin_init]				= "pin_init",
+			[lestat_pin_dir_out_state_set]	= "pin_dir_out_state_set",
+			[lestat_pin_state_set]			= "pin_state_set",
+			[lestat_pin_state_get]			= "pin_state_get",
+			[lestat_pin_dir_in_set]			= "pin_dir_in_set",
+			[lestat_uart_int]				= "uart_int",
+			[lestat_m2_init]				= "m2_init",
+			[lestat_m2_config_get]			= "m2_config_get",
+			[lestat_board_ver_get]			= "board_ver_get",
+			[lestat_uart_int_get]			= "uart_int_get",
+			[lestat_uart_int_all]			= "uart_int_all",
+			[lestat_serial_config]			= "serial_config",
+	};
+	static const lechar		*kcallnames[lestatk_count] = {
+			[lestatk_uart]		= "uart-gpio",
+			[lestatk_modem]		= "modem-gpio",
+			[lestatk_heartbeat]	= "hb-gpio",
+			[lestatk_chip]		= "gpiochip",
+			[lestatk_tty]		= "tty",
+			[lestatk_sysfs]		= "sysfs",
+	};
+	static const lechar		*errnames[lestaterr_count] = {
+			[lestaterr_lib]		= "library",
+			[lestaterr_perm]	= "permission",
+			[lestaterr_busy]	= "busy",
+			[lestaterr_nodev]	= "nodevice",
+			[lestaterr_inval]	= "invalid",
+			[lestaterr_io]		= "io",
+			[lestaterr_other]	= "other",
+	};
+	leiodcstats_t	stats;
+	uint32_t		len = 0;
+	int				i, b;
+
+
+#define STATS_PRINTF(...)\
+		if (len < size)\
+			len += snprintf(&buf[len], size - len, __VA_ARGS__);
+
+	if (!buf || !size) {
+		ERROR_LOGGER("Statistics text buffer is not specified")
+		return RETVAL_NEGATIVE;
+	}
+
+	if (leiodc_stats_get(&stats))
+		return RETVAL_NEGATIVE;
+	buf[0] = '\0';
+
+	for (i = 0; i < lestat_api_count; i++) {
+		if (!stats.calls[i])
+			continue;
+		STATS_PRINTF("api %s calls=%llu avg=%lluns max=%lluns hist=", apinames[i],
+				(unsigned long long) stats.calls[i],
+				(unsigned long long) (stats.latsum[i] / stats.calls[i]),
+				(unsigned long long) stats.latmax[i])
+		for (b = 0; b < LEIODC_STATS_HIST_BUCKETS; b++) {
+			STATS_PRINTF("%s%llu", (b) ? "," : "", (unsigned long long) stats.lathist[i][b])
+		}
+		STATS_PRINTF("\n")
+	}
+
+	for (i = 0; i < lestatk_count; i++) {
+		STATS_PRINTF("kcall %s=%llu\n", kcallnames[i], (unsigned long long) stats.kcalls[i])
+	}
+
+	for (i = 0; i < lestaterr_count; i++) {
+		STATS_PRINTF("error %s=%llu\n", errnames[i], (unsigned long long) stats.errors[i])
+	}
+
+	return (len < size) ? len : (size - 1);
+#endif
+}
+EXPORT_SYMBOL(leiodc_stats_dump)
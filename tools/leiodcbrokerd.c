@@ -0,0 +1,74 @@
+/*
+ ============================================================================
+ Name        : leiodcbrokerd.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC GPIO broker daemon, owns GPIO line requests
+               on behalf of all processes linked with libleiodc
+
+  Usage: leiodcbrokerd [-g group] [socket path]
+    -g  Group allowed to use the broker socket (LEIODC_BROKER_GROUP),
+        socket is accessible by the owner and group only
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  Socket group option
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "libleiodchw.h"
+
+
+
+
+/*
+ * Termination signal handler
+ * [18/10/2026]
+ */
+static void _signal_handler(int signum) {
+
+	leiodc_broker_stop();
+}
+
+
+int main(int argc, char *argv[]) {
+	sigaction_t		sigact;
+	int				opt;
+
+
+	while ((opt = getopt(argc, argv, "g:")) != -1) {
+		switch (opt) {
+		case 'g':
+			setenv("LEIODC_BROKER_GROUP", optarg, 1);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-g group] [socket path]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	memset(&sigact, 0, sizeof(sigact));
+	sigact.sa_handler = _signal_handler;		// No SA_RESTART, poll() must be interrupted
+	sigaction(SIGTERM, &sigact, NULL);
+	sigaction(SIGINT, &sigact, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	if (leiodc_broker_run((optind < argc) ? argv[optind] : NULL)) {
+		fprintf(stderr, "%s\n", LibErrorString);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
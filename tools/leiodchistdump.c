@@ -0,0 +1,312 @@
+/*
+ ============================================================================
+ Name        : leiodchistdump.c
+ Author      : AK
+ Version     : V1.00
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC pin history decoder. Ring file written by the pin
+               history recorder (leiodc_history_start()) is decoded offline,
+               blocks are printed oldest first with CLOCK_REALTIME timestamps.
+
+  Usage: leiodchistdump [-s] file
+    -s  Print state snapshot at the start of every block
+
+  Change log :
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "libleiodchw.h"
+
+
+static const char *const pinnames[lepin_count] = {
+	[lepin_COM1_RS232]		= "COM1_RS232",
+	[lepin_COM1_RS422_RX1]	= "COM1_RS422_RX1",
+	[lepin_COM1_RS422_TX1]	= "COM1_RS422_TX1",
+	[lepin_COM1_RS422_RX2]	= "COM1_RS422_RX2",
+	[lepin_COM1_RS422_TX2]	= "COM1_RS422_TX2",
+	[lepin_COM2_RS232]		= "COM2_RS232",
+	[lepin_COM2_RS422_RX1]	= "COM2_RS422_RX1",
+	[lepin_COM2_RS422_TX1]	= "COM2_RS422_TX1",
+	[lepin_COM2_RS422_RX2]	= "COM2_RS422_RX2",
+	[lepin_COM2_RS422_TX2]	= "COM2_RS422_TX2",
+	[lepin_COM3_RS232]		= "COM3_RS232",
+	[lepin_COM3_RS422_RX1]	= "COM3_RS422_RX1",
+	[lepin_COM3_RS422_TX1]	= "COM3_RS422_TX1",
+	[lepin_COM3_RS422_RX2]	= "COM3_RS422_RX2",
+	[lepin_COM3_RS422_TX2]	= "COM3_RS422_TX2",
+	[lepin_heartbeat]		= "heartbeat",
+	[lepin_modem_reset]		= "modem_reset",
+	[lepin_modem_power]		= "modem_power",
+	[lepin_M2_cfg0]			= "M2_cfg0",
+	[lepin_M2_cfg1]			= "M2_cfg1",
+	[lepin_M2_cfg2]			= "M2_cfg2",
+	[lepin_M2_cfg3]			= "M2_cfg3",
+	[lepin_board_ver0]		= "board_ver0",
+	[lepin_board_ver1]		= "board_ver1",
+	[lepin_board_ver2]		= "board_ver2",
+	[lepin_board_ver3]		= "board_ver3",
+};
+
+
+static const char *const uartnames[] = {
+	[0]					= "none",
+	[leuart_RS232]		= "RS232",
+	[leuart_RS485def]	= "RS485def",
+	[leuart_RS485rev]	= "RS485rev",
+	[leuart_RS422def]	= "RS422def",
+	[leuart_RS422rev]	= "RS422rev",
+};
+
+
+static const char *const levelnames[] = {
+	[LEIODC_HREC_LOW]	= "low",
+	[LEIODC_HREC_HIGH]	= "high",
+	[LEIODC_HREC_INPUT]	= "input",
+	[LEIODC_HREC_FALL]	= "fall",
+	[LEIODC_HREC_RISE]	= "rise",
+};
+
+
+
+
+/*
+ * Pin name
+ */
+static const char *_pin_name(uint8_t lepin) {
+	static char		unknown[16];
+
+
+	if ((lepin < lepin_count) && pinnames[lepin])
+		return pinnames[lepin];
+	snprintf(unknown, sizeof(unknown), "lepin%u", lepin);
+	return unknown;
+}
+
+
+/*
+ * UART interface name
+ */
+static const char *_uart_name(uint8_t interface) {
+
+	return (interface < (sizeof(uartnames) / sizeof(uartnames[0]))) ? uartnames[interface] : "unknown";
+}
+
+
+/*
+ * Print timestamp
+ */
+static void _print_time(int64_t ns) {
+	struct tm		tm;
+	time_t			sec = ns / 1000000000;
+	char			buf[32];
+
+
+	localtime_r(&sec, &tm);
+	strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+	printf("%s.%06u  ", buf, (unsigned int) ((ns % 1000000000) / 1000));
+}
+
+
+/*
+ * Print block state snapshot
+ */
+static void _print_snapshot(const leiodchistblock_t *blk) {
+	int		lepin, i;
+
+
+	_print_time(blk->basens);
+	printf("block %u snapshot:", blk->seq);
+	for (lepin = 1; lepin < lepin_count; lepin++) {
+		if (blk->outputs & (1u << lepin))
+			printf(" %s=%u", _pin_name(lepin), (blk->values >> lepin) & 1);
+		else if (blk->inputs & (1u << lepin))
+			printf(" %s=in", _pin_name(lepin));
+	}
+	for (i = 0; i < LEIODC_UART_COUNT; i++)
+		printf(" COM%u=%s", i + 1, _uart_name(blk->uartint[i]));
+	printf("\n");
+}
+
+
+/*
+ * Decode records of the block
+ * Return -1 if block is corrupted
+ */
+static int _decode_block(const leiodchistblock_t *blk, uint32_t blocksize) {
+	const uint8_t	*rec = (const uint8_t *) (blk + 1);
+	const uint8_t	*end = rec + blk->used;
+	int64_t			ns = blk->basens;
+	uint64_t		delta;
+	uint32_t		runus;
+	uint16_t		toggles;
+	uint8_t			type, arg, lasttype = 0, lastpin = 0;
+	int				shift;
+
+
+	if (blk->used > (blocksize - sizeof(*blk)))
+		return -1;
+
+	while (rec < end) {
+		type = *rec >> 5;
+		arg = *rec++ & 0x1F;
+
+		if (type == LEIODC_HREC_REPEAT) {
+			if ((end - rec) < (sizeof(toggles) + sizeof(runus)))
+				return -1;
+			memcpy(&toggles, rec, sizeof(toggles));
+			memcpy(&runus, rec + sizeof(toggles), sizeof(runus));
+			rec += sizeof(toggles) + sizeof(runus);
+
+			/*
+			 * Time base is the record before the toggles
+			 */
+			ns += (int64_t) runus * 1000;
+			if ((toggles & 1) && (lasttype <= LEIODC_HREC_RISE))
+				lasttype ^= (lasttype >= LEIODC_HREC_FALL) ? (LEIODC_HREC_FALL ^ LEIODC_HREC_RISE) : 1;
+			_print_time(ns);
+			printf("%-16s toggled %u times, last %s\n", _pin_name(lastpin), toggles, levelnames[lasttype]);
+			continue;
+		}
+
+		delta = 0;
+		shift = 0;
+		do {
+			if ((rec >= end) || (shift > 63))
+				return -1;
+			delta |= (uint64_t) (*rec & 0x7F) << shift;
+			shift += 7;
+		} while (*rec++ & 0x80);
+		ns += delta * 1000;
+
+		_print_time(ns);
+		switch (type) {
+		case LEIODC_HREC_LOW:
+		case LEIODC_HREC_HIGH:
+		case LEIODC_HREC_INPUT:
+		case LEIODC_HREC_FALL:
+		case LEIODC_HREC_RISE:
+			printf("%-16s %s\n", _pin_name(arg), levelnames[type]);
+			lasttype = type;
+			lastpin = arg;
+			break;
+
+		case LEIODC_HREC_UART:
+			if (rec >= end)
+				return -1;
+			printf("COM%-13u %s\n", arg + 1, _uart_name(*rec++));
+			break;
+
+		case LEIODC_HREC_EXT:
+			if (rec >= end)
+				return -1;
+			if (arg == LEIODC_HEXT_M2CONFIG)
+				printf("%-16s 0x%02x\n", "M.2 config", *rec);
+			else if (arg == LEIODC_HEXT_BOARDVER)
+				printf("%-16s %u\n", "Board version", *rec);
+			else
+				printf("ext%-13u 0x%02x\n", arg, *rec);
+			rec++;
+			break;
+		}
+	}
+	return 0;
+}
+
+
+/*
+ * Compare block sequence
+ */
+static int _block_cmp(const void *a, const void *b) {
+	uint32_t	seqa = (*(const leiodchistblock_t *const *) a)->seq;
+	uint32_t	seqb = (*(const leiodchistblock_t *const *) b)->seq;
+
+
+	return (seqa > seqb) - (seqa < seqb);
+}
+
+
+int main(int argc, char *argv[]) {
+	const leiodchistblock_t		**order;
+	const leiodchistblock_t		*blk;
+	leiodchistfile_t			*hdr;
+	uint8_t						*data;
+	FILE						*file;
+	long						size;
+	uint32_t					i, valid = 0;
+	int							opt, snapshot = 0, retstat = EXIT_SUCCESS;
+
+
+	while ((opt = getopt(argc, argv, "s")) != -1) {
+		switch (opt) {
+		case 's':
+			snapshot = 1;
+			break;
+
+		default:
+			fprintf(stderr, "Usage: %s [-s] file\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc) {
+		fprintf(stderr, "Usage: %s [-s] file\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!(file = fopen(argv[optind], "rb"))) {
+		fprintf(stderr, "fopen(%s): %s\n", argv[optind], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	rewind(file);
+
+	if ((size < (long) sizeof(*hdr)) || !(data = malloc(size)) || (fread(data, 1, size, file) != size)) {
+		fprintf(stderr, "Can't read %s\n", argv[optind]);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+	fclose(file);
+
+	hdr = (leiodchistfile_t *) data;
+	if ((hdr->magic != LEIODC_HISTORY_MAGIC) || (hdr->version != LEIODC_HISTORY_VERSION) ||
+			(hdr->blocksize < sizeof(leiodchistblock_t)) ||
+			(((uint64_t) hdr->blocks + 1) * hdr->blocksize > (uint64_t) size)) {
+		fprintf(stderr, "%s is not a pin history file (version %u)\n", argv[optind], LEIODC_HISTORY_VERSION);
+		free(data);
+		return EXIT_FAILURE;
+	}
+
+	order = calloc(hdr->blocks, sizeof(*order));
+	for (i = 0; i < hdr->blocks; i++) {
+		blk = (const leiodchistblock_t *) (data + ((i + 1) * hdr->blocksize));
+		if ((blk->magic == LEIODC_HISTORY_BLOCK_MAGIC) && blk->seq)
+			order[valid++] = blk;
+	}
+	qsort(order, valid, sizeof(*order), _block_cmp);
+
+	for (i = 0; i < valid; i++) {
+		if (snapshot || !i)
+			_print_snapshot(order[i]);
+		if (_decode_block(order[i], hdr->blocksize)) {
+			fprintf(stderr, "Block %u is corrupted\n", order[i]->seq);
+			retstat = EXIT_FAILURE;
+		}
+	}
+
+	free(order);
+	free(data);
+	return retstat;
+}
@@ -0,0 +1,317 @@
+/*
+ ============================================================================
+ Name        : leiodcktreplay.c
+ Author      : AK
+ Version     : V1.00
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC kernel call trace replay. Trace captured by the
+               kernel call flight recorder (leiodc_ktrace_dump()) is fed
+               back through the library, normally against gpio-sim chips
+               selected by LEIODC_GPIO_CHIP. Replayed calls are recorded
+               again, recorded and replayed durations per call type are
+               printed as a JSON object.
+
+  Usage: leiodcktreplay [-d] [-f] [-n loops] [-t tty] [-o file] trace
+    -d  Print trace records and exit
+    -f  Replay as fast as possible, recorded call spacing is not kept
+    -n  Number of times the trace is replayed (default 1)
+    -t  tty TIOCSRS485 calls are replayed on, pty is accepted
+    -o  Write trace of the replay to file
+
+  Example with gpio-sim chips linked as /tmp/gpiosim0.../tmp/gpiosim3:
+    LEIODC_GPIO_CHIP=/tmp/gpiosim leiodcktreplay -t /dev/ptmx customer.ktr
+
+  Change log :
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "libleiodchw.h"
+
+
+#define REPLAY_VERSION			"1.00"
+
+
+static const char *const opnames[leiodckt_count] = {
+	[leiodckt_none]			= "none",
+	[leiodckt_get_line]		= "get_line",
+	[leiodckt_set_config]	= "set_config",
+	[leiodckt_edge_config]	= "edge_config",
+	[leiodckt_get_values]	= "get_values",
+	[leiodckt_set_values]	= "set_values",
+	[leiodckt_rs485]		= "rs485",
+	[leiodckt_sysfs_open]	= "sysfs_open",
+	[leiodckt_sysfs_write]	= "sysfs_write",
+};
+
+
+/*
+ * Loaded trace
+ */
+struct trace_s {
+	leiodcktfile_t		hdr;
+	leiodcktrec_t		*recs;
+};
+
+
+static struct {
+	uint64_t			replayed;
+	uint64_t			skipped;
+	uint64_t			failed;
+} glresult;
+
+
+
+
+/*
+ * Load trace file
+ * [18/10/2026]
+ */
+static int _replay_load(const char *path, struct trace_s *trace) {
+	FILE		*file;
+
+
+	if (!(file = fopen(path, "rb"))) {
+		fprintf(stderr, "fopen(%s): %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if ((fread(&trace->hdr, sizeof(trace->hdr), 1, file) != 1) ||
+			(trace->hdr.magic != LEIODC_KTRACE_MAGIC) || (trace->hdr.version != LEIODC_KTRACE_VERSION) ||
+			(trace->hdr.recsize != sizeof(leiodcktrec_t))) {
+		fprintf(stderr, "%s is not a kernel call trace (version %u)\n", path, LEIODC_KTRACE_VERSION);
+		fclose(file);
+		return -1;
+	}
+
+	if (!(trace->recs = calloc(trace->hdr.count + 1, sizeof(*trace->recs))) ||
+			(fread(trace->recs, sizeof(*trace->recs), trace->hdr.count, file) != trace->hdr.count)) {
+		fprintf(stderr, "Can't read %u records of %s\n", trace->hdr.count, path);
+		fclose(file);
+		return -1;
+	}
+	fclose(file);
+	return 0;
+}
+
+
+/*
+ * Print trace records
+ * [18/10/2026]
+ */
+static void _replay_print(const struct trace_s *trace) {
+	const leiodcktrec_t		*rec;
+	uint32_t				i;
+
+
+	printf("# %u records, %llu lost\n", trace->hdr.count, (unsigned long long) trace->hdr.lost);
+	for (i = 0; i < trace->hdr.count; i++) {
+		rec = &trace->recs[i];
+		printf("%llu.%09llu %-12s pins %2u-%-2u ret %-4d %6u ns  0x%08x 0x%08x 0x%08x 0x%08x %.*s\n",
+				(unsigned long long) (rec->start / 1000000000), (unsigned long long) (rec->start % 1000000000),
+				(rec->op < leiodckt_count) ? opnames[rec->op] : "unknown", rec->minp, rec->maxp, rec->ret,
+				rec->elapsed, rec->arg[0], rec->arg[1], rec->arg[2], rec->arg[3],
+				(int) sizeof(rec->payload), rec->payload);
+	}
+}
+
+
+/*
+ * Monotonic time (ns)
+ * [18/10/2026]
+ */
+static uint64_t _replay_now(void) {
+	struct timespec		ts;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+
+/*
+ * Replay trace once, call spacing of the trace is kept unless fast
+ * [18/10/2026]
+ */
+static void _replay_run(const struct trace_s *trace, int ttyfd, int fast) {
+	const leiodcktrec_t		*rec;
+	struct timespec			deadline;
+	uint64_t				base = _replay_now(), due;
+	uint32_t				i;
+
+
+	for (i = 0; i < trace->hdr.count; i++) {
+		rec = &trace->recs[i];
+		if (!fast) {
+			due = base + (rec->start - trace->recs[0].start);
+			deadline.tv_sec = due / 1000000000;
+			deadline.tv_nsec = due % 1000000000;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+		}
+
+		switch (leiodc_ktrace_replay(rec, ttyfd)) {
+		case 0:
+			glresult.replayed++;
+			break;
+
+		case 1:
+			glresult.skipped++;
+			break;
+
+		default:
+			if (!glresult.failed++)
+				fprintf(stderr, "Record %u %s failed: %s\n", i, opnames[rec->op], LibErrorString);
+			break;
+		}
+	}
+}
+
+
+/*
+ * Compare durations
+ * [18/10/2026]
+ */
+static int _replay_cmp(const void *a, const void *b) {
+	uint32_t	ea = *(const uint32_t *) a;
+	uint32_t	eb = *(const uint32_t *) b;
+
+
+	return (ea > eb) - (ea < eb);
+}
+
+
+/*
+ * Print duration statistics of the call type
+ * [18/10/2026]
+ */
+static void _replay_stats_print(const char *name, const struct trace_s *trace, leiodcktop_e op, int last) {
+	uint32_t	*elapsed, cnt = 0, i;
+	uint64_t	sum = 0;
+
+
+	elapsed = calloc(trace->hdr.count + 1, sizeof(*elapsed));
+	for (i = 0; i < trace->hdr.count; i++) {
+		if (trace->recs[i].op == op) {
+			elapsed[cnt++] = trace->recs[i].elapsed;
+			sum += trace->recs[i].elapsed;
+		}
+	}
+	qsort(elapsed, cnt, sizeof(*elapsed), _replay_cmp);
+
+	printf("\"%s\": {\"calls\": %u, \"avg_ns\": %llu, \"p50_ns\": %u, \"p99_ns\": %u, \"max_ns\": %u}%s",
+			name, cnt, (unsigned long long) ((cnt) ? (sum / cnt) : 0),
+			(cnt) ? elapsed[cnt / 2] : 0, (cnt) ? elapsed[(cnt * 99) / 100] : 0, (cnt) ? elapsed[cnt - 1] : 0,
+			(last) ? "" : ", ");
+	free(elapsed);
+}
+
+
+int main(int argc, char *argv[]) {
+	struct trace_s			trace, replay;
+	leiodcktracecfg_t		ktracecfg;
+	const char				*outpath = NULL, *ttypath = NULL;
+	char					tmppath[64];
+	uint64_t				start, elapsed;
+	uint32_t				loops = 1, i;
+	int						opt, print = 0, fast = 0, ttyfd = 0, op;
+
+
+	while ((opt = getopt(argc, argv, "dfn:t:o:")) != -1) {
+		switch (opt) {
+		case 'd':
+			print = 1;
+			break;
+		case 'f':
+			fast = 1;
+			break;
+		case 'n':
+			loops = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			ttypath = optarg;
+			break;
+		case 'o':
+			outpath = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-d] [-f] [-n loops] [-t tty] [-o file] trace\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((optind >= argc) || !loops) {
+		fprintf(stderr, "Usage: %s [-d] [-f] [-n loops] [-t tty] [-o file] trace\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (_replay_load(argv[optind], &trace))
+		return EXIT_FAILURE;
+
+	if (print) {
+		_replay_print(&trace);
+		free(trace.recs);
+		return EXIT_SUCCESS;
+	}
+
+	if (ttypath && ((ttyfd = open(ttypath, O_RDWR | O_NOCTTY)) < 0)) {
+		fprintf(stderr, "open(%s): %s\n", ttypath, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	memset(&ktracecfg, 0, sizeof(ktracecfg));
+	ktracecfg.ringsize = (trace.hdr.count * loops * 2) + 64;	// Replayed writes record open too
+	if (leiodc_ktrace_start(&ktracecfg)) {
+		fprintf(stderr, "%s\n", LibErrorString);
+		return EXIT_FAILURE;
+	}
+
+	start = _replay_now();
+	for (i = 0; i < loops; i++)
+		_replay_run(&trace, ttyfd, fast);
+	elapsed = _replay_now() - start;
+	leiodc_ktrace_stop();
+
+	if (!outpath) {
+		snprintf(tmppath, sizeof(tmppath), "/tmp/leiodcktreplay.%d.ktr", (int) getpid());
+		outpath = tmppath;
+	}
+	if ((leiodc_ktrace_dump(outpath) < 0) || _replay_load(outpath, &replay)) {
+		fprintf(stderr, "%s\n", LibErrorString);
+		return EXIT_FAILURE;
+	}
+	if (outpath == tmppath)
+		unlink(tmppath);
+
+	printf("{\n  \"tool\": \"leiodcktreplay\", \"version\": \"%s\",\n"
+			"  \"records\": %u, \"lost\": %llu, \"loops\": %u, \"fast\": %s,\n"
+			"  \"replayed\": %llu, \"skipped\": %llu, \"failed\": %llu, \"elapsed_ns\": %llu,\n"
+			"  \"calls\": {\n",
+			REPLAY_VERSION, trace.hdr.count, (unsigned long long) trace.hdr.lost, loops, (fast) ? "true" : "false",
+			(unsigned long long) glresult.replayed, (unsigned long long) glresult.skipped,
+			(unsigned long long) glresult.failed, (unsigned long long) elapsed);
+	for (op = leiodckt_get_line; op < leiodckt_count; op++) {
+		printf("    \"%s\": {", opnames[op]);
+		_replay_stats_print("recorded", &trace, op, 0);
+		_replay_stats_print("replayed", &replay, op, 1);
+		printf("}%s\n", (op == (leiodckt_count - 1)) ? "" : ",");
+	}
+	printf("  }\n}\n");
+
+	if (ttyfd > 0)
+		close(ttyfd);
+	free(trace.recs);
+	free(replay.recs);
+	return (glresult.failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,324 @@
+/*
+ ============================================================================
+ Name        : leiodcrs485test.c
+ Author      : AK
+ Version     : V1.00
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC RS485 userspace direction control test. Pseudo-terminal
+               stands in for the UART, frames are written by
+               leiodc_rs485_sw_write() and received on the master side.
+               TX enable line is followed in the pin state mirror, it must
+               be raised before the first byte is received, kept raised
+               for the frame time and released after every frame.
+               Results are printed as a JSON object.
+
+  Usage: leiodcrs485test [-u uartno] [-m interface] [-b baud] [-s frame size] [-n frames]
+    -u  UART number 0...2 (default 0)
+    -m  RS485 interface mode leuart_RS485def or leuart_RS485rev (default 2)
+    -b  Baud rate set on the pty, frame time is derived from it (default 9600)
+    -s  Frame size in bytes (default 32)
+    -n  Number of frames (default 10)
+
+  Example with gpio-sim chips linked as /tmp/gpiosim0.../tmp/gpiosim3:
+    LEIODC_GPIO_CHIP=/tmp/gpiosim leiodcrs485test -b 19200 -n 100
+
+  Change log :
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+
+#include "libleiodchw.h"
+
+
+#define RS485TEST_VERSION		"1.00"
+#define RS485TEST_TIMEOUT_MS	1000			// Frame is considered lost
+#define RS485TEST_CHAR_BITS		10				// 8N1
+
+
+static struct {
+	uint8_t				uartno;
+	uint8_t				interface;
+	uint32_t			baud;
+	uint32_t			size;
+	uint32_t			frames;
+} glcfg = {
+	.uartno = 0,
+	.interface = leuart_RS485def,
+	.baud = 9600,
+	.size = 32,
+	.frames = 10,
+};
+
+
+/*
+ * TX enable line followed by the observer thread
+ */
+static struct {
+	leiodcpin			txpin;
+	uint32_t			stop;
+	uint32_t			value;			// Value seen last
+	uint32_t			transitions;
+	uint64_t			onns;			// State update time of the last raise
+	uint64_t			offns;			// State update time of the last release
+} globs;
+
+
+/*
+ * Results
+ */
+static struct {
+	uint32_t			frames;			// Frames passed all checks
+	uint32_t			writefail;
+	uint32_t			timeout;		// Frame not received on the master side
+	uint32_t			late;			// TX enable raised after the first byte was received
+	uint32_t			shortheld;		// TX enable released before the frame time elapsed
+	uint32_t			toggles;		// TX enable not raised and released exactly once
+	uint64_t			heldmax;		// Longest TX enable time (ns)
+} glres;
+
+
+
+
+/*
+ * Monotonic time (ns)
+ * [18/10/2026]
+ */
+static uint64_t _rs485test_now(void) {
+	struct timespec	now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+
+/*
+ * Follow TX enable line in the pin state mirror
+ * [18/10/2026]
+ */
+static void *_rs485test_observe(void *arg) {
+	leiodcstate_t	state;
+	uint32_t		value;
+
+
+	while (!__atomic_load_n(&globs.stop, __ATOMIC_ACQUIRE)) {
+		if (leiodc_state_read(&state))
+			continue;
+
+		value = state.pins[globs.txpin].value;
+		if ((value == LEIODC_STATE_UNKNOWN) || (value == __atomic_load_n(&globs.value, __ATOMIC_RELAXED)))
+			continue;
+
+		if (value)
+			__atomic_store_n(&globs.onns, state.updatens, __ATOMIC_RELAXED);
+		else
+			__atomic_store_n(&globs.offns, state.updatens, __ATOMIC_RELAXED);
+		__atomic_store_n(&globs.value, value, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&globs.transitions, 1, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+
+/*
+ * Receive frame on the master side
+ * Return time the first byte was received (ns) or 0 on timeout
+ * [18/10/2026]
+ */
+static uint64_t _rs485test_receive(int master) {
+	struct pollfd	pfd = {.fd = master, .events = POLLIN};
+	uint8_t			buf[256];
+	uint64_t		firstns = 0;
+	uint32_t		received = 0;
+	ssize_t			rlen;
+
+
+	while (received < glcfg.size) {
+		if (poll(&pfd, 1, RS485TEST_TIMEOUT_MS) <= 0)
+			return 0;
+		if ((rlen = read(master, buf, sizeof(buf))) <= 0)
+			return 0;
+		if (!firstns)
+			firstns = _rs485test_now();
+		received += rlen;
+	}
+	return firstns;
+}
+
+
+/*
+ * Wait until the observer has seen the expected number of transitions
+ * Return 0 if seen in time
+ * [18/10/2026]
+ */
+static int _rs485test_transitions_wait(uint32_t expected) {
+	uint64_t	deadline = _rs485test_now() + (RS485TEST_TIMEOUT_MS * 1000000ULL);
+
+
+	while (__atomic_load_n(&globs.transitions, __ATOMIC_ACQUIRE) < expected) {
+		if (_rs485test_now() > deadline)
+			return -1;
+		usleep(100);
+	}
+	return (__atomic_load_n(&globs.transitions, __ATOMIC_ACQUIRE) == expected) ? 0 : -1;
+}
+
+
+int main(int argc, char *argv[]) {
+	static const leiodcpin	txpins[LEIODC_UART_COUNT][2] = {
+			{lepin_COM1_RS422_TX1, lepin_COM1_RS422_TX2},
+			{lepin_COM2_RS422_TX1, lepin_COM2_RS422_TX2},
+			{lepin_COM3_RS422_TX1, lepin_COM3_RS422_TX2},
+	};
+	leiodcserialcfg_t	sercfg;
+	leiodcrs485stats_t	stats;
+	leiodcstate_t		state;
+	pthread_t			observer;
+	uint64_t			framens, firstns, heldns;
+	uint32_t			i, transitions;
+	uint8_t				*frame;
+	int					opt, master, slave, failed;
+
+
+	while ((opt = getopt(argc, argv, "u:m:b:s:n:")) != -1) {
+		switch (opt) {
+		case 'u':
+			glcfg.uartno = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			glcfg.interface = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			glcfg.baud = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			glcfg.size = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			glcfg.frames = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-u uartno] [-m interface] [-b baud] [-s frame size] [-n frames]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((glcfg.uartno >= LEIODC_UART_COUNT) || !glcfg.baud || (glcfg.size < 2) || !glcfg.frames ||
+			((glcfg.interface != leuart_RS485def) && (glcfg.interface != leuart_RS485rev))) {
+		fprintf(stderr, "Invalid arguments, uartno 0...%u, interface %u or %u, frame size 2 or more\n",
+				LEIODC_UART_COUNT - 1, leuart_RS485def, leuart_RS485rev);
+		return EXIT_FAILURE;
+	}
+	globs.txpin = txpins[glcfg.uartno][glcfg.interface == leuart_RS485rev];
+	framens = ((uint64_t) (glcfg.size - 1) * RS485TEST_CHAR_BITS * 1000000000ULL) / glcfg.baud;
+
+	if (((master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0) ||
+			grantpt(master) || unlockpt(master)) {
+		perror("posix_openpt()");
+		return EXIT_FAILURE;
+	}
+
+	if ((slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0) {
+		perror(ptsname(master));
+		return EXIT_FAILURE;
+	}
+
+	memset(&sercfg, 0, sizeof(sercfg));
+	sercfg.baud = glcfg.baud;
+	sercfg.parity = 'N';
+	sercfg.databits = 8;
+	sercfg.stopbits = 1;
+	sercfg.interface = glcfg.interface;
+	if (leiodc_serial_config(glcfg.uartno, slave, &sercfg) ||
+			leiodc_rs485_sw_enable(glcfg.uartno, glcfg.interface, slave)) {
+		fprintf(stderr, "%s\n", LibErrorString);
+		fprintf(stderr, "GPIO chip can be set with LEIODC_GPIO_CHIP\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!(frame = malloc(glcfg.size))) {
+		perror("malloc()");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < glcfg.size; i++)
+		frame[i] = i;
+
+	pthread_create(&observer, NULL, _rs485test_observe, NULL);
+
+	for (i = 0; i < glcfg.frames; i++) {
+		transitions = __atomic_load_n(&globs.transitions, __ATOMIC_ACQUIRE);
+
+		if (leiodc_rs485_sw_write(glcfg.uartno, frame, glcfg.size) != glcfg.size) {
+			fprintf(stderr, "%s\n", LibErrorString);
+			glres.writefail++;
+			continue;
+		}
+
+		if (!(firstns = _rs485test_receive(master))) {
+			glres.timeout++;
+			continue;
+		}
+
+		if (_rs485test_transitions_wait(transitions + 2) || __atomic_load_n(&globs.value, __ATOMIC_RELAXED)) {
+			glres.toggles++;
+			continue;
+		}
+
+		failed = 0;
+		if (globs.onns > firstns) {
+			glres.late++;
+			failed = 1;
+		}
+
+		heldns = globs.offns - globs.onns;
+		if (heldns > glres.heldmax)
+			glres.heldmax = heldns;
+		if (heldns < framens) {
+			glres.shortheld++;
+			failed = 1;
+		}
+
+		if (!failed)
+			glres.frames++;
+	}
+
+	__atomic_store_n(&globs.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(observer, NULL);
+
+	leiodc_rs485_sw_stats_get(glcfg.uartno, &stats);
+	if (leiodc_rs485_sw_disable(glcfg.uartno))
+		fprintf(stderr, "%s\n", LibErrorString);
+	leiodc_state_read(&state);
+
+	failed = (glres.frames != glcfg.frames) || state.pins[globs.txpin].value;
+	printf("{\n  \"tool\": \"leiodcrs485test\", \"version\": \"%s\",\n"
+			"  \"uartno\": %u, \"interface\": %u, \"txpin\": %u, \"baud\": %u, \"size\": %u, \"frames\": %u,\n"
+			"  \"passed_frames\": %u, \"write_failed\": %u, \"timeout\": %u, \"raised_late\": %u,\n"
+			"  \"released_early\": %u, \"toggle_mismatch\": %u, \"frame_ns\": %llu, \"held_max_ns\": %llu,\n"
+			"  \"turn_max_ns\": %llu, \"released_after_disable\": %s, \"passed\": %s\n}\n",
+			RS485TEST_VERSION, glcfg.uartno, glcfg.interface, globs.txpin, glcfg.baud, glcfg.size, glcfg.frames,
+			glres.frames, glres.writefail, glres.timeout, glres.late,
+			glres.shortheld, glres.toggles, (unsigned long long) framens, (unsigned long long) glres.heldmax,
+			(unsigned long long) stats.turnmax, (state.pins[globs.txpin].value) ? "false" : "true",
+			(failed) ? "false" : "true");
+
+	free(frame);
+	close(slave);
+	close(master);
+	return (failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
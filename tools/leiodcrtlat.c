@@ -0,0 +1,232 @@
+/*
+ ============================================================================
+ Name        : leiodcrtlat.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC real-time latency test. Deterministic real-time mode
+               is started, the test thread runs under SCHED_FIFO and calls
+               the selected API function in a loop. Duration of every call
+               is collected in a preallocated histogram, latency
+               percentiles, worst case and page faults / context switches
+               during the loop are printed as a JSON object.
+
+  Usage: leiodcrtlat [-n calls] [-p priority] [-c cpu] [-l lepin] [-u uartno] [-t tty] [-m]
+    -n  Number of measured calls (default 1000000)
+    -p  SCHED_FIFO priority (default 80), 0 - scheduling is not changed
+    -c  CPU the test thread is pinned to (default not pinned)
+    -l  Pin toggled by leiodc_pin_state_set() (default heartbeat)
+    -u  Alternate UART interface RS232/RS485 with leiodc_uart_int() instead
+    -t  tty passed to leiodc_uart_int(), RS485 setup is measured too,
+        pty is accepted (e.g. /dev/ptmx)
+    -m  Don't lock memory (LEIODC_RT_NO_MLOCK)
+
+  Example with gpio-sim chips linked as /tmp/gpiosim0.../tmp/gpiosim3:
+    LEIODC_GPIO_CHIP=/tmp/gpiosim leiodcrtlat -n 5000000 -c 1
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  tty option, RS485 setup of leiodc_uart_int() is measured
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "libleiodchw.h"
+
+
+#define RTLAT_VERSION			"1.01"
+#define RTLAT_WARMUP			1000			// Calls not measured
+#define RTLAT_BINS				100000			// 100 ns bins up to 10 ms
+#define RTLAT_BIN_NS			100
+
+
+/*
+ * Histogram is static, nothing is allocated in the measured loop
+ */
+static uint64_t glhist[RTLAT_BINS + 1];
+
+
+/*
+ * Monotonic time (ns)
+ * [18/10/2026]
+ */
+static inline uint64_t _rtlat_now(void) {
+	struct timespec		ts;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+
+/*
+ * Call under test
+ * [18/10/2026]
+ */
+static inline int _rtlat_call(uint32_t i, leiodcpin lepin, int uartno, const fddef *ttyfd) {
+
+	if (uartno >= 0)
+		return leiodc_uart_int(uartno, (i & 1) ? leuart_RS485def : leuart_RS232, ttyfd);
+	return leiodc_pin_state_set(lepin, i & 1);
+}
+
+
+/*
+ * Latency below which the given share of calls completed (ns)
+ * [18/10/2026]
+ */
+static uint64_t _rtlat_percentile(uint64_t calls, double share) {
+	uint64_t	target = (uint64_t) (calls * share), sum = 0;
+	uint32_t	bin;
+
+
+	for (bin = 0; bin <= RTLAT_BINS; bin++) {
+		sum += glhist[bin];
+		if (sum > target)
+			break;
+	}
+	return (uint64_t) (bin + 1) * RTLAT_BIN_NS;
+}
+
+
+int main(int argc, char *argv[]) {
+	leiodcrtcfg_t		rtcfg;
+	struct sched_param	sparam;
+	struct rusage		rubefore, ruafter;
+	cpu_set_t			cpuset;
+	uint64_t			calls = 1000000, failed = 0, sum = 0, min = UINT64_MAX, max = 0, maxat = 0;
+	uint64_t			start, elapsed, i;
+	leiodcpin			lepin = lepin_heartbeat;
+	const char			*ttypath = NULL;
+	fddef				ttyfd = 0;
+	int					opt, priority = 80, cpu = -1, uartno = -1;
+
+
+	memset(&rtcfg, 0, sizeof(rtcfg));
+	while ((opt = getopt(argc, argv, "n:p:c:l:u:t:m")) != -1) {
+		switch (opt) {
+		case 'n':
+			calls = strtoull(optarg, NULL, 0);
+			break;
+		case 'p':
+			priority = atoi(optarg);
+			break;
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'l':
+			lepin = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			uartno = atoi(optarg);
+			break;
+		case 't':
+			ttypath = optarg;
+			break;
+		case 'm':
+			rtcfg.flags |= LEIODC_RT_NO_MLOCK;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n calls] [-p priority] [-c cpu] [-l lepin] [-u uartno] [-t tty] [-m]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!calls || (uartno > 2) || (lepin >= lepin_count) || (ttypath && (uartno < 0))) {
+		fprintf(stderr, "Usage: %s [-n calls] [-p priority] [-c cpu] [-l lepin] [-u uartno] [-t tty] [-m]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (ttypath && ((ttyfd = open(ttypath, O_RDWR | O_NOCTTY)) < 0)) {
+		fprintf(stderr, "open(%s): %s\n", ttypath, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	if (cpu >= 0) {
+		CPU_ZERO(&cpuset);
+		CPU_SET(cpu, &cpuset);
+		if (sched_setaffinity(0, sizeof(cpuset), &cpuset)) {
+			fprintf(stderr, "sched_setaffinity(%d): %s\n", cpu, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (leiodc_rt_start(&rtcfg)) {
+		fprintf(stderr, "%s\n", LibErrorString);
+		return EXIT_FAILURE;
+	}
+
+	if (priority) {
+		memset(&sparam, 0, sizeof(sparam));
+		sparam.sched_priority = priority;
+		if (sched_setscheduler(0, SCHED_FIFO, &sparam)) {
+			fprintf(stderr, "sched_setscheduler(SCHED_FIFO, %d): %s\n", priority, strerror(errno));
+			leiodc_rt_stop();
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (i = 0; i < RTLAT_WARMUP; i++)
+		_rtlat_call(i, lepin, uartno, (ttyfd) ? &ttyfd : NULL);
+
+	getrusage(RUSAGE_SELF, &rubefore);
+	for (i = 0; i < calls; i++) {
+		start = _rtlat_now();
+		if (_rtlat_call(i, lepin, uartno, (ttyfd) ? &ttyfd : NULL))
+			failed++;
+		elapsed = _rtlat_now() - start;
+
+		sum += elapsed;
+		if (elapsed < min)
+			min = elapsed;
+		if (elapsed > max) {
+			max = elapsed;
+			maxat = i;
+		}
+		glhist[(elapsed / RTLAT_BIN_NS < RTLAT_BINS) ? (elapsed / RTLAT_BIN_NS) : RTLAT_BINS]++;
+	}
+	getrusage(RUSAGE_SELF, &ruafter);
+
+	if (priority) {
+		sparam.sched_priority = 0;
+		sched_setscheduler(0, SCHED_OTHER, &sparam);
+	}
+	leiodc_rt_stop();
+
+	printf("{\n  \"tool\": \"leiodcrtlat\", \"version\": \"%s\",\n"
+			"  \"call\": \"%s\", \"tty\": \"%s\", \"calls\": %llu, \"failed\": %llu, \"priority\": %d, \"cpu\": %d, \"mlock\": %s,\n"
+			"  \"min_ns\": %llu, \"avg_ns\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p9999_ns\": %llu,\n"
+			"  \"max_ns\": %llu, \"max_call\": %llu, \"over_10ms\": %llu,\n"
+			"  \"minor_faults\": %ld, \"major_faults\": %ld, \"involuntary_switches\": %ld\n}\n",
+			RTLAT_VERSION, (uartno >= 0) ? "leiodc_uart_int" : "leiodc_pin_state_set", (ttypath) ? ttypath : "",
+			(unsigned long long) calls, (unsigned long long) failed, priority, cpu,
+			(rtcfg.flags & LEIODC_RT_NO_MLOCK) ? "false" : "true",
+			(unsigned long long) min, (unsigned long long) (sum / calls),
+			(unsigned long long) _rtlat_percentile(calls, 0.5), (unsigned long long) _rtlat_percentile(calls, 0.99),
+			(unsigned long long) _rtlat_percentile(calls, 0.9999),
+			(unsigned long long) max, (unsigned long long) maxat, (unsigned long long) glhist[RTLAT_BINS],
+			ruafter.ru_minflt - rubefore.ru_minflt, ruafter.ru_majflt - rubefore.ru_majflt,
+			ruafter.ru_nivcsw - rubefore.ru_nivcsw);
+
+	if (ttyfd > 0)
+		close(ttyfd);
+	if (failed)
+		fprintf(stderr, "%llu calls failed, last error: %s\n", (unsigned long long) failed, LibErrorString);
+	return (failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,415 @@
+/*
+ ============================================================================
+ Name        : leiodcserbench.c
+ Author      : AK
+ Version     : V1.01
+ Copyright   : Property of Londelec UK Ltd
+ Description : LEIODC serial benchmark. Pseudo-terminal pairs stand in
+               for COM1...COM3, the slave side is configured by
+               leiodc_serial_config() and serviced by the serial I/O engine,
+               the master side echoes everything back. Frames are sent
+               on all ports concurrently, throughput, frame round-trip
+               time and CPU time per frame are printed as a JSON object.
+
+  Usage: leiodcserbench [-p ports] [-b baud] [-s frame size] [-n frames]
+                        [-w window] [-m interface]
+    -p  Number of ports 1...3 (default 3)
+    -b  Baud rate set on the pty (default 115200), pty is not throttled
+    -s  Frame size in bytes (default 64)
+    -n  Frames per port (default 10000)
+    -w  Frames in flight per port (default 1)
+    -m  Interface mode (leuart_xxx) applied by the serial port setup,
+        RS485 ioctls are skipped on ptys, control lines require GPIO
+        access (default 2 - RS485), 0 - interface is not set up
+
+  Example with gpio-sim chips linked as /tmp/gpiosim0.../tmp/gpiosim3:
+    LEIODC_GPIO_CHIP=/tmp/gpiosim leiodcserbench -n 100000 -w 8
+  Without GPIO access:
+    leiodcserbench -m 0
+
+  Change log :
+
+  *********V1.01 18/10/2026**************
+  RS485 interface mode by default, setup path of production ports is measured
+
+  *********V1.00 18/10/2026**************
+  Initial revision
+
+ ============================================================================
+ */
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include "libleiodchw.h"
+
+
+#define BENCH_VERSION			"1.01"
+#define BENCH_TIMEOUT_MS		1000			// Echo is considered lost
+#define BENCH_WINDOW_MAX		64
+
+
+/*
+ * Benchmarked port
+ */
+struct benchport_s {
+	uint8_t				uartno;
+	int					master;			// pty master, echo side
+	int					slave;			// pty slave, serviced by the library
+	int					notifyfd;		// eventfd, written by the RX callback
+	pthread_t			echothread;
+	pthread_t			workthread;
+	uint64_t			*rtt;			// Round-trip time of each frame (ns)
+	uint64_t			frames;			// Frames echoed back
+	uint64_t			errors;			// Corrupted bytes
+	uint64_t			rxbytes;
+	uint64_t			txbytes;
+	uint64_t			elapsedns;
+	int					timeout;
+	leiodcsiostats_t	siostats;
+};
+
+
+static struct {
+	uint32_t			ports;
+	uint32_t			baud;
+	uint32_t			size;
+	uint32_t			frames;
+	uint32_t			window;
+	uint8_t				interface;
+} glcfg = {
+	.ports = LEIODC_UART_COUNT,
+	.baud = 115200,
+	.size = 64,
+	.frames = 10000,
+	.window = 1,
+	.interface = leuart_RS485def,
+};
+
+static struct benchport_s glports[LEIODC_UART_COUNT];
+
+
+
+
+/*
+ * Monotonic time (ns)
+ * [18/10/2026]
+ */
+static uint64_t _bench_now(void) {
+	struct timespec	now;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+
+/*
+ * Process CPU time (ns), includes echo threads and the library event thread
+ * [18/10/2026]
+ */
+static uint64_t _bench_cpu(void) {
+	struct rusage	usage;
+
+
+	getrusage(RUSAGE_SELF, &usage);
+	return (((uint64_t) usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL) +
+			(((uint64_t) usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000);
+}
+
+
+/*
+ * Expected value of the byte at the stream offset
+ * [18/10/2026]
+ */
+static uint8_t _bench_pattern(uint64_t offset) {
+
+	return (uint8_t) ((offset / glcfg.size) + (offset % glcfg.size));
+}
+
+
+/*
+ * RX callback, executed by the library event thread
+ * [18/10/2026]
+ */
+static void _bench_rx_cb(uint8_t uartno, void *arg) {
+	struct benchport_s	*port = arg;
+	uint64_t			notify = 1;
+
+
+	if (write(port->notifyfd, &notify, sizeof(notify)) < 0) {}
+}
+
+
+/*
+ * Master side, echo everything back until the slave is closed
+ * [18/10/2026]
+ */
+static void *_bench_echo(void *arg) {
+	struct benchport_s	*port = arg;
+	uint8_t				buf[4096];
+	ssize_t				rlen, wlen, offset;
+
+
+	while ((rlen = read(port->master, buf, sizeof(buf))) > 0) {
+		for (offset = 0; offset < rlen; offset += wlen) {
+			if ((wlen = write(port->master, &buf[offset], rlen - offset)) < 0)
+				return NULL;
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Send frames keeping up to window frames in flight, match echoed frames
+ * [18/10/2026]
+ */
+static void *_bench_work(void *arg) {
+	struct benchport_s	*port = arg;
+	struct pollfd		pfd = {.fd = port->notifyfd, .events = POLLIN};
+	uint64_t			sendts[BENCH_WINDOW_MAX];
+	uint64_t			sent = 0, notify, start, now;
+	uint8_t				*frame, buf[4096];
+	uint32_t			i;
+	int					rlen;
+
+
+	if (!(frame = malloc(glcfg.size)))
+		return NULL;
+
+	start = _bench_now();
+	while (port->frames < glcfg.frames) {
+		while ((sent < glcfg.frames) && ((sent - port->frames) < glcfg.window)) {
+			for (i = 0; i < glcfg.size; i++)
+				frame[i] = _bench_pattern((sent * glcfg.size) + i);
+
+			sendts[sent % glcfg.window] = _bench_now();
+			if (leiodc_sio_write(port->uartno, frame, glcfg.size) < 0)
+				break;		// TX ring full, wait for echo
+			port->txbytes += glcfg.size;
+			sent++;
+		}
+
+		if (poll(&pfd, 1, BENCH_TIMEOUT_MS) <= 0) {
+			port->timeout = 1;
+			break;
+		}
+		if (read(port->notifyfd, &notify, sizeof(notify)) < 0) {}
+
+		while ((rlen = leiodc_sio_read(port->uartno, buf, sizeof(buf))) > 0) {
+			now = _bench_now();
+			for (i = 0; i < rlen; i++) {
+				if (buf[i] != _bench_pattern(port->rxbytes + i))
+					port->errors++;
+			}
+			port->rxbytes += rlen;
+
+			while ((port->frames < sent) && (port->rxbytes >= ((port->frames + 1) * glcfg.size))) {
+				port->rtt[port->frames] = now - sendts[port->frames % glcfg.window];
+				port->frames++;
+			}
+		}
+	}
+	port->elapsedns = _bench_now() - start;
+	free(frame);
+	return NULL;
+}
+
+
+/*
+ * Create pty pair and configure the slave as a COM port
+ * Return -1 on error
+ * [18/10/2026]
+ */
+static int _bench_port_open(struct benchport_s *port) {
+	leiodcserialcfg_t	sercfg;
+	leiodcsiocfg_t		siocfg;
+
+
+	if (((port->master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0) ||
+			grantpt(port->master) || unlockpt(port->master)) {
+		perror("posix_openpt()");
+		return -1;
+	}
+
+	if ((port->slave = open(ptsname(port->master), O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0) {
+		perror(ptsname(port->master));
+		return -1;
+	}
+
+	if ((port->notifyfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		perror("eventfd()");
+		return -1;
+	}
+
+	if (!(port->rtt = calloc(glcfg.frames, sizeof(*port->rtt)))) {
+		perror("calloc()");
+		return -1;
+	}
+
+	memset(&sercfg, 0, sizeof(sercfg));
+	sercfg.baud = glcfg.baud;
+	sercfg.parity = 'N';
+	sercfg.databits = 8;
+	sercfg.stopbits = 1;
+	sercfg.interface = glcfg.interface;
+	if (leiodc_serial_config(port->uartno, port->slave, &sercfg)) {
+		fprintf(stderr, "%s\n", LibErrorString);
+		if (glcfg.interface)
+			fprintf(stderr, "GPIO chip can be set with LEIODC_GPIO_CHIP, -m 0 skips interface setup\n");
+		return -1;
+	}
+
+	memset(&siocfg, 0, sizeof(siocfg));
+	siocfg.rxsize = glcfg.size * glcfg.window * 2;
+	siocfg.txsize = glcfg.size * glcfg.window * 2;
+	siocfg.rxcallback = _bench_rx_cb;
+	siocfg.arg = port;
+	if (leiodc_sio_port_add(port->uartno, port->slave, &siocfg)) {
+		fprintf(stderr, "%s\n", LibErrorString);
+		return -1;
+	}
+	return 0;
+}
+
+
+/*
+ * Sort compare of RTT values
+ * [18/10/2026]
+ */
+static int _bench_rtt_cmp(const void *a, const void *b) {
+	uint64_t	ra = *(const uint64_t *) a;
+	uint64_t	rb = *(const uint64_t *) b;
+
+
+	return (ra > rb) - (ra < rb);
+}
+
+
+/*
+ * Print port results
+ * [18/10/2026]
+ */
+static void _bench_port_print(struct benchport_s *port, int last) {
+	uint64_t	rttsum = 0, i, cnt = port->frames;
+
+
+	qsort(port->rtt, cnt, sizeof(*port->rtt), _bench_rtt_cmp);
+	for (i = 0; i < cnt; i++)
+		rttsum += port->rtt[i];
+
+	printf("    {\"com\": %u, \"frames\": %llu, \"errors\": %llu, \"timeout\": %d, "
+			"\"elapsed_ns\": %llu, \"bytes_per_s\": %.0f, "
+			"\"rtt_min_ns\": %llu, \"rtt_avg_ns\": %llu, \"rtt_p50_ns\": %llu, "
+			"\"rtt_p99_ns\": %llu, \"rtt_max_ns\": %llu, "
+			"\"readv\": %llu, \"writev\": %llu, \"rxoverrun\": %llu}%s\n",
+			port->uartno + 1, (unsigned long long) cnt, (unsigned long long) port->errors, port->timeout,
+			(unsigned long long) port->elapsedns,
+			(port->elapsedns) ? ((double) (port->rxbytes + port->txbytes) * 1e9 / port->elapsedns) : 0.0,
+			(unsigned long long) ((cnt) ? port->rtt[0] : 0),
+			(unsigned long long) ((cnt) ? (rttsum / cnt) : 0),
+			(unsigned long long) ((cnt) ? port->rtt[cnt / 2] : 0),
+			(unsigned long long) ((cnt) ? port->rtt[(cnt * 99) / 100] : 0),
+			(unsigned long long) ((cnt) ? port->rtt[cnt - 1] : 0),
+			(unsigned long long) port->siostats.reads, (unsigned long long) port->siostats.writes,
+			(unsigned long long) port->siostats.rxoverrun,
+			(last) ? "" : ",");
+}
+
+
+int main(int argc, char *argv[]) {
+	uint64_t	start, elapsed, cpu, bytes = 0, frames = 0;
+	uint32_t	i;
+	int			opt, failed = 0;
+
+
+	while ((opt = getopt(argc, argv, "p:b:s:n:w:m:")) != -1) {
+		switch (opt) {
+		case 'p':
+			glcfg.ports = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			glcfg.baud = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			glcfg.size = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			glcfg.frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			glcfg.window = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			glcfg.interface = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-p ports] [-b baud] [-s frame size] [-n frames] [-w window] [-m interface]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!glcfg.ports || (glcfg.ports > LEIODC_UART_COUNT) || !glcfg.size || !glcfg.frames ||
+			!glcfg.window || (glcfg.window > BENCH_WINDOW_MAX)) {
+		fprintf(stderr, "Invalid arguments, ports 1...%u, window 1...%u\n", LEIODC_UART_COUNT, BENCH_WINDOW_MAX);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < glcfg.ports; i++) {
+		glports[i].uartno = i;
+		if (_bench_port_open(&glports[i]))
+			return EXIT_FAILURE;
+		pthread_create(&glports[i].echothread, NULL, _bench_echo, &glports[i]);
+	}
+
+	cpu = _bench_cpu();
+	start = _bench_now();
+	for (i = 0; i < glcfg.ports; i++)
+		pthread_create(&glports[i].workthread, NULL, _bench_work, &glports[i]);
+	for (i = 0; i < glcfg.ports; i++)
+		pthread_join(glports[i].workthread, NULL);
+	elapsed = _bench_now() - start;
+	cpu = _bench_cpu() - cpu;
+
+	for (i = 0; i < glcfg.ports; i++) {
+		leiodc_sio_stats_get(i, &glports[i].siostats);
+		leiodc_sio_port_del(i);
+		close(glports[i].slave);
+		close(glports[i].master);		// Echo thread read fails
+		pthread_join(glports[i].echothread, NULL);
+
+		bytes += glports[i].rxbytes + glports[i].txbytes;
+		frames += glports[i].frames;
+		if (glports[i].timeout || glports[i].errors || (glports[i].frames != glcfg.frames))
+			failed = 1;
+	}
+
+	printf("{\n  \"tool\": \"leiodcserbench\", \"version\": \"%s\",\n"
+			"  \"baud\": %u, \"size\": %u, \"frames\": %u, \"window\": %u, \"interface\": %u,\n"
+			"  \"ports\": [\n",
+			BENCH_VERSION, glcfg.baud, glcfg.size, glcfg.frames, glcfg.window, glcfg.interface);
+	for (i = 0; i < glcfg.ports; i++)
+		_bench_port_print(&glports[i], i == (glcfg.ports - 1));
+	printf("  ],\n  \"total\": {\"elapsed_ns\": %llu, \"bytes_per_s\": %.0f, \"frames\": %llu, "
+			"\"cpu_ns\": %llu, \"cpu_ns_per_frame\": %llu, \"passed\": %s}\n}\n",
+			(unsigned long long) elapsed, (elapsed) ? ((double) bytes * 1e9 / elapsed) : 0.0,
+			(unsigned long long) frames, (unsigned long long) cpu,
+			(unsigned long long) ((frames) ? (cpu / frames) : 0),
+			(failed) ? "false" : "true");
+
+	for (i = 0; i < glcfg.ports; i++)
+		free(glports[i].rtt);
+	return (failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}